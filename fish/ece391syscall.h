@@ -20,5 +20,23 @@ extern int32_t ece391_close (int32_t fd);
 extern int32_t ece391_getargs (uint8_t* buf, int32_t nbytes);
 extern int32_t ece391_vidmap (uint8_t** screen_start);
 
+/* poll sleeps until one of the nfds fds can be read (POLLIN) or written
+ * (POLLOUT) without blocking, or timeout ms passed (0 only checks, -1
+ * waits forever). It fills revents of each entry and returns how many
+ * are nonzero; POLLNVAL marks an fd that is not open. The rtc is
+ * readable once it ticked, the terminal once a line was entered, a pipe
+ * while it holds data or its writers are gone. */
+#define POLLIN   0x1
+#define POLLOUT  0x4
+#define POLLNVAL 0x20
+
+struct pollfd {
+    int32_t fd;
+    int16_t events;
+    int16_t revents;
+};
+
+extern int32_t ece391_poll (struct pollfd* fds, uint32_t nfds, int32_t timeout);
+
 #endif /* ECE391SYSCALL_H */
 
@@ -5,6 +5,7 @@
 
 #define NULL 0
 #define WAIT 100
+#define LINE_LEN 128
 uint8_t *vmem_base_addr;
 uint8_t *mp1_set_video_mode (void);
 void add_frames(uint8_t *, uint8_t *, int32_t);
@@ -20,9 +21,34 @@ extern void mp1_rtc_tasklet(unsigned long trash);
 
 static struct mp1_blink_struct blink_array[80*25];
 
+/* Run the tasklet on the next n rtc ticks. poll() sleeps on the rtc and the
+ * keyboard at once, so a line entered meanwhile ends the animation without
+ * waiting for the ticks to run out. Returns 1 if it was cut short. */
+static int run_ticks(int32_t rtc_fd, int n)
+{
+    struct pollfd fds[2];
+    uint8_t line[LINE_LEN];
+    int i, garbage;
+
+    for(i=0; i<n; i++) {
+        fds[0].fd = rtc_fd;
+        fds[0].events = POLLIN;
+        fds[1].fd = 0;
+        fds[1].events = POLLIN;
+        if(ece391_poll(fds, 2, -1) > 0 && (fds[1].revents & POLLIN)) {
+            ece391_read(0, line, LINE_LEN);
+            return 1;
+        }
+        /* ready now; a kernel without poll() blocks here as before */
+        ece391_read(rtc_fd, &garbage, 4);
+        mp1_rtc_tasklet(garbage);
+    }
+    return 0;
+}
+
 int main(void)
 {
-    int rtc_fd, ret_val, i, garbage;
+    int rtc_fd, ret_val;
     struct mp1_blink_struct blink_struct;
 
     ece391_memset(blink_array, 0, sizeof(struct mp1_blink_struct)*80*25);
@@ -38,10 +64,8 @@ int main(void)
     ret_val = 32;
     ret_val = ece391_write(rtc_fd, &ret_val, 4);
 
-    for(i=0; i<WAIT; i++) {
-        ece391_read(rtc_fd, &garbage, 4);
-        mp1_rtc_tasklet(garbage);
-    }
+    if(run_ticks(rtc_fd, WAIT))
+        goto done;
 
     blink_struct.on_char = 'I';
     blink_struct.off_char = 'M';
@@ -51,25 +75,19 @@ int main(void)
 
     mp1_ioctl((unsigned long)&blink_struct, RTC_ADD);
 
-    for(i=0; i<WAIT; i++) {
-        ece391_read(rtc_fd, &garbage, 4);
-        mp1_rtc_tasklet(garbage);
-    }
+    if(run_ticks(rtc_fd, WAIT))
+        goto done;
 
     mp1_ioctl((40 << 16 | (6*80+60)), RTC_SYNC);
 
-    for(i=0; i<WAIT; i++) {
-        ece391_read(rtc_fd, &garbage, 4);
-        mp1_rtc_tasklet(garbage);
-    }
+    if(run_ticks(rtc_fd, WAIT))
+        goto done;
 
     mp1_ioctl(6*80+60, RTC_REMOVE);
 
-    for(i=0; i<WAIT; i++) {
-        ece391_read(rtc_fd, &garbage, 4);
-        mp1_rtc_tasklet(garbage);
-    }
+    run_ticks(rtc_fd, WAIT);
 
+done:
     ece391_close(rtc_fd);
 
     return 0;
@@ -24,6 +24,7 @@ int32_t fileSystem_init(uint32_t * fs_start){
 
     info.data_blocks_start = (data_block_t *) (info.inode_start + info.total_inode);
 
+    mutex_init(&fs_lock, (int8_t*)"file system");
     return 0;
 }
 
@@ -155,9 +156,13 @@ int32_t read_data (uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t lengt
  *   OUTPUTS: the file descriptor (not implemented yet). Currently returning whether we can find the file with 0 as success, -1 as failure.
  */
 int32_t dir_open(const uint8_t* filename){
+    int32_t ret;
+    mutex_lock(&fs_lock);
     // Indicating that we will start to read file at index 0 of the dentry list. 
     info.counter = 0;
-    return read_dentry_by_name(filename, &(info.dentry));
+    ret = read_dentry_by_name(filename, &(info.dentry));
+    mutex_unlock(&fs_lock);
+    return ret;
 }
 
 /* 
@@ -172,14 +177,17 @@ int32_t dir_read(int32_t fd, void * buf, int32_t nbytes){
         return -1;
     }
     // printf("current counter: %d\n", info.counter);
+    mutex_lock(&fs_lock);
     // If we have read all files in the directory.
     if (read_dentry_by_index(info.counter, &(info.dentry)) == -1) {
+        mutex_unlock(&fs_lock);
         return 0;
     }
     info.counter += 1;
     strncpy(buf, info.dentry.filename, MAX_FILENAME_LEN);
     // Get the size of the file name and return.
     int len = strlen(info.dentry.filename);
+    mutex_unlock(&fs_lock);
     if (len >= MAX_FILENAME_LEN) {
         return MAX_FILENAME_LEN;
     }
@@ -203,8 +211,8 @@ int32_t dir_write(int32_t fd, const void * buf, int32_t nbytes){
  *   OUTPUTS: return -1 for invalid file descriptor. 
  */
 int32_t dir_close(int32_t fd){
-    // The user should not close file descriptor 0 (stdin) and 1 (stdout)
-    if(fd < 2 || fd >= 8){
+    // fd 0 and 1 may hold a file after a redirection
+    if(fd < 0 || fd >= 8){
         return -1;
     }
     return 0;
@@ -219,8 +227,9 @@ int32_t dir_close(int32_t fd){
  *   OUTPUTS: the file descriptor (not implemented yet). Currently returning whether we can find the file with 0 as success, -1 as failure.
  */
 int32_t file_open(const uint8_t* filename){
-    // Return whether we can find the dentry for the file. Also, store the found dentry in the info struct for future reference.
-    return read_dentry_by_name(filename, &(info.dentry));
+    // Return whether we can find the file (open() keeps its inode in the file descriptor).
+    dentry_t dentry;
+    return read_dentry_by_name(filename, &dentry);
 }
 
 /* 
@@ -234,8 +243,8 @@ int32_t file_read(int32_t fd, void * buf, int32_t nbytes){
     if(fd < 0 || fd >= 8){
         return -1;
     }
-    pcb_t* curr_pcb = get_pcb(schedule[active_term_idx]);
-    file_descriptor_t* fd_array = curr_pcb->fd_array;
+    pcb_t* curr_pcb = get_pcb(curr_pid);
+    file_descriptor_t* fd_array = curr_pcb->group->fd_array;
     // Get the inode number from the dentry read from file_open()
     uint32_t num_bytes_read = read_data(fd_array[fd].inode, fd_array[fd].file_pos, buf, nbytes);
     if (num_bytes_read != -1) {
@@ -261,8 +270,8 @@ int32_t file_write(int32_t fd, const void * buf, int32_t nbytes){
  *   OUTPUTS: return -1 for invalid file descriptor. 
  */
 int32_t file_close(int32_t fd){
-    // The user should not close file descriptor 0 (stdin) and 1 (stdout)
-    if(fd < 2 || fd >= 8){
+    // fd 0 and 1 may hold a file after a redirection
+    if(fd < 0 || fd >= 8){
         return -1;
     }
     return 0;
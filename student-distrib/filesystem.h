@@ -4,6 +4,7 @@
 #include "lib.h"
 #include "syscall.h"
 #include "terminal.h"
+#include "sync.h"
 
 #define BLOCK_TOTAL_BYTES       4096        // 4KB per block, 4096 bytes per block
 #define DENTRY_SIZE             64          // Size of a de.ntry in bytes.
@@ -60,8 +61,8 @@ typedef struct file_sys_info {
 // Store necessary information for the file system.
 file_sys_info info;
 
-// stores dentry for file to be run in execute
-dentry_t file_dentry;
+// counter and dentry of info, shared by every open directory
+mutex_t fs_lock;
 
 // Initialize global variables for the file system.
 int32_t fileSystem_init(uint32_t * fs_start);
@@ -0,0 +1,151 @@
+#include "fpu.h"
+#include "syscall.h"
+#include "smp.h"
+
+//1 if the cpu has fxsave/fxrstor, otherwise fall back to fnsave/frstor
+static uint32_t fpu_has_fxsr;
+
+//state right after fninit, loaded by a process's first fpu instruction
+static uint8_t fpu_init_state[FPU_STATE_SIZE] __attribute__((aligned (16)));
+static uint32_t fpu_init_saved;
+
+//read and write the cr0 control register
+static inline uint32_t read_cr0(){
+    uint32_t cr0;
+    asm volatile ("movl %%cr0, %0" : "=r"(cr0));
+    return cr0;
+}
+
+static inline void write_cr0(uint32_t cr0){
+    asm volatile ("movl %0, %%cr0" : : "r"(cr0) : "memory");
+}
+
+//copy the fpu/sse registers to or from a 16 byte aligned state area
+static inline void fpu_save(uint8_t* state){
+    if(fpu_has_fxsr){
+        asm volatile ("fxsave (%0)" : : "r"(state) : "memory");
+    }
+    else{
+        asm volatile ("fnsave (%0)" : : "r"(state) : "memory");
+    }
+}
+
+static inline void fpu_restore(uint8_t* state){
+    if(fpu_has_fxsr){
+        asm volatile ("fxrstor (%0)" : : "r"(state) : "memory");
+    }
+    else{
+        asm volatile ("frstor (%0)" : : "r"(state) : "memory");
+    }
+}
+
+/* 
+ * init_fpu
+ *   DESCRIPTION: turn on the x87 fpu of this cpu (and sse through CR4 when the cpu has fxsr),
+ *                save the freshly initialized state as the template for new processes (once,
+ *                on the boot cpu) and set CR0.TS so the first fpu instruction of any process
+ *                traps to fpu_trap()
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void init_fpu(){
+    uint32_t eax, ebx, ecx, edx;
+    uint32_t cr4;
+
+    asm volatile ("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+    fpu_has_fxsr = (edx & CPUID_FXSR) ? 1 : 0;
+
+    write_cr0((read_cr0() & ~(CR0_EM | CR0_TS)) | CR0_MP | CR0_NE);
+    if(fpu_has_fxsr){
+        asm volatile ("movl %%cr4, %0" : "=r"(cr4));
+        cr4 |= CR4_OSFXSR;
+        if(edx & CPUID_SSE){
+            cr4 |= CR4_OSXMMEXCPT;
+        }
+        asm volatile ("movl %0, %%cr4" : : "r"(cr4));
+    }
+
+    asm volatile ("fninit");
+    if(!fpu_init_saved){
+        fpu_save(fpu_init_state);
+        fpu_init_saved = 1;
+    }
+    this_cpu()->fpu_owner = NULL;
+
+    write_cr0(read_cr0() | CR0_TS);
+}
+
+/* 
+ * fpu_switch
+ *   DESCRIPTION: called by process_switch() before switching to next. The registers still
+ *                hold the state of this cpu's fpu owner; if next is not the owner set TS so its first fpu
+ *                instruction traps, otherwise clear TS so the owner runs without a trap.
+ *                Processes that never use the fpu are never saved or restored.
+ *   INPUTS: next - process about to run
+ *   OUTPUTS: none
+ */
+void fpu_switch(pcb_t* next){
+    if(next == this_cpu()->fpu_owner){
+        asm volatile ("clts");
+    }
+    else{
+        write_cr0(read_cr0() | CR0_TS);
+    }
+}
+
+/* 
+ * fpu_trap
+ *   DESCRIPTION: #NM (device not available) handler. Saves the registers into the previous
+ *                owner's pcb, loads the current process's state (a clean one on its first
+ *                use) and makes it the owner. The faulting instruction is retried on return.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void fpu_trap(){
+    uint32_t flags;
+    pcb_t* curr_pcb;
+    cpu_t* cpu;
+
+    cli_and_save(flags);
+    asm volatile ("clts");
+    cpu = this_cpu();
+    curr_pcb = get_pcb(curr_pid);
+
+    if(cpu->fpu_owner != curr_pcb){
+        if(cpu->fpu_owner != NULL){
+            fpu_save(cpu->fpu_owner->fpu_state);
+        }
+        if(curr_pcb->fpu_used){
+            fpu_restore(curr_pcb->fpu_state);
+        }
+        else{
+            fpu_restore(fpu_init_state);
+            curr_pcb->fpu_used = 1;
+        }
+        cpu->fpu_owner = curr_pcb;
+    }
+
+    restore_flags(flags);
+}
+
+/* 
+ * fpu_release
+ *   DESCRIPTION: drop a process's fpu state without saving it. If it owns the registers of
+ *                its cpu they are simply abandoned, and TS is set in case it keeps running
+ *                (root shell restart) so its next fpu instruction starts from a clean state.
+ *                It may be freed from another cpu (wait()), so every cpu is checked.
+ *   INPUTS: pcb - process that is exiting or restarting
+ *   OUTPUTS: none
+ */
+void fpu_release(pcb_t* pcb){
+    uint32_t k;
+    for(k = 0; k < nr_cpus; k++){
+        if(cpus[k].fpu_owner == pcb){
+            cpus[k].fpu_owner = NULL;
+            if(&cpus[k] == this_cpu()){
+                write_cr0(read_cr0() | CR0_TS);
+            }
+        }
+    }
+    pcb->fpu_used = 0;
+}
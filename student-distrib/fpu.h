@@ -0,0 +1,34 @@
+#ifndef _FPU_H
+#define _FPU_H
+
+#include "types.h"
+#include "lib.h"
+
+#define FPU_STATE_SIZE      512         // fxsave area (fnsave only needs 108 bytes)
+
+#define CR0_MP              0x00000002  // monitor coprocessor: wait/fwait also trap while TS is set
+#define CR0_EM              0x00000004  // emulate: no fpu, every fpu instruction traps
+#define CR0_TS              0x00000008  // task switched: next fpu/sse instruction raises #NM
+#define CR0_NE              0x00000020  // report fpu errors as #MF instead of through the PIC
+#define CR4_OSFXSR          0x00000200  // os supports fxsave/fxrstor, enables sse
+#define CR4_OSXMMEXCPT      0x00000400  // os handles #XM for unmasked sse exceptions
+
+#define CPUID_FXSR          (1 << 24)   // cpuid 1 edx: fxsave/fxrstor
+#define CPUID_SSE           (1 << 25)   // cpuid 1 edx: sse
+
+struct pcb;
+
+// enable this cpu's fpu (and sse if present), record a clean state for new processes, set TS.
+// The process whose state is in a cpu's registers is that cpu's fpu_owner (see smp.h).
+void init_fpu();
+
+// called on every context switch: arm the #NM trap unless next already owns the registers
+void fpu_switch(struct pcb* next);
+
+// #NM handler: hand the fpu registers to the current process on its first fpu instruction
+void fpu_trap();
+
+// forget a process's fpu state (it is exiting or restarting)
+void fpu_release(struct pcb* pcb);
+
+#endif /* _FPU_H */
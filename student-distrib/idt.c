@@ -1,4 +1,7 @@
 #include "idt.h"
+#include "fpu.h"
+#include "smp.h"
+#include "signal.h"
 
 
 #define EXC_NUM     20
@@ -12,7 +15,7 @@
  * init_idt
  *   DESCRIPTION: Init the IDT table
  *                Sets up the first 20 exceptions, system call at 0x80, 
- *                RTC and keyboard interrupts
+ *                RTC and keyboard interrupts and the local apic vectors
  *   INPUTS: none
  *   OUTPUTS: none
  */
@@ -44,6 +47,9 @@ void init_idt() {
 
     //sets up rtc interrupt
     set_rtc_interrupts();
+
+    //sets up lapic timer, reschedule ipi and spurious interrupts
+    set_smp_interrupts();
 }
 
 /* 
@@ -140,8 +146,28 @@ void set_rtc_interrupts(){
     SET_IDT_ENTRY(idt[RTC], &rtc_handler_wrapper);
 }
 
-//exception function handler
-void divid_error_exc(){
+/* 
+ * set_smp_interrupts
+ *   DESCRIPTION: set the idt entries of the local apic: the scheduler tick of the application
+ *                processors, the reschedule ipi and the spurious vector
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void set_smp_interrupts(){
+    set_interrupts(LAPIC_TIMER_VECTOR);
+    SET_IDT_ENTRY(idt[LAPIC_TIMER_VECTOR], &lapic_timer_handler_wrapper);
+    set_interrupts(RESCHED_VECTOR);
+    SET_IDT_ENTRY(idt[RESCHED_VECTOR], &resched_ipi_handler_wrapper);
+    set_interrupts(SPURIOUS_VECTOR);
+    SET_IDT_ENTRY(idt[SPURIOUS_VECTOR], &spurious_handler_wrapper);
+}
+
+//exception function handlers: a fault in user mode becomes a signal for the process,
+//one in the kernel stops the machine
+void divid_error_exc(hw_context_t* regs){
+    if(signal_exception(regs, SIG_DIV_ZERO)){
+        return;
+    }
     printf("Divide Error Exception\n");
     while(1);
 }
@@ -153,25 +179,37 @@ void nmi_exc(){
     printf("NMI Interrupt");
     while(1);
 }
-void breakpoint_exc(){
+void breakpoint_exc(hw_context_t* regs){
+    if(signal_exception(regs, SIG_SEGFAULT)){
+        return;
+    }
     printf("Breakpoint Exception");
     while(1);
 }
-void overflow_exc(){
+void overflow_exc(hw_context_t* regs){
+    if(signal_exception(regs, SIG_SEGFAULT)){
+        return;
+    }
     printf("Overflow Exception");
     while(1);
 }
-void bound_range_exc(){
+void bound_range_exc(hw_context_t* regs){
+    if(signal_exception(regs, SIG_SEGFAULT)){
+        return;
+    }
     printf("BOUND Range Exceeded Exception");
     while(1);
 }
-void invalid_opcode_exc(){
+void invalid_opcode_exc(hw_context_t* regs){
+    if(signal_exception(regs, SIG_SEGFAULT)){
+        return;
+    }
     printf("Invalid Opcode Exception");
     while(1);
 }
+//CR0.TS is set after a context switch: load the process's fpu state lazily
 void dev_not_avail_exc(){
-    printf("Device Not Available Exception");
-    while(1);
+    fpu_trap();
 }
 void double_fault_exc(){
     printf("Double Fault Exception");
@@ -185,28 +223,46 @@ void invalid_tss_exc(){
     printf("Invalid TSS Exception");
     while(1);
 }
-void seg_not_found_exc(){
+void seg_not_found_exc(hw_context_t* regs){
+    if(signal_exception(regs, SIG_SEGFAULT)){
+        return;
+    }
     printf("Segment Not Present");
     while(1);
 }
-void stack_fault_exc(){
+void stack_fault_exc(hw_context_t* regs){
+    if(signal_exception(regs, SIG_SEGFAULT)){
+        return;
+    }
     printf("Stack Fault Exception");
     while(1);
 }
-void gen_protect_exc(){
+void gen_protect_exc(hw_context_t* regs){
+    if(signal_exception(regs, SIG_SEGFAULT)){
+        return;
+    }
     printf("General Protection Exception");
     while(1);
 }
-void page_fault_exc(){
+void page_fault_exc(hw_context_t* regs){
+    if(signal_exception(regs, SIG_SEGFAULT)){
+        return;
+    }
     printf("Page-Fault Exception");
     get_cr2();
     while(1);
 }
-void x87_FPU_exc(){
+void x87_FPU_exc(hw_context_t* regs){
+    if(signal_exception(regs, SIG_DIV_ZERO)){
+        return;
+    }
     printf("x87 FPU Floating-Point Error");
     while(1);
 }
-void alignment_check_exc(){
+void alignment_check_exc(hw_context_t* regs){
+    if(signal_exception(regs, SIG_SEGFAULT)){
+        return;
+    }
     printf("Alignment Check Exception");
     while(1);
 }
@@ -214,7 +270,10 @@ void machine_check_exc(){
     printf("Machine-Check Exception");
     while(1);
 }
-void SIMD_FP_exc(){
+void SIMD_FP_exc(hw_context_t* regs){
+    if(signal_exception(regs, SIG_DIV_ZERO)){
+        return;
+    }
     printf("SIMD Floating-Point Exception");
     while(1);
 }
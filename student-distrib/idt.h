@@ -18,25 +18,26 @@ extern void set_exceptions();
 
 
 //handler functions for exceptions
-void divid_error_exc();
+struct hw_context;
+void divid_error_exc(struct hw_context* regs);
 void debug_exc();
 void nmi_exc();
-void breakpoint_exc();
-void overflow_exc();
-void bound_range_exc();
-void invalid_opcode_exc();
+void breakpoint_exc(struct hw_context* regs);
+void overflow_exc(struct hw_context* regs);
+void bound_range_exc(struct hw_context* regs);
+void invalid_opcode_exc(struct hw_context* regs);
 void dev_not_avail_exc();
 void double_fault_exc();
 void coprocessor_exc();
 void invalid_tss_exc();
-void seg_not_found_exc();
-void stack_fault_exc();
-void gen_protect_exc();
-void page_fault_exc();
-void x87_FPU_exc();
-void alignment_check_exc();
+void seg_not_found_exc(struct hw_context* regs);
+void stack_fault_exc(struct hw_context* regs);
+void gen_protect_exc(struct hw_context* regs);
+void page_fault_exc(struct hw_context* regs);
+void x87_FPU_exc(struct hw_context* regs);
+void alignment_check_exc(struct hw_context* regs);
 void machine_check_exc();
-void SIMD_FP_exc();
+void SIMD_FP_exc(struct hw_context* regs);
 
 void syscall_wrapper();
 
@@ -52,6 +53,9 @@ void set_keyboard_interrupts();
 //sets up rtc interrupts
 void set_rtc_interrupts();
 
+//sets up local apic timer, reschedule ipi and spurious interrupts
+void set_smp_interrupts();
+
 void get_cr2();
 
 #endif
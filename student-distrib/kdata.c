@@ -0,0 +1,85 @@
+#include "kdata.h"
+#include "pit.h"
+#include "syscall.h"
+
+//the clock page, mapped at KDATA_VIR in every process; padded to a whole page so no
+//other kernel data shares it
+static union{
+    kdata_clock_t clock;
+    uint8_t page[PAGE_SIZE_4KB];
+} kdata_clock_page __attribute__((aligned (PAGE_SIZE_4KB)));
+#define kdata_clock (kdata_clock_page.clock)
+
+//process pages, one per user frame, mapped at KDATA_PROC_VIR
+static union{
+    kdata_proc_t proc;
+    uint8_t page[PAGE_SIZE_4KB];
+} kdata_procs[USER_FRAMES_MAX] __attribute__((aligned (PAGE_SIZE_4KB)));
+//page table covering KDATA_VIR of each user frame's page directory
+static page_table_entry kdata_tables[USER_FRAMES_MAX][NUM_ENTRIES] __attribute__((aligned (TABLE_SIZE)));
+
+/*
+ * init_kdata
+ *   DESCRIPTION: publish the tsc calibration that init_pit measured
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void init_kdata(){
+    kdata_clock.tsc_per_tick = tsc_per_tick;
+    kdata_clock.pit_freq = PIT_FREQ;
+}
+
+/*
+ * kdata_map
+ *   DESCRIPTION: map the clock page and the frame's process page read-only for user mode
+ *                at KDATA_VIR in a new process's page directory, through the frame's own
+ *                page table. The pages stay writable for the kernel (no CR0.WP).
+ *                kdata_publish fills in the process page once the pcb is set up.
+ *   INPUTS: pcb - a process with a fresh page directory and its user frame
+ *   OUTPUTS: none
+ */
+void kdata_map(pcb_t* pcb){
+    page_table_entry* table = kdata_tables[pcb->user_frame];
+    kdata_proc_t* proc = &kdata_procs[pcb->user_frame].proc;
+    page_dir_entry_kb pde;
+    uint32_t i;
+
+    for(i = 0; i < NUM_ENTRIES; i++){
+        setup_page_table_entry(&table[i], 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0);
+    }
+    setup_page_table_entry(&table[0], 1, 0, 1, 0, 0, 0, 0, 0, 0, 0, (uint32_t)&kdata_clock >> KB_PAGE_NUM_OFFSET);
+    setup_page_table_entry(&table[1], 1, 0, 1, 0, 0, 0, 0, 0, 0, 0, (uint32_t)proc >> KB_PAGE_NUM_OFFSET);
+    setup_page_dir_entry_kb(&pde, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, (uint32_t)table >> PAGE_TABLE_NUM_OFFSET);
+    pcb->page_dir[KDATA_VIR >> MB_PAGE_NUM_OFFSET] = *(int*)&pde;
+}
+
+/*
+ * kdata_publish
+ *   DESCRIPTION: write a process's pid and terminal into its process page
+ *   INPUTS: pcb - main thread of the process
+ *   OUTPUTS: none
+ */
+void kdata_publish(pcb_t* pcb){
+    kdata_proc_t* proc = &kdata_procs[pcb->user_frame].proc;
+
+    proc->pid = pcb->pid;
+    proc->term_idx = pcb->term_idx;
+}
+
+/*
+ * kdata_tick
+ *   DESCRIPTION: publish a new tick on the clock page. seq is odd while the fields change,
+ *                so a reader on another cpu retries instead of mixing old and new values.
+ *                Only the boot cpu's pit_handler writes the page.
+ *   INPUTS: ticks - pit_ticks
+ *           tsc - low 32 bits of the tsc at that tick
+ *   OUTPUTS: none
+ */
+void kdata_tick(uint32_t ticks, uint32_t tsc){
+    kdata_clock.seq++;
+    asm volatile ("" : : : "memory");
+    kdata_clock.pit_ticks = ticks;
+    kdata_clock.tick_tsc = tsc;
+    asm volatile ("" : : : "memory");
+    kdata_clock.seq++;
+}
@@ -0,0 +1,43 @@
+#ifndef _KDATA_H
+#define _KDATA_H
+
+#include "types.h"
+#include "lib.h"
+#include "page.h"
+#include "process.h"
+
+#define KDATA_VIR           0x8C00000   // virtual addr of the kernel data pages, the 4MB after vidmap's
+#define KDATA_PROC_VIR      (KDATA_VIR + PAGE_SIZE_4KB)    // page with the process's own fields
+
+struct pcb;
+
+/* Clock page, the same in every process. pit_handler rewrites it every tick; a reader
+ * takes seq, reads the fields and retries if seq was odd or changed meanwhile. The time
+ * since the last tick is (rdtsc low 32 bits - tick_tsc) / tsc_per_tick ticks. */
+typedef struct kdata_clock{
+    volatile uint32_t seq;          //odd while the kernel updates the page
+    volatile uint32_t pit_ticks;    //10ms ticks since boot
+    volatile uint32_t tick_tsc;     //low 32 bits of the tsc at pit_ticks
+    uint32_t tsc_per_tick;          //tsc cycles per tick (calibration)
+    uint32_t pit_freq;              //ticks per second
+} kdata_clock_t;
+
+/* Process page, one per user frame (threads share their process's) */
+typedef struct kdata_proc{
+    uint32_t pid;                   //pid of the process (its main thread)
+    uint32_t term_idx;              //terminal it reads from and writes to
+} kdata_proc_t;
+
+//publish the tsc calibration; call after init_pit
+void init_kdata();
+
+//map the read-only kernel data pages into a new process's page directory (alloc_process)
+void kdata_map(struct pcb* pcb);
+
+//write the pid and terminal of a process into its process page
+void kdata_publish(struct pcb* pcb);
+
+//new tick: publish pit_ticks and the tsc it was taken at (pit_handler)
+void kdata_tick(uint32_t ticks, uint32_t tsc);
+
+#endif /* _KDATA_H */
@@ -16,6 +16,11 @@
 #include "filesystem.h"
 #include "syscall.h"
 #include "pit.h"
+#include "smp.h"
+#include "sync.h"
+#include "pipe.h"
+#include "sysenter.h"
+#include "kdata.h"
 
 #define RUN_TESTS
 
@@ -56,6 +61,7 @@ void entry(unsigned long magic, unsigned long addr) {
         printf("cmdline = %s\n", (char *)mbi->cmdline);
 
     uint32_t * filesys_start;                           // staring address of the file system.
+    uint32_t pool_start = (uint32_t)_end;               // kernel stacks go above the kernel and its modules
     if (CHECK_FLAG(mbi->flags, 3)) {
         int mod_count = 0;
         int i;
@@ -70,6 +76,8 @@ void entry(unsigned long magic, unsigned long addr) {
                 printf("0x%x ", *((char*)(mod->mod_start+i)));
             }
             printf("\n");
+            if (mod->mod_end > pool_start)
+                pool_start = mod->mod_end;
             mod_count++;
             mod++;
         }
@@ -168,13 +176,36 @@ void entry(unsigned long magic, unsigned long addr) {
     /*init file system*/
     fileSystem_init(filesys_start);
 
+    /* find the other processors in the mp tables (physical memory, before paging) */
+    smp_detect();
+
     /*init virtual memory and paging*/
     setup_paging();
 
     clear(); //clear screen
 
+    /* fpu/sse, switched lazily between processes */
+    init_fpu();
+
+    /* process table, kernel stack pool and user frames */
+    init_process_table(pool_start, CHECK_FLAG(mbi->flags, 0) ? mbi->mem_upper : 0);
+
+    /* futex wait queues for user level locks */
+    init_futex();
+    init_pipes();
+
     init_pit(); //starts scheduler
 
+    /* clock page read by user programs without a system call */
+    init_kdata();
+
+    /* start the application processors; they wait for the kernel lock we keep until start_idle */
+    kernel_lock();
+    smp_init();
+
+    /* sysenter/sysexit fast system calls, on the boot cpu's own tss */
+    init_sysenter();
+
     //init_terminal(0); //set up terminal 0 shell
 
     
@@ -189,6 +220,16 @@ void entry(unsigned long magic, unsigned long addr) {
      * without showing you any output */
     
     
+#ifdef RUN_TESTS
+    /* Run tests as the boot cpu's idle task, before interrupts are on. The tick stays
+     * masked for spinlock_test's sti(): it would launch the shells and schedule the fake
+     * processes the scheduler tests queue */
+    init_idle_task();
+    disable_irq(PIT_IRQ);
+    launch_tests();
+    enable_irq(PIT_IRQ);
+#endif
+
     // printf("Enabling Interrupts\n");
     sti();
 
@@ -199,12 +240,8 @@ void entry(unsigned long magic, unsigned long addr) {
 
     
 
-#ifdef RUN_TESTS
-    /* Run tests */
-    //launch_tests();
-#endif
     /* Execute the first program ("shell") ... */
 
-    /* Spin (nicely, so we don't chew up cycles) */
-    asm volatile (".1: hlt; jmp .1;");
+    /* Become the idle task: halt (tickless) whenever no process is ready */
+    start_idle();
 }
@@ -1,4 +1,8 @@
 #include "keyboard.h"
+#include "pit.h"
+#include "ring.h"
+#include "multicall.h"
+#include "signal.h"
 
 #define KEYBOARD_IRQ       0x01
 #define KEYBOARD_PORT      0x60
@@ -131,6 +135,7 @@ void init_keyboard(){
     control = 0;
     control_l = 0;
     control_c = 0;
+    control_s = 0;
     enter_flag = 0;
     alt = 0;
     alt_f1 = 0;
@@ -155,7 +160,9 @@ void keyboard_handler(){
     flag_updated = update_flags(scan_code);
     //clear screen if control l flag is on
     clear_screen();
-    //call halt if ctrl_c is pressed
+    //print input latency stats if control s is pressed
+    show_stats();
+    //interrupt the foreground program if ctrl_c is pressed
     halt_program();
     // switch terminal if alt f is pressed
     switch_terminal(); 
@@ -166,6 +173,8 @@ void keyboard_handler(){
     }
     //send eoi to signal end 
     send_eoi(KEYBOARD_IRQ);
+    //run the reader we just woke right away if it outranks the current process
+    preempt_check();
 }
 
 /* 
@@ -209,6 +218,12 @@ int update_flags(unsigned char scan_code) {
         return 1;
     }
 
+    // update control s
+    if (scan_code == s_pressed && control == 1) {
+        control_s = 1;
+        return 1;
+    }
+
     // update control c
     if (scan_code == c_pressed && control == 1) {
         control_c = 1;
@@ -266,20 +281,56 @@ void clear_screen() {
 
         // clean buffer
         int i;
+        uint32_t flags;
+        spin_lock_irqsave(&terminal[visible_term_idx].lock, flags);
         for (i = 0; i < kbuf_size; i++) {
            // kbuf[current_terminal_idx][i] = NULL_CHAR;
            terminal[visible_term_idx].kbuf[i] = NULL_CHAR;
         }
         //cur_kbuf_size[current_terminal_idx] = 0;
         terminal[visible_term_idx].cur_kuf_size = 0;
+        spin_unlock_irqrestore(&terminal[visible_term_idx].lock, flags);
+    }
+}
+
+/* 
+ * show_stats
+ *   DESCRIPTION: print the input latency stats of every terminal, the tick, timer, ring and multicall counters and the per-cpu counters and load if control s is pressed
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void show_stats() {
+    if (control_s == 1) {
+        control_s = 0;
+        print_input_latency();
+        print_pit_stats();
+        print_timer_stats();
+        print_ring_stats();
+        print_multicall_stats();
+        print_smp_stats();
+        print_load_stats();
+        print_irq_off_stats();
     }
 }
 
+/* 
+ * halt_program
+ *   DESCRIPTION: ctrl+c: send SIG_INTERRUPT to the foreground program of the visible terminal,
+ *                wherever it is: running here or on another cpu, or asleep in a read (by
+ *                default the program halts)
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
 void halt_program(){
-    if(control_c == 1 && (active_term_idx == visible_term_idx)){
+    uint32_t pid;
+
+    if(control_c == 1){
         control_c = 0;
-        send_eoi(KEYBOARD_IRQ);
-        halt(0);
+        //execute() and halt() keep schedule[] at the foreground program of each terminal
+        pid = schedule[visible_term_idx];
+        if(pid != (uint32_t)-1){
+            send_signal(get_pcb(pid), SIG_INTERRUPT);
+        }
     }
 }
 
@@ -296,8 +347,6 @@ void switch_terminal() {
         
         send_eoi(KEYBOARD_IRQ);
         terminal_switch(visible_term_idx, 0);
-        //update current visible terminal idx
-        visible_term_idx = 0;
         //puts("Switch to terminal 0\n");
 
     }
@@ -307,8 +356,6 @@ void switch_terminal() {
        
         send_eoi(KEYBOARD_IRQ);
         terminal_switch(visible_term_idx, 1);
-        //update current visible terminal idx
-        visible_term_idx = 1;
         //puts("Switch to terminal 1\n");
     
     }
@@ -318,8 +365,6 @@ void switch_terminal() {
     
         send_eoi(KEYBOARD_IRQ);
         terminal_switch(visible_term_idx, 2);
-        //update current visible terminal idx
-        visible_term_idx = 2;
         //puts("Switch to terminal 2\n");
         
     }
@@ -401,6 +446,9 @@ char get_key(unsigned char scan_code) {
  *   OUTPUTS: none
  */
 void print_key(char key, unsigned char scan_code) {
+    uint32_t flags;
+    int entered = 0;
+    spin_lock_irqsave(&terminal[visible_term_idx].lock, flags);
     // handle backspace
     if (scan_code == backspace_pressed) {
         // should only delete if something is in buffer
@@ -440,6 +488,12 @@ void print_key(char key, unsigned char scan_code) {
 
             terminal[visible_term_idx].cur_kuf_size = 0;
             terminal[visible_term_idx].enter_flag = 1;       //indicate command has been entered
+            //time how long the blocked reader takes to get the cpu (shown with ctrl+s)
+            if (terminal[visible_term_idx].read_wq.head != NULL) {
+                terminal[visible_term_idx].enter_tsc = rdtsc();
+                terminal[visible_term_idx].enter_timed = 1;
+            }
+            entered = 1;
 
         } else if (scan_code != enter_pressed && terminal[visible_term_idx].cur_kuf_size < (kbuf_size - 1)) {
             // print an ordinary character
@@ -448,4 +502,8 @@ void print_key(char key, unsigned char scan_code) {
             terminal[visible_term_idx].cur_kuf_size++;
         }
     }
+    spin_unlock_irqrestore(&terminal[visible_term_idx].lock, flags);
+    if (entered) {
+        wake_up_boost(&terminal[visible_term_idx].read_wq);    //let the blocked terminal_read run
+    }
 }
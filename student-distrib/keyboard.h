@@ -34,6 +34,7 @@
 #define right_control_released 0x9D
 #define l_pressed 0x26
 #define c_pressed 0x2E
+#define s_pressed 0x1F
 #define l_released 0xA6
 #define alt_pressed 0x38
 #define alt_released 0xB8
@@ -71,6 +72,7 @@ int shift;
 int control;
 int control_l;
 int control_c;
+int control_s;
 int enter_flag;
 int alt;
 int alt_f1;
@@ -95,6 +97,9 @@ void print_key(char key, unsigned char scan_code);
 //clear the screen when ctrl l is pressed
 void clear_screen();
 
+//print input latency stats when ctrl s is pressed
+void show_stats();
+
 //halt current program when ctrl c is pressed
 void halt_program();
 
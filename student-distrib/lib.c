@@ -15,6 +15,10 @@ static int screen_x;
 static int screen_y;
 static char* video_mem = (char *)VIDEO;
 
+//every cpu prints, and putc_backing borrows screen_x/screen_y; terminal_switch
+//changes visible_term_idx under it
+ticket_lock_t screen_lock = TICKET_LOCK_INIT("screen");
+
 /*
 static int screen_x0;
 static int screen_y0;
@@ -31,6 +35,8 @@ static int screen_y2;
  * Function: Clears video memory */
 void clear(void) {
     int32_t i;
+    uint32_t flags;
+    ticket_lock_irqsave(&screen_lock, flags);
     for (i = 0; i < NUM_ROWS * NUM_COLS; i++) {
         *(uint8_t *)(video_mem + (i << 1)) = ' ';
         *(uint8_t *)(video_mem + (i << 1) + 1) = ATTRIB;
@@ -42,6 +48,7 @@ void clear(void) {
 
     // update cursor
     update_cursor(screen_x, screen_y);
+    ticket_unlock_irqrestore(&screen_lock, flags);
 }
 
 int get_x() {
@@ -264,11 +271,12 @@ void scroll(int active_idx) {
 }
 
 
-/* void putc(uint8_t c);
+/* void putc_visible(uint8_t c);
  * Inputs: uint_8* c = character to print
  * Return Value: void
- *  Function: Output a character to the console and call scrolling function when needed */
-void putc(uint8_t c) {
+ *  Function: Output a character to video memory at screen_x/screen_y and scroll when needed.
+ *            Call with screen_lock held. */
+static void putc_visible(uint8_t c) {
     // case 1: newline, case2: tab, case3: other input
     if(c == '\n' || c == '\r') {
         if (screen_y< (NUM_ROWS - 1)) {
@@ -326,8 +334,20 @@ void putc(uint8_t c) {
  * Inputs: uint_8* c = character to print
  * Return Value: void
  *  Function: Output a character to the console and call scrolling function when needed */
-void putc_diff(uint8_t c, int active_idx) {
+void putc(uint8_t c) {
+    uint32_t flags;
+    ticket_lock_irqsave(&screen_lock, flags);
+    putc_visible(c);
+    ticket_unlock_irqrestore(&screen_lock, flags);
+}
 
+/* void putc_backing(uint8_t c, int active_idx);
+ * Inputs: uint_8* c = character to print
+ *         active_idx = terminal that is not on the screen
+ * Return Value: void
+ *  Function: Output a character to the backing page of a terminal at its saved cursor and
+ *            scroll that page when needed. Call with screen_lock held. */
+static void putc_backing(uint8_t c, int active_idx) {
     int screen_x0;
     int screen_y0;
     int screen_x1;
@@ -440,11 +460,31 @@ void putc_diff(uint8_t c, int active_idx) {
 
 }
 
+/* void putc_term(uint8_t c, int term_idx);
+ * Inputs: uint_8* c = character to print
+ *         term_idx = terminal to print on
+ * Return Value: void
+ *  Function: Output a character to a terminal: to video memory if it is the visible one,
+ *            otherwise to its backing page. The choice is made under screen_lock, so a
+ *            terminal switch cannot move the character to the other terminal's screen. */
+void putc_term(uint8_t c, int term_idx) {
+    uint32_t flags;
+    ticket_lock_irqsave(&screen_lock, flags);
+    if (term_idx == visible_term_idx) {
+        putc_visible(c);
+    } else {
+        putc_backing(c, term_idx);
+    }
+    ticket_unlock_irqrestore(&screen_lock, flags);
+}
+
 /* void rmc();
  * Inputs: None
  * Return Value: None
  * Function: remove one character from the screen */
 void rmc() {
+    uint32_t flags;
+    ticket_lock_irqsave(&screen_lock, flags);
     if (screen_x == 0 && screen_y > 0) {
         // move to the previous line
         screen_y--;
@@ -461,6 +501,7 @@ void rmc() {
 
     // update cursor
     update_cursor(screen_x, screen_y);
+    ticket_unlock_irqrestore(&screen_lock, flags);
 
 }
 
@@ -758,3 +799,14 @@ void test_interrupts(void) {
         video_mem[i << 1]++;
     }
 }
+
+/* void print_irq_off_stats(void)
+ * Inputs: void
+ * Return Value: void
+ * Function: print the longest section run with interrupts off under an irqsave lock */
+void print_irq_off_stats(void) {
+#if IRQ_OFF_DEBUG
+    printf("irq off: longest %u cycles under lock %s\n", irq_off_max,
+           irq_off_max_name ? irq_off_max_name : (int8_t*)"none");
+#endif
+}
@@ -9,7 +9,8 @@
 
 int32_t printf(int8_t *format, ...);
 void putc(uint8_t c);
-void putc_diff(uint8_t c, int active_idx);
+// print one character on terminal term_idx, on the screen or in its backing page
+void putc_term(uint8_t c, int term_idx);
 // remove one character from the screen
 void rmc();
 int32_t puts(int8_t *s);
@@ -46,6 +47,9 @@ int32_t safe_strncpy(int8_t* dest, const int8_t* src, int32_t n);
 
 void test_interrupts(void);
 
+/* Print the longest interrupts-off section seen (IRQ_OFF_DEBUG) */
+void print_irq_off_stats(void);
+
 /* Port read functions */
 /* Inb reads a byte and returns its value as a zero-extended 32-bit
  * unsigned int */
@@ -90,6 +94,29 @@ static inline uint32_t inl(port) {
     return val;
 }
 
+/* Reads the low 32 bits of the time stamp counter. The difference of two
+ * readings is correct as long as they are less than 2^32 cycles apart */
+static inline uint32_t rdtsc(void) {
+    uint32_t lo, hi;
+    asm volatile ("rdtsc"
+            : "=a"(lo), "=d"(hi)
+            :
+            : "memory"
+    );
+    return lo;
+}
+
+/* Reads the whole time stamp counter, for spans that may exceed 2^32 cycles */
+static inline uint64_t rdtsc64(void) {
+    uint64_t tsc;
+    asm volatile ("rdtsc"
+            : "=A"(tsc)
+            :
+            : "memory"
+    );
+    return tsc;
+}
+
 /* Writes a byte to a port */
 #define outb(data, port)                \
 do {                                    \
@@ -171,4 +198,147 @@ do {                                    \
     );                                  \
 } while (0)
 
+/* Interrupt flag in EFLAGS */
+#define IF_FLAG         0x200
+
+/* Set to 1 to time every section run under spin_lock_irqsave or
+ * ticket_lock_irqsave and remember the longest one (ctrl+s) */
+#define IRQ_OFF_DEBUG   0
+
+/* Spinlock: keeps the other cpus out of a critical section. Data that
+ * interrupt handlers touch must be locked with spin_lock_irqsave, or an
+ * interrupt on the cpu holding the lock would spin on it forever. */
+typedef struct spinlock {
+    volatile uint32_t locked;
+    const int8_t* name;         /* shown by the IRQ_OFF_DEBUG statistics */
+    uint32_t irq_off_tsc;       /* tsc when spin_lock_irqsave turned interrupts off */
+} spinlock_t;
+
+/* Ticket lock: like a spinlock, but cpus get it in the order they asked
+ * for it, so one cpu cannot starve the others on a busy lock */
+typedef struct ticket_lock {
+    volatile uint16_t next;     /* ticket handed to the next cpu asking */
+    volatile uint16_t owner;    /* ticket allowed in */
+    const int8_t* name;
+    uint32_t irq_off_tsc;
+} ticket_lock_t;
+
+#define SPINLOCK_INIT(lock_name)        { 0, (int8_t*)(lock_name), 0 }
+#define TICKET_LOCK_INIT(lock_name)     { 0, 0, (int8_t*)(lock_name), 0 }
+
+/* Serializes the console: video memory, the cursor and the terminal
+ * backing pages (lib.c) */
+extern ticket_lock_t screen_lock;
+
+/* Longest section run with interrupts off under an irqsave lock, in tsc
+ * cycles, and the lock it was (IRQ_OFF_DEBUG only) */
+uint32_t irq_off_max;
+const int8_t* irq_off_max_name;
+
+/* Set up an unlocked spinlock */
+static inline void spin_lock_init(spinlock_t* lock, const int8_t* name) {
+    lock->locked = 0;
+    lock->name = name;
+    lock->irq_off_tsc = 0;
+}
+
+/* Take the lock if it is free; returns 1 if we got it */
+static inline uint32_t spin_trylock(spinlock_t* lock) {
+    uint32_t old = 1;
+    asm volatile ("xchgl %0, %1"
+            : "+r"(old), "+m"(lock->locked)
+            :
+            : "memory"
+    );
+    return old == 0;
+}
+
+/* Spin until the lock is ours. Waits on plain reads so the cache line
+ * is only written when the lock looks free. */
+static inline void spin_lock(spinlock_t* lock) {
+    while (!spin_trylock(lock)) {
+        while (lock->locked) {
+            asm volatile ("pause");
+        }
+    }
+}
+
+static inline void spin_unlock(spinlock_t* lock) {
+    asm volatile ("" : : : "memory");
+    lock->locked = 0;
+}
+
+/* Take a ticket and spin until it is called */
+static inline void ticket_lock(ticket_lock_t* lock) {
+    uint16_t ticket = 1;
+    asm volatile ("lock xaddw %0, %1"
+            : "+r"(ticket), "+m"(lock->next)
+            :
+            : "memory"
+    );
+    while (lock->owner != ticket) {
+        asm volatile ("pause");
+    }
+}
+
+/* Only the holder writes owner, so a plain increment is enough */
+static inline void ticket_unlock(ticket_lock_t* lock) {
+    asm volatile ("" : : : "memory");
+    lock->owner++;
+}
+
+#if IRQ_OFF_DEBUG
+/* start timing when the lock turned interrupts off (they were on before) */
+#define irq_off_begin(lock, flags)              \
+do {                                            \
+    if ((flags) & IF_FLAG)                      \
+        (lock)->irq_off_tsc = rdtsc();          \
+} while (0)
+
+/* interrupts are about to come back on: keep the span if it is the longest */
+#define irq_off_end(lock, flags)                \
+do {                                            \
+    if ((flags) & IF_FLAG) {                    \
+        uint32_t _span = rdtsc() - (lock)->irq_off_tsc; \
+        if (_span > irq_off_max) {              \
+            irq_off_max = _span;                \
+            irq_off_max_name = (lock)->name;    \
+        }                                       \
+    }                                           \
+} while (0)
+#else
+#define irq_off_begin(lock, flags)  do { } while (0)
+#define irq_off_end(lock, flags)    do { } while (0)
+#endif
+
+/* Disable interrupts on this cpu, saving EFLAGS in flags, then take the lock */
+#define spin_lock_irqsave(lock, flags)          \
+do {                                            \
+    cli_and_save(flags);                        \
+    spin_lock(lock);                            \
+    irq_off_begin(lock, flags);                 \
+} while (0)
+
+/* Release the lock, then put the interrupt flag back as it was */
+#define spin_unlock_irqrestore(lock, flags)     \
+do {                                            \
+    irq_off_end(lock, flags);                   \
+    spin_unlock(lock);                          \
+    restore_flags(flags);                       \
+} while (0)
+
+#define ticket_lock_irqsave(lock, flags)        \
+do {                                            \
+    cli_and_save(flags);                        \
+    ticket_lock(lock);                          \
+    irq_off_begin(lock, flags);                 \
+} while (0)
+
+#define ticket_unlock_irqrestore(lock, flags)   \
+do {                                            \
+    irq_off_end(lock, flags);                   \
+    ticket_unlock(lock);                        \
+    restore_flags(flags);                       \
+} while (0)
+
 #endif /* _LIB_H */
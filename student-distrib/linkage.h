@@ -34,6 +34,44 @@ void keyboard_handler_wrapper();
 //rtc wrapper
 void rtc_handler_wrapper();
 
+//local apic wrappers
+void lapic_timer_handler_wrapper();
+void resched_ipi_handler_wrapper();
+void spurious_handler_wrapper();
+
+#else
+
+//Every entry from user mode leaves the registers on the kernel stack in the layout of
+//hw_context_t (signal.h): SAVE_ALL pushes them below the vector, the error code and the
+//cpu's iret frame, so the stack pointer then points at a hw_context_t.
+#define SAVE_ALL                    \
+        pushl %fs                   ;\
+        pushl %es                   ;\
+        pushl %ds                   ;\
+        pushl %eax                  ;\
+        pushl %ebp                  ;\
+        pushl %edi                  ;\
+        pushl %esi                  ;\
+        pushl %edx                  ;\
+        pushl %ecx                  ;\
+        pushl %ebx
+
+#define RESTORE_ALL                 \
+        popl %ebx                   ;\
+        popl %ecx                   ;\
+        popl %edx                   ;\
+        popl %esi                   ;\
+        popl %edi                   ;\
+        popl %ebp                   ;\
+        popl %eax                   ;\
+        popl %ds                    ;\
+        popl %es                    ;\
+        popl %fs
+
+#define HW_EAX          24          // offset of eax in hw_context_t
+#define NO_VECTOR       -1          // vector slot of a hardware interrupt
+#define SYS_CALL_VECTOR 0x80        // vector slot of a system call (int 0x80 or sysenter)
+
 #endif
 
 #endif
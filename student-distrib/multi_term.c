@@ -5,30 +5,26 @@ int32_t init_terminal(int idx) {
         
 
         if(idx >= 0 && idx < 3){
-            cli();
+            uint32_t flags;
             int j;
+            spin_lock_init(&terminal[idx].lock, (int8_t*)"terminal");
+            spin_lock_irqsave(&terminal[idx].lock, flags);
             for(j = 0; j < KBUF_SIZE; j++){
                 terminal[idx].kbuf[j] = NULL_CHAR;
                 terminal[idx].kbuf_entered[j] = NULL_CHAR;
             }
 
             terminal[idx].cur_kuf_size = 0;
+            terminal[idx].enter_flag = 0;
+            init_wait_queue(&terminal[idx].read_wq);
+            mutex_init(&terminal[idx].read_lock, (int8_t*)"terminal read");
+            mutex_init(&terminal[idx].write_lock, (int8_t*)"terminal write");
             terminal[idx].terminal_screen_x= 7;
             terminal[idx].terminal_screen_y= 1;
+            spin_unlock_irqrestore(&terminal[idx].lock, flags);
 
-            pcb_t* curr_pcb = get_pcb(schedule[active_term_idx]);
-            if(idx != 0){
-                uint32_t ebp;
-                asm volatile ("movl %%ebp, %0\n" :"=r"(ebp));
-                curr_pcb->kernel_ebp = ebp;
-                uint32_t esp;
-                asm volatile ("movl %%esp, %0\n" :"=r"(esp));
-                curr_pcb->kernel_esp = esp;
-            }
-            
-            active_term_idx = idx; //update active term idx
-            execute((uint8_t*)"shell");
-            sti();
+            //queue the terminal's shell, it starts when the scheduler picks it
+            start_shell(idx);
         }
     return 0;
 
@@ -36,7 +32,8 @@ int32_t init_terminal(int idx) {
 
 
 int32_t terminal_switch(int32_t from_idx, int32_t to_idx) {
-    cli();
+    uint32_t flags;
+    ticket_lock_irqsave(&screen_lock, flags);
 
     // store cursor position of terminal from_idx
     terminal[from_idx].terminal_screen_x = get_x();
@@ -54,7 +51,10 @@ int32_t terminal_switch(int32_t from_idx, int32_t to_idx) {
     //restore new terminal screen to video memory
     memcpy((uint8_t *) VIDEO_MEMORY_START, (uint8_t *)(VID_PAGE_T0 + (to_idx * PAGE_SIZE_4KB)), PAGE_SIZE_4KB);
 
-    sti();
+    //update current visible terminal idx; putc_term reads it under screen_lock
+    visible_term_idx = to_idx;
+
+    ticket_unlock_irqrestore(&screen_lock, flags);
     return 0;
 }
 
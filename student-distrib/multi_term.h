@@ -5,6 +5,8 @@
 #include "lib.h"
 #include "syscall.h"
 #include "page.h"
+#include "wait_queue.h"
+#include "sync.h"
 
 // current terminal
 #define NTERMS          3           //this supports max of 3 terminals        
@@ -13,10 +15,11 @@
 #define NULL_CHAR 0x00    
 
 int visible_term_idx; //visible terminal
-int active_term_idx; //terminal that has the active process
+#define active_term_idx (this_cpu()->term_idx) //terminal of the process running on this cpu
 int init_idx;
 //struct that holds info about each terminal
 typedef struct term{
+    spinlock_t lock;            //kbuf, kbuf_entered, cur_kuf_size and enter_flag
     int terminal_screen_x;
     int terminal_screen_y;
 
@@ -24,6 +27,17 @@ typedef struct term{
     char kbuf[KBUF_SIZE];
     int cur_kuf_size;
     int enter_flag;
+    wait_queue_t read_wq;       //terminal_read sleeps here until enter is pressed
+    mutex_t read_lock;          //one reader at a time gets each entered line
+    mutex_t write_lock;         //keeps the output of one write() together
+
+    //enter to reader wake up latency, recorded when a reader was already waiting
+    uint32_t enter_tsc;
+    int enter_timed;
+    uint32_t lat_samples;
+    uint32_t lat_min_us;
+    uint32_t lat_max_us;
+    uint32_t lat_total_us;
 
     int max_rtc_count;
     int rtc_count;
@@ -0,0 +1,77 @@
+#include "multicall.h"
+#include "signal.h"
+
+/*
+ * multicall_one
+ *   DESCRIPTION: run one record through the function its own trap would reach. halt does
+ *                not return to its caller, sigreturn needs the frame of its own trap and a
+ *                nested multicall could recurse without bound, so they fail with -1 like an
+ *                unknown number.
+ *   INPUTS: entry - the record, copied out of the program's memory
+ *   OUTPUTS: what the system call returned
+ */
+static int32_t multicall_one(multicall_entry_t* entry){
+    uint32_t count = jmp_table_end - jmp_table;
+    void* call;
+
+    if(entry->number < 1 || entry->number > count){
+        return -1;
+    }
+    call = (void*)jmp_table[entry->number - 1];
+    if(call == (void*)halt || call == (void*)sigreturn || call == (void*)multicall){
+        return -1;
+    }
+    return jmp_table[entry->number - 1](entry->args[0], entry->args[1], entry->args[2]);
+}
+
+/*
+ * multicall_run
+ *   DESCRIPTION: run a batch of independent system calls in order and store each one's
+ *                result in its record. A failing call does not stop the batch; the program
+ *                checks every result. Each call may sleep like its own trap would.
+ *   INPUTS: entries - the records
+ *           count - number of records
+ *   OUTPUTS: count
+ */
+int32_t multicall_run(multicall_entry_t* entries, int32_t count){
+    multicall_entry_t entry;
+    int32_t i;
+
+    for(i = 0; i < count; i++){
+        //copy first: another thread of the program may rewrite the record meanwhile
+        entry = entries[i];
+        entries[i].result = multicall_one(&entry);
+    }
+    multicall_ops += count;
+    return count;
+}
+
+/*
+ * multicall
+ *   DESCRIPTION: system call: run a batch of records in the user page (multicall_run), so
+ *                the whole batch costs one kernel entry instead of one per call
+ *   INPUTS: entries - the records, in the user page
+ *           count - number of records, 1 to MULTICALL_MAX
+ *   OUTPUTS: number of records run, -1 for a bad pointer or count
+ */
+int32_t multicall(multicall_entry_t* entries, int32_t count){
+    if(count < 1 || count > MULTICALL_MAX){
+        return -1;
+    }
+    if((uint32_t)entries < USER_MEM_START_VIR ||
+       (uint32_t)entries > USER_MEM_START_VIR + PAGE_SIZE_4MB - count * sizeof(multicall_entry_t)){
+        return -1;
+    }
+    multicalls++;
+    return multicall_run(entries, count);
+}
+
+/*
+ * print_multicall_stats
+ *   DESCRIPTION: print how many multicall traps ran how many system calls
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void print_multicall_stats(){
+    printf("multicalls: traps=%u calls=%u\n", multicalls, multicall_ops);
+}
@@ -0,0 +1,34 @@
+#ifndef _MULTICALL_H
+#define _MULTICALL_H
+
+#include "types.h"
+#include "lib.h"
+#include "syscall.h"
+
+#define MULTICALL_MAX       64          // records run by one multicall at most
+
+// One system call of a batch, in the program's memory
+typedef struct multicall_entry{
+    uint32_t number;            //system call number, as in eax for int 0x80
+    uint32_t args[3];           //its arguments, as in ebx, ecx and edx
+    int32_t result;             //kernel: what the system call returned
+} multicall_entry_t;
+
+// System call functions in the order of their numbers (syscall_linkage.S)
+extern int32_t (*jmp_table[])(uint32_t a, uint32_t b, uint32_t c);
+extern int32_t (*jmp_table_end[])(uint32_t a, uint32_t b, uint32_t c);
+
+//multicall traps and the system calls they ran (ctrl+s)
+uint32_t multicalls;
+uint32_t multicall_ops;
+
+//run count records of a batch in order and store their results; count
+int32_t multicall_run(multicall_entry_t* entries, int32_t count);
+
+//multicall_run on count records in the user page in order, one trap for all (system call)
+int32_t multicall(multicall_entry_t* entries, int32_t count);
+
+//print multicall counters (ctrl+s)
+void print_multicall_stats();
+
+#endif /* _MULTICALL_H */
@@ -102,5 +102,10 @@ void setup_page_table_entry(page_table_entry* entry, int present_, int read_writ
 // Initial Page tables and page directories.
 void setup_paging();
 
+// Switch to another page directory (flushes the non-global tlb entries).
+static inline void load_page_directory(int* dir) {
+    asm volatile ("movl %0, %%cr3" : : "r"(dir) : "memory");
+}
+
 #endif
 
@@ -0,0 +1,387 @@
+#include "pipe.h"
+#include "poll.h"
+#include "signal.h"
+
+//pool of pipes; an fd names one by its index
+static pipe_t pipes[MAX_PIPES];
+
+//in_use, readers and writers of every pipe
+static spinlock_t pipe_lock = SPINLOCK_INIT("pipes");
+
+static int32_t pipe_open(const uint8_t* filename);
+static int32_t pipe_read(int32_t fd, void* buf, int32_t nbytes);
+static int32_t pipe_write(int32_t fd, const void* buf, int32_t nbytes);
+static int32_t pipe_read_only(int32_t fd, const void* buf, int32_t nbytes);
+static int32_t pipe_write_only(int32_t fd, void* buf, int32_t nbytes);
+static int32_t pipe_close(int32_t fd);
+static void pipe_dup(file_descriptor_t* file);
+static uint32_t pipe_read_poll(int32_t fd, poll_table_t* pt);
+static uint32_t pipe_write_poll(int32_t fd, poll_table_t* pt);
+
+/*
+ * init_pipes
+ *   DESCRIPTION: mark every pipe free and fill in the op tables of the two ends
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void init_pipes(){
+    uint32_t i;
+    for(i = 0; i < MAX_PIPES; i++){
+        pipes[i].in_use = 0;
+    }
+
+    pipe_read_op.open = pipe_open;
+    pipe_read_op.read = pipe_read;
+    pipe_read_op.write = pipe_read_only;
+    pipe_read_op.close = pipe_close;
+    pipe_read_op.dup = pipe_dup;
+    pipe_read_op.poll = pipe_read_poll;
+
+    pipe_write_op.open = pipe_open;
+    pipe_write_op.read = pipe_write_only;
+    pipe_write_op.write = pipe_write;
+    pipe_write_op.close = pipe_close;
+    pipe_write_op.dup = pipe_dup;
+    pipe_write_op.poll = pipe_write_poll;
+}
+
+/*
+ * pipe_alloc
+ *   DESCRIPTION: take a free pipe from the pool with an empty ring, one reader and one writer
+ *   INPUTS: none
+ *   OUTPUTS: the pipe, NULL if all MAX_PIPES are in use
+ */
+pipe_t* pipe_alloc(){
+    uint32_t flags;
+    uint32_t i;
+    pipe_t* p;
+
+    spin_lock_irqsave(&pipe_lock, flags);
+    for(i = 0; i < MAX_PIPES; i++){
+        if(!pipes[i].in_use){
+            break;
+        }
+    }
+    if(i == MAX_PIPES){
+        spin_unlock_irqrestore(&pipe_lock, flags);
+        return NULL;
+    }
+    p = &pipes[i];
+    p->in_use = 1;
+    p->readers = 1;
+    p->writers = 1;
+    spin_unlock_irqrestore(&pipe_lock, flags);
+
+    p->head = 0;
+    p->tail = 0;
+    init_wait_queue(&p->read_wq);
+    init_wait_queue(&p->write_wq);
+    mutex_init(&p->read_lock, (int8_t*)"pipe read");
+    mutex_init(&p->write_lock, (int8_t*)"pipe write");
+    return p;
+}
+
+/*
+ * pipe_release
+ *   DESCRIPTION: drop one reference to an end of a pipe and wake the other side, which may now
+ *                see end of file (no writers) or a broken pipe (no readers). The pipe goes back
+ *                to the pool when both ends are gone.
+ *   INPUTS: p - the pipe
+ *           writer - 1 to drop a write end, 0 for a read end
+ *   OUTPUTS: none
+ */
+void pipe_release(pipe_t* p, uint32_t writer){
+    uint32_t flags;
+
+    spin_lock_irqsave(&pipe_lock, flags);
+    if(writer){
+        p->writers--;
+    }
+    else{
+        p->readers--;
+    }
+    if(p->readers == 0 && p->writers == 0){
+        p->in_use = 0;
+        spin_unlock_irqrestore(&pipe_lock, flags);
+        return;
+    }
+    spin_unlock_irqrestore(&pipe_lock, flags);
+
+    wake_up(writer ? &p->read_wq : &p->write_wq);
+}
+
+/*
+ * pipe_get
+ *   DESCRIPTION: copy what the pipe holds, up to nbytes, sleeping while it is empty and a
+ *                writer is left. Returns as soon as some bytes were copied, like a terminal
+ *                read returns after one line.
+ *   INPUTS: p - the pipe
+ *           buf - destination
+ *           nbytes - most bytes to copy
+ *   OUTPUTS: bytes copied, 0 at end of file (empty and no writer left)
+ */
+int32_t pipe_get(pipe_t* p, uint8_t* buf, int32_t nbytes){
+    uint32_t flags;
+    uint32_t head;
+    uint32_t avail;
+    uint32_t first;
+
+    if(nbytes <= 0){
+        return 0;
+    }
+
+    mutex_lock(&p->read_lock);
+    //the writer moves tail before it wakes us under read_wq.lock, so checking under the
+    //lock cannot miss a wake up
+    spin_lock_irqsave(&p->read_wq.lock, flags);
+    while(p->tail == p->head && p->writers != 0 && !signal_pending()){
+        sleep_on_locked(&p->read_wq, 0);
+    }
+    spin_unlock_irqrestore(&p->read_wq.lock, flags);
+    if(p->tail == p->head && p->writers != 0){
+        mutex_unlock(&p->read_lock);
+        return -1;
+    }
+
+    head = p->head;
+    avail = p->tail - head;
+    if(avail > (uint32_t)nbytes){
+        avail = nbytes;
+    }
+    first = PIPE_SIZE - (head & PIPE_MASK);
+    if(first > avail){
+        first = avail;
+    }
+    memcpy(buf, &p->buf[head & PIPE_MASK], first);
+    memcpy(buf + first, p->buf, avail - first);
+    //the bytes are out before the writer may reuse their slots
+    asm volatile ("" : : : "memory");
+    p->head = head + avail;
+    mutex_unlock(&p->read_lock);
+
+    if(avail != 0){
+        wake_up(&p->write_wq);
+    }
+    return avail;
+}
+
+/*
+ * pipe_put
+ *   DESCRIPTION: copy nbytes into the pipe, sleeping whenever it is full, and wake the reader
+ *                after every chunk so it can drain the ring while we fill it
+ *   INPUTS: p - the pipe
+ *           buf - source
+ *           nbytes - bytes to copy
+ *   OUTPUTS: nbytes, fewer if the last reader went away part way, -1 if no reader is left
+ */
+int32_t pipe_put(pipe_t* p, const uint8_t* buf, int32_t nbytes){
+    uint32_t flags;
+    uint32_t tail;
+    uint32_t space;
+    uint32_t first;
+    int32_t done = 0;
+
+    mutex_lock(&p->write_lock);
+    while(done < nbytes){
+        spin_lock_irqsave(&p->write_wq.lock, flags);
+        while(p->tail - p->head == PIPE_SIZE && p->readers != 0 && !signal_pending()){
+            sleep_on_locked(&p->write_wq, 0);
+        }
+        spin_unlock_irqrestore(&p->write_wq.lock, flags);
+        if(p->readers == 0 || p->tail - p->head == PIPE_SIZE){
+            break;
+        }
+
+        tail = p->tail;
+        space = PIPE_SIZE - (tail - p->head);
+        if(space > (uint32_t)(nbytes - done)){
+            space = nbytes - done;
+        }
+        first = PIPE_SIZE - (tail & PIPE_MASK);
+        if(first > space){
+            first = space;
+        }
+        memcpy(&p->buf[tail & PIPE_MASK], buf + done, first);
+        memcpy(p->buf, buf + done + first, space - first);
+        //the bytes are in before the reader may see them
+        asm volatile ("" : : : "memory");
+        p->tail = tail + space;
+        done += space;
+        wake_up(&p->read_wq);
+    }
+    mutex_unlock(&p->write_lock);
+
+    if(done == 0 && nbytes != 0){
+        return -1;
+    }
+    return done;
+}
+
+/*
+ * pipe
+ *   DESCRIPTION: system call: create a pipe and open both of its ends in the current process.
+ *                Bytes written to fds[1] are read from fds[0] in order.
+ *   INPUTS: fds - two ints in the user page, filled with the read and the write fd
+ *   OUTPUTS: 0 on success, -1 for a bad pointer or if no pipe or fd is free
+ */
+int32_t pipe(int32_t* fds){
+    pcb_t* group = get_pcb(curr_pid)->group;
+    file_descriptor_t* fd_array = group->fd_array;
+    int32_t ends[2];
+    uint32_t n = 0;
+    uint32_t i;
+    pipe_t* p;
+
+    if((uint32_t)fds < USER_MEM_START_VIR ||
+       (uint32_t)fds > USER_MEM_START_VIR + PAGE_SIZE_4MB - 2 * sizeof(int32_t)){
+        return -1;
+    }
+
+    mutex_lock(&group->fd_lock);
+    for(i = 0; i < MAX_FILES && n < 2; i++){
+        if(fd_array[i].flags == FD_UNUSED){
+            ends[n++] = i;
+        }
+    }
+    if(n < 2 || (p = pipe_alloc()) == NULL){
+        mutex_unlock(&group->fd_lock);
+        return -1;
+    }
+
+    fd_array[ends[0]].file_op_table_ptr = &pipe_read_op;
+    fd_array[ends[1]].file_op_table_ptr = &pipe_write_op;
+    for(i = 0; i < 2; i++){
+        fd_array[ends[i]].inode = p - pipes;
+        fd_array[ends[i]].file_pos = 0;
+        fd_array[ends[i]].flags = FD_USED;
+    }
+    mutex_unlock(&group->fd_lock);
+
+    fds[0] = ends[0];
+    fds[1] = ends[1];
+    return 0;
+}
+
+/*
+ * pipe_open
+ *   DESCRIPTION: pipes have no name in the file system, only pipe() makes them
+ *   INPUTS: filename - ignored
+ *   OUTPUTS: -1
+ */
+static int32_t pipe_open(const uint8_t* filename){
+    return -1;
+}
+
+/*
+ * pipe_read
+ *   DESCRIPTION: read() on the read end of a pipe
+ *   INPUTS: fd - the read end
+ *           buf - user buffer
+ *           nbytes - most bytes to read
+ *   OUTPUTS: bytes read, 0 at end of file
+ */
+static int32_t pipe_read(int32_t fd, void* buf, int32_t nbytes){
+    file_descriptor_t* file = &get_pcb(curr_pid)->group->fd_array[fd];
+    return pipe_get(&pipes[file->inode], (uint8_t*)buf, nbytes);
+}
+
+/*
+ * pipe_write
+ *   DESCRIPTION: write() on the write end of a pipe. A non-blocking end only writes what fits
+ *                now (write() already checked that something does).
+ *   INPUTS: fd - the write end
+ *           buf - user buffer
+ *           nbytes - bytes to write
+ *   OUTPUTS: bytes written, -1 if the read end is closed
+ */
+static int32_t pipe_write(int32_t fd, const void* buf, int32_t nbytes){
+    file_descriptor_t* file = &get_pcb(curr_pid)->group->fd_array[fd];
+    pipe_t* p = &pipes[file->inode];
+    uint32_t space;
+
+    if((file->flags & FD_NONBLOCK) && p->readers != 0){
+        space = PIPE_SIZE - (p->tail - p->head);
+        if(nbytes > 0 && space < (uint32_t)nbytes){
+            nbytes = space;
+        }
+    }
+    return pipe_put(p, (const uint8_t*)buf, nbytes);
+}
+
+//the read end cannot be written
+static int32_t pipe_read_only(int32_t fd, const void* buf, int32_t nbytes){
+    return -1;
+}
+
+//the write end cannot be read
+static int32_t pipe_write_only(int32_t fd, void* buf, int32_t nbytes){
+    return -1;
+}
+
+/*
+ * pipe_close
+ *   DESCRIPTION: close() of either end; called while fd still names the pipe
+ *   INPUTS: fd - the end being closed
+ *   OUTPUTS: 0
+ */
+static int32_t pipe_close(int32_t fd){
+    file_descriptor_t* file = &get_pcb(curr_pid)->group->fd_array[fd];
+    pipe_release(&pipes[file->inode], file->file_op_table_ptr == &pipe_write_op);
+    return 0;
+}
+
+/*
+ * pipe_dup
+ *   DESCRIPTION: another fd (possibly of another process) now refers to the same end
+ *   INPUTS: file - the new copy of the fd
+ *   OUTPUTS: none
+ */
+static void pipe_dup(file_descriptor_t* file){
+    uint32_t flags;
+    pipe_t* p = &pipes[file->inode];
+
+    spin_lock_irqsave(&pipe_lock, flags);
+    if(file->file_op_table_ptr == &pipe_write_op){
+        p->writers++;
+    }
+    else{
+        p->readers++;
+    }
+    spin_unlock_irqrestore(&pipe_lock, flags);
+}
+
+/*
+ * pipe_read_poll
+ *   DESCRIPTION: poll op of the read end: readable while the ring holds bytes or no writer
+ *                is left (read returns end of file). pipe_put and pipe_release wake read_wq.
+ *   INPUTS: fd - the read end
+ *           pt - poll() entries to register with read_wq, NULL to only check
+ *   OUTPUTS: POLLIN if a read would not block, 0 otherwise
+ */
+static uint32_t pipe_read_poll(int32_t fd, poll_table_t* pt){
+    pipe_t* p = &pipes[get_pcb(curr_pid)->group->fd_array[fd].inode];
+
+    poll_wait(pt, &p->read_wq);
+    if(p->tail != p->head || p->writers == 0){
+        return POLLIN;
+    }
+    return 0;
+}
+
+/*
+ * pipe_write_poll
+ *   DESCRIPTION: poll op of the write end: writable while the ring has room or no reader
+ *                is left (write fails at once). pipe_get and pipe_release wake write_wq.
+ *   INPUTS: fd - the write end
+ *           pt - poll() entries to register with write_wq, NULL to only check
+ *   OUTPUTS: POLLOUT if a write would not block before copying a byte, 0 otherwise
+ */
+static uint32_t pipe_write_poll(int32_t fd, poll_table_t* pt){
+    pipe_t* p = &pipes[get_pcb(curr_pid)->group->fd_array[fd].inode];
+
+    poll_wait(pt, &p->write_wq);
+    if(p->tail - p->head != PIPE_SIZE || p->readers == 0){
+        return POLLOUT;
+    }
+    return 0;
+}
@@ -0,0 +1,51 @@
+#ifndef _PIPE_H
+#define _PIPE_H
+
+#include "types.h"
+#include "lib.h"
+#include "syscall.h"
+
+#define PIPE_SIZE           4096        // bytes buffered per pipe (power of two)
+#define PIPE_MASK           (PIPE_SIZE - 1)
+#define MAX_PIPES           16          // pipes open at once in the whole system
+
+/* Single-producer/single-consumer ring between the write end and the read end.
+ * head and tail count bytes ever read and written; the reader only moves head and
+ * the writer only moves tail, so the data path takes no lock. Several processes
+ * holding the same end take turns through read_lock / write_lock. */
+typedef struct pipe{
+    uint8_t buf[PIPE_SIZE];
+    volatile uint32_t head;     //bytes read so far (reader)
+    volatile uint32_t tail;     //bytes written so far (writer)
+    uint32_t readers;           //open read ends; writes fail once it drops to 0
+    uint32_t writers;           //open write ends; reads see end of file once it drops to 0
+    uint32_t in_use;
+    wait_queue_t read_wq;       //readers sleep here while the ring is empty
+    wait_queue_t write_wq;      //writers sleep here while the ring is full
+    mutex_t read_lock;
+    mutex_t write_lock;
+} pipe_t;
+
+// Operator tables of the two ends; fd_array[fd].inode holds the pipe's index
+file_op_table_t pipe_read_op;
+file_op_table_t pipe_write_op;
+
+//set up the pipe pool and the pipe op tables
+void init_pipes();
+
+//take a free pipe with one reader and one writer, NULL if all are in use
+pipe_t* pipe_alloc();
+
+//drop one reference to an end (writer 1 for the write end); frees the pipe after the last one
+void pipe_release(pipe_t* p, uint32_t writer);
+
+//copy up to nbytes out of the pipe, sleeping while it is empty; 0 at end of file
+int32_t pipe_get(pipe_t* p, uint8_t* buf, int32_t nbytes);
+
+//copy nbytes into the pipe, sleeping while it is full; -1 if nobody can read it
+int32_t pipe_put(pipe_t* p, const uint8_t* buf, int32_t nbytes);
+
+//create a pipe and store its read and write fds in fds[0] and fds[1] (system call)
+int32_t pipe(int32_t* fds);
+
+#endif /* _PIPE_H */
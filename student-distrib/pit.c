@@ -1,13 +1,46 @@
 #include "pit.h"
+#include "kdata.h"
 
+//multilevel feedback queue: every cpu has one FIFO of ready processes per priority level
+//(cpu_t.run_queues)
 
-void init_pit(){
+//time slice (in PIT ticks) a process may use at each level before it is demoted
+static const uint32_t level_quantum[SCHED_LEVELS] = {1, 2, 4};
+
+//idle cpus are woken to steal at most this often (ticks), so a busy system does not send an ipi per wake up
+static uint32_t last_idle_kick;
+
+static void kick_idle_cpu();
+static uint32_t time_slice(pcb_t* pcb);
+static uint32_t cpu_ready_count(cpu_t* cpu);
+static void update_load(cpu_t* cpu);
+
+//ticks left until the next priority_boost()
+static uint32_t boost_countdown;
+
+//1 while channel 0 runs a one-shot instead of the periodic tick
+static uint32_t tickless_active;
+
+//tsc value at the last tick accounted in pit_ticks
+static uint32_t last_tick_tsc;
+
+/* 
+ * pit_set_periodic
+ *   DESCRIPTION: program channel 0 to fire every 10ms in mode 3
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+static void pit_set_periodic(){
     int reload_val;
     reload_val = INPUT_FREQ/PIT_FREQ;
 
     outb(PIT_MODE, PIT_CMD_REG);
     outb(reload_val & 0xFF, PIT_CH0);   //moving lower byte
     outb(reload_val >> 8, PIT_CH0);     //moving higher byte
+}
+
+void init_pit(){
+    pit_set_periodic();
 
     active_term_idx = 0;
     visible_term_idx = 0;
@@ -18,33 +51,783 @@ void init_pit(){
     for(j = 0; j < NTERMS; j++){
         schedule[j] = -1;
     }
+    //the boot context becomes the idle task once interrupts are on
+    curr_pid = IDLE_PID;
+
+    for(j = 0; j < MAX_CPUS * SCHED_LEVELS; j++){
+        run_queue_t* rq = &cpus[j / SCHED_LEVELS].run_queues[j % SCHED_LEVELS];
+        rq->head = NULL;
+        rq->tail = NULL;
+        rq->count = 0;
+    }
+    boost_countdown = SCHED_BOOST_TICKS;
+    tickless_active = 0;
+    pit_ticks = 0;
+    pit_irq_count = 0;
+    idle_halts = 0;
+
+    calibrate_tsc();
+    last_tick_tsc = rdtsc();
+    init_timers();
 
     enable_irq(PIT_IRQ);
 }
 
+/* 
+ * calibrate_tsc
+ *   DESCRIPTION: count tsc cycles while PIT channel 2 counts down one tick in mode 0,
+ *                so cycle counts (e.g. input latency) can be reported in microseconds
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void calibrate_tsc(){
+    uint32_t reload_val = INPUT_FREQ/PIT_FREQ;
+    uint32_t start;
+
+    //gate channel 2 on, keep the speaker off
+    outb((inb(PIT_CH2_GATE) & ~0x02) | 0x01, PIT_CH2_GATE);
+
+    outb(PIT_CH2_MODE, PIT_CMD_REG);
+    outb(reload_val & 0xFF, PIT_CH2);   //moving lower byte
+    outb(reload_val >> 8, PIT_CH2);     //moving higher byte, counting starts
+
+    start = rdtsc();
+    while(!(inb(PIT_CH2_GATE) & PIT_CH2_OUT)){};   //output goes high at terminal count
+    tsc_per_tick = rdtsc() - start;
+    if(tsc_per_tick == 0){
+        tsc_per_tick = 1;
+    }
+}
+
 void pit_handler(){
    //printf("hi");
    send_eoi(PIT_IRQ);
+   pit_irq_count++;
+
+    //a one-shot fired while the idle task was halted: count the ticks it covered
+    if(tickless_active){
+        tickless_exit();
+    }
+    else{
+        pit_ticks++;
+        last_tick_tsc = rdtsc();
+    }
+    kdata_tick(pit_ticks, last_tick_tsc);
+    run_timers();
    
     if(i < 2){
         i++;
         init_terminal(i);
+        //run the new shell now if it was placed on this cpu; the process we interrupted
+        //goes back in line (make_ready ignores the idle task)
+        pcb_t* curr_pcb = get_pcb(curr_pid);
+        cli();
+        if(curr_pcb->state == PROC_RUNNING){
+            make_ready(curr_pcb);
+        }
+        reschedule();
+        sti();
+    }
+
+    else{
+        //periodically lift everyone to the top so cpu hogs cannot starve forever
+        if(--boost_countdown == 0){
+            boost_countdown = SCHED_BOOST_TICKS;
+            priority_boost();
+        }
+        scheduler_tick();
+    }
+}
+
+/* 
+ * scheduler_tick
+ *   DESCRIPTION: MLFQ accounting for one tick of this cpu: charge it to the running process,
+ *                demote the process once its quantum is used up and switch to the first
+ *                process of this cpu's run queue if that one should run instead.
+ *                Called from the timer interrupt handlers with interrupts disabled.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void scheduler_tick(){
+    pcb_t* curr_pcb = get_pcb(curr_pid);
+    uint32_t expired = 0;
+    uint32_t top_level;
+
+    this_cpu()->ticks++;
+    update_load(this_cpu());
+
+    //charge the tick to the running process; a used up quantum means a cpu hog, demote it
+    if(curr_pid != IDLE_PID && curr_pcb->state == PROC_RUNNING){
+        curr_pcb->ticks_used++;
+        if(curr_pcb->ticks_used >= time_slice(curr_pcb)){
+            curr_pcb->ticks_used = 0;
+            if(curr_pcb->level < SCHED_LEVELS - 1){
+                curr_pcb->level++;
+            }
+            expired = 1;
+        }
+    }
+
+    top_level = run_queue_top_level();
+
+    //nobody is waiting for the cpu: keep the current process (or the idle task)
+    if(top_level == SCHED_LEVELS){
+        return;
+    }
+
+    //keep running unless the slice is over or someone more important is waiting
+    //(the idle task sits below every level, so anything ready replaces it)
+    if(curr_pcb->state == PROC_RUNNING){
+        if(top_level > curr_pcb->level || (top_level == curr_pcb->level && !expired)){
+            return;
+        }
+        make_ready(curr_pcb);
     }
 
+    cli();
+    switch_to_process(run_queue_pop());
+    sti();
+}
+
+/* 
+ * run_queue_push
+ *   DESCRIPTION: append a process to the tail of the run queue of its priority level on
+ *                the cpu it is placed on
+ *   INPUTS: pcb - process to queue (must not already be queued)
+ *   OUTPUTS: none
+ */
+void run_queue_push(pcb_t* pcb){
+    run_queue_t* rq = &cpus[pcb->cpu].run_queues[pcb->level];
+    pcb->run_next = NULL;
+    if(rq->tail == NULL){
+        rq->head = pcb;
+    }
     else{
-        //printf("switch pit handler%d\n", active_term_idx);
-        
-        int old_term_idx = active_term_idx;
-        active_term_idx = (active_term_idx + 1)%3;  //get the next scheduled terminal idx
+        rq->tail->run_next = pcb;
+    }
+    rq->tail = pcb;
+    rq->count++;
+}
+
+/* 
+ * run_queue_pop
+ *   DESCRIPTION: remove and return the first process of the highest non-empty priority level
+ *                of this cpu
+ *   INPUTS: none
+ *   OUTPUTS: the next process to run, NULL if no process is ready
+ */
+pcb_t* run_queue_pop(){
+    uint32_t level = run_queue_top_level();
+    run_queue_t* rq;
+    pcb_t* pcb;
+    if(level == SCHED_LEVELS){
+        return NULL;
+    }
+    rq = &this_cpu()->run_queues[level];
+    pcb = rq->head;
+    rq->head = pcb->run_next;
+    if(rq->head == NULL){
+        rq->tail = NULL;
+    }
+    pcb->run_next = NULL;
+    rq->count--;
+    return pcb;
+}
+
+/* 
+ * run_queue_top_level
+ *   DESCRIPTION: find the highest priority level that has a ready process on this cpu
+ *   INPUTS: none
+ *   OUTPUTS: level index, SCHED_LEVELS if every queue is empty
+ */
+uint32_t run_queue_top_level(){
+    run_queue_t* run_queues = this_cpu()->run_queues;
+    uint32_t level;
+    for(level = 0; level < SCHED_LEVELS; level++){
+        if(run_queues[level].head != NULL){
+            return level;
+        }
+    }
+    return SCHED_LEVELS;
+}
+
+/* 
+ * run_queue_remove
+ *   DESCRIPTION: unlink a process from anywhere in the run queues (e.g. it is halted while ready)
+ *   INPUTS: pcb - process to remove
+ *   OUTPUTS: none
+ */
+void run_queue_remove(pcb_t* pcb){
+    run_queue_t* rq = &cpus[pcb->cpu].run_queues[pcb->level];
+    pcb_t* prev = NULL;
+    pcb_t* curr;
+    for(curr = rq->head; curr != NULL; prev = curr, curr = curr->run_next){
+        if(curr == pcb){
+            if(prev == NULL){
+                rq->head = curr->run_next;
+            }
+            else{
+                prev->run_next = curr->run_next;
+            }
+            if(rq->tail == curr){
+                rq->tail = prev;
+            }
+            curr->run_next = NULL;
+            rq->count--;
+            return;
+        }
+    }
+}
+
+/* 
+ * make_ready
+ *   DESCRIPTION: mark a running or blocked process ready and append it to the run queue of
+ *                its cpu, interrupting that cpu if it is another one (it may be halted).
+ *                The idle task is never queued. Safe to call from interrupt handlers.
+ *   INPUTS: pcb - process that may run again
+ *   OUTPUTS: none
+ */
+void make_ready(pcb_t* pcb){
+    uint32_t flags;
+    if(pcb->pid == IDLE_PID){
+        return;
+    }
+    cli_and_save(flags);
+    if(pcb->state == PROC_RUNNING || pcb->state == PROC_BLOCKED){
+        pcb->state = PROC_READY;
+        run_queue_push(pcb);
+        smp_send_resched(pcb->cpu);
+        //its cpu is busy: an idle one may take the process
+        if(cpus[pcb->cpu].running_pid != IDLE_PID){
+            kick_idle_cpu();
+        }
+    }
+    restore_flags(flags);
+}
+
+/* 
+ * kick_idle_cpu
+ *   DESCRIPTION: wake one idle cpu with an empty run queue so it tries to steal work
+ *                (see steal_work). At most once per tick.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+static void kick_idle_cpu(){
+    uint32_t k;
+    if(nr_cpus == 1 || last_idle_kick == pit_ticks){
+        return;
+    }
+    for(k = 0; k < nr_cpus; k++){
+        if(k != this_cpu()->id && cpus[k].online && cpus[k].running_pid == IDLE_PID && cpu_ready_count(&cpus[k]) == 0){
+            last_idle_kick = pit_ticks;
+            smp_send_resched(k);
+            return;
+        }
+    }
+}
+
+/* 
+ * cpu_ready_count
+ *   DESCRIPTION: number of ready processes on the run queues of a cpu
+ *   INPUTS: cpu - the cpu
+ *   OUTPUTS: ready process count
+ */
+static uint32_t cpu_ready_count(cpu_t* cpu){
+    uint32_t level;
+    uint32_t count = 0;
+    for(level = 0; level < SCHED_LEVELS; level++){
+        count += cpu->run_queues[level].count;
+    }
+    return count;
+}
+
+/* 
+ * update_load
+ *   DESCRIPTION: decay a cpu's load average once for every tick since its last update, with
+ *                the number of processes it runs or has ready now (an idle cpu without a
+ *                tick catches up when it wakes)
+ *   INPUTS: cpu - the cpu
+ *   OUTPUTS: none
+ */
+static void update_load(cpu_t* cpu){
+    uint32_t elapsed = pit_ticks - cpu->load_tick;
+    uint32_t runnable = cpu_ready_count(cpu) + (cpu->running_pid != IDLE_PID);
+
+    cpu->load_tick = pit_ticks;
+    if(elapsed > LOAD_DECAY_MAX_TICKS){
+        elapsed = LOAD_DECAY_MAX_TICKS;
+    }
+    while(elapsed-- > 0){
+        cpu->load_avg = cpu->load_avg - cpu->load_avg / LOAD_DECAY + (runnable * LOAD_SCALE) / LOAD_DECAY;
+    }
+}
+
+/* 
+ * steal_work
+ *   DESCRIPTION: called by an idle cpu whose run queue is empty: take one ready process from
+ *                the peer with the most of them. Processes are taken from the lowest priority
+ *                level first; one that migrated less than STEAL_COOLDOWN_TICKS ago is left
+ *                alone so processes do not ping-pong, and so is the fpu owner of its cpu
+ *                (its registers cannot be saved from here). The cycles spent are counted
+ *                as the migration cost. Call with interrupts disabled and the kernel lock held.
+ *   INPUTS: none
+ *   OUTPUTS: 1 if a process was moved to this cpu's run queue, 0 otherwise
+ */
+uint32_t steal_work(){
+    cpu_t* cpu = this_cpu();
+    cpu_t* victim = NULL;
+    uint32_t start = rdtsc();
+    uint32_t most = 0;
+    uint32_t count;
+    uint32_t k;
+    int32_t level;
+    pcb_t* pcb;
 
+    for(k = 0; k < nr_cpus; k++){
+        count = cpu_ready_count(&cpus[k]);
+        if(k != cpu->id && cpus[k].online && count > most){
+            most = count;
+            victim = &cpus[k];
+        }
+    }
+    if(victim == NULL){
+        return 0;
+    }
+
+    for(level = SCHED_LEVELS - 1; level >= 0; level--){
+        for(pcb = victim->run_queues[level].head; pcb != NULL; pcb = pcb->run_next){
+            if(pcb == victim->fpu_owner){
+                continue;
+            }
+            if(pcb->migrations != 0 && pit_ticks - pcb->migrate_tick < STEAL_COOLDOWN_TICKS){
+                continue;
+            }
+            run_queue_remove(pcb);
+            smp_move_process(pcb, cpu->id);
+            run_queue_push(pcb);
+            pcb->migrations++;
+            pcb->migrate_tick = pit_ticks;
+            cpu->steals++;
+            victim->stolen++;
+            cpu->steal_cycles += rdtsc() - start;
+            return 1;
+        }
+    }
+    cpu->steal_cycles += rdtsc() - start;
+    return 0;
+}
+
+/* 
+ * switch_to_process
+ *   DESCRIPTION: make next the running process of this cpu and switch kernel stacks to it.
+ *                The current process must already be queued, blocked or halting. Returns when
+ *                the current process is scheduled again; the kernel lock is held throughout
+ *                and each process gets back the depth it held it at.
+ *                Call with interrupts disabled.
+ *   INPUTS: next - process taken off this cpu's run queue (or its idle task)
+ *   OUTPUTS: none
+ */
+void switch_to_process(pcb_t* next){
+    uint32_t prev_pid = curr_pid;
+    //looked up once, before anything below can make the pid go away
+    pcb_t* prev = get_pcb(prev_pid);
+    uint32_t lock_depth;
+
+    next->state = PROC_RUNNING;
+    //the current process was woken before anyone else got the cpu, just keep running it
+    if(next->pid == prev_pid){
+        return;
+    }
+
+    //leaving the idle task from an interrupt handler: the tick is needed again
+    if(prev_pid == IDLE_PID){
+        tickless_exit();
+    }
+
+    //a thread its main thread waits to free is off the cpu now. A zombie is
+    //past that, its own halt path or reap_zombie frees it
+    if(prev_pid != IDLE_PID && prev->state != PROC_ZOMBIE && prev->kill_pending){
+        wake_up(&prev->group->thread_wq);
+    }
+
+    curr_pid = next->pid;
+    //the idle task never prints, keep the terminal of the process that ran last
+    if(next->pid != IDLE_PID){
+        active_term_idx = next->term_idx;
+    }
+    this_cpu()->switches++;
+
+    lock_depth = kernel_lock_depth();
+    process_switch(prev, next);
+    kernel_lock_set_depth(lock_depth);
+    //an orphan that halted on this cpu switched here for the last time
+    reap_zombie();
+}
+
+/* 
+ * reschedule
+ *   DESCRIPTION: called in a loop by sleep_on() while the current process is blocked.
+ *                Switches to the next ready process of this cpu, or to its idle task when
+ *                the run queue is empty. Called and returns with interrupts disabled.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void reschedule(){
+    pcb_t* next_pcb = run_queue_pop();
+
+    if(next_pcb == NULL){
+        next_pcb = get_pcb(IDLE_PID);
+    }
+
+    switch_to_process(next_pcb);
+}
+
+/* 
+ * preempt_check
+ *   DESCRIPTION: called at the end of the keyboard and rtc handlers (after their EOI). If the
+ *                wake up they did made a process of higher priority than the running one ready,
+ *                switch to it now instead of waiting up to a full tick. Call with interrupts disabled.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void preempt_check(){
+    pcb_t* curr_pcb;
+
+    //terminals are still being launched by pit_handler
+    if(i < 2){
+        return;
+    }
+    curr_pcb = get_pcb(curr_pid);
+    //we interrupted a process on its way to sleep, reschedule() picks the new process itself
+    if(curr_pcb->state != PROC_RUNNING){
+        return;
+    }
+    if(run_queue_top_level() >= curr_pcb->level){
+        return;
+    }
+    make_ready(curr_pcb);
+    switch_to_process(run_queue_pop());
+}
+
+/* 
+ * priority_boost
+ *   DESCRIPTION: move every process of every cpu back to level 0 (or the top level its nice
+ *                value allows) with a fresh allotment, keeping the order of the ready processes
+ *                (higher levels first)
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void priority_boost(){
+    uint32_t level;
+    uint32_t k;
+    uint32_t count;
+    pcb_t* pcb;
+
+    for(k = 0; k < nr_cpus; k++){
+        for(level = 1; level < SCHED_LEVELS; level++){
+            //a niced process may go back to the tail of the same level, so visit each once
+            count = cpus[k].run_queues[level].count;
+            while(count-- > 0){
+                pcb = cpus[k].run_queues[level].head;
+                run_queue_remove(pcb);
+                pcb->level = sched_top_level(pcb);
+                run_queue_push(pcb);
+            }
+        }
+    }
+
+    //running and blocked processes are not queued, reset them directly
+    for_each_process(pcb){
+        pcb->level = sched_top_level(pcb);
+        pcb->ticks_used = 0;
+    }
+}
+
+/* 
+ * sched_top_level
+ *   DESCRIPTION: highest priority level a process may be lifted to: level 0, or lower for a
+ *                positive nice value
+ *   INPUTS: pcb - the process
+ *   OUTPUTS: the level
+ */
+uint32_t sched_top_level(pcb_t* pcb){
+    if(pcb->nice <= 0){
+        return 0;
+    }
+    if(pcb->nice >= SCHED_LEVELS - 1){
+        return SCHED_LEVELS - 1;
+    }
+    return pcb->nice;
+}
+
+/* 
+ * time_slice
+ *   DESCRIPTION: ticks a process may run at its level before it is demoted: the level's
+ *                quantum, doubled for every step of negative nice
+ *   INPUTS: pcb - the process
+ *   OUTPUTS: the slice in ticks
+ */
+static uint32_t time_slice(pcb_t* pcb){
+    if(pcb->nice < 0){
+        return level_quantum[pcb->level] << -pcb->nice;
+    }
+    return level_quantum[pcb->level];
+}
+
+/* 
+ * yield
+ *   DESCRIPTION: system call: give the cpu to the next ready process of the same or a higher
+ *                priority level on this cpu. The caller goes to the tail of its level and keeps
+ *                the part of its slice it used, so yielding cannot be used to stay on top.
+ *                Returns at once if nobody else is ready.
+ *   INPUTS: none
+ *   OUTPUTS: 0
+ */
+int32_t yield(){
+    pcb_t* curr_pcb = get_pcb(curr_pid);
+    uint32_t flags;
+
+    cli_and_save(flags);
+    if(run_queue_top_level() <= curr_pcb->level){
+        this_cpu()->yields++;
+        make_ready(curr_pcb);
+        switch_to_process(run_queue_pop());
+    }
+    restore_flags(flags);
+    return 0;
+}
+
+/* 
+ * nice
+ *   DESCRIPTION: system call: add inc to the nice value of the current process, clamped to
+ *                NICE_MIN..NICE_MAX. Negative values lengthen the time slice at every level
+ *                (2x per step); positive values keep the process below the top levels (it is
+ *                never lifted above level nice). Threads and children created later inherit it.
+ *   INPUTS: inc - change of the nice value
+ *   OUTPUTS: the new nice value
+ */
+int32_t nice(int32_t inc){
+    pcb_t* curr_pcb = get_pcb(curr_pid);
+    int32_t value;
+
+    //no larger step can matter, and this keeps the sum from overflowing
+    if(inc < NICE_MIN - NICE_MAX){
+        inc = NICE_MIN - NICE_MAX;
+    }
+    if(inc > NICE_MAX - NICE_MIN){
+        inc = NICE_MAX - NICE_MIN;
+    }
+    value = curr_pcb->nice + inc;
+    if(value < NICE_MIN){
+        value = NICE_MIN;
+    }
+    if(value > NICE_MAX){
+        value = NICE_MAX;
+    }
+    curr_pcb->nice = value;
+    if(curr_pcb->level < sched_top_level(curr_pcb)){
+        curr_pcb->level = sched_top_level(curr_pcb);
+    }
+    return value;
+}
+
+/* 
+ * init_idle_task
+ *   DESCRIPTION: fill in the idle pcb at the bottom of this cpu's boot stack (see
+ *                init_process_table and start_ap) so the boot context can act as a process.
+ *                Call with interrupts disabled.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void init_idle_task(){
+    pcb_t* idle_pcb = get_pcb(IDLE_PID);
+
+    idle_pcb->pid = IDLE_PID;
+    idle_pcb->parent_pid = -1;
+    idle_pcb->state = PROC_RUNNING;
+    idle_pcb->term_idx = 0;
+    idle_pcb->run_next = NULL;
+    idle_pcb->level = SCHED_LEVELS;    //below every real priority level
+    idle_pcb->ticks_used = 0;
+    idle_pcb->waiting_on = NULL;
+    idle_pcb->polling = NULL;
+    idle_pcb->held_mutexes = NULL;
+    idle_pcb->group = idle_pcb;
+    idle_pcb->kill_pending = 0;
+    idle_pcb->background = 0;
+    idle_pcb->page_dir = page_directory;    //kernel mappings only
+    idle_pcb->cpu = this_cpu()->id;
+    idle_pcb->fpu_used = 0;
+}
+
+/* 
+ * start_idle
+ *   DESCRIPTION: turn the boot context of this cpu into its idle task. It keeps running on
+ *                the boot stack, whose bottom holds the idle pcb. Called once at the end of
+ *                entry() and of ap_main(); never returns.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void start_idle(){
+    cli();
+    init_idle_task();
+
+    //the boot cpu held the kernel lock through the rest of the kernel initialization
+    kernel_lock_set_depth(0);
+    sti();
+    idle_loop();
+}
+
+/* 
+ * next_deadline
+ *   DESCRIPTION: number of ticks until the kernel next needs the timer
+ *   INPUTS: none
+ *   OUTPUTS: ticks until the next deadline, NO_DEADLINE if nothing waits on the clock
+ */
+static uint32_t next_deadline(){
+    //terminal shells are still being launched one tick apart
+    if(i < 2){
+        return 1;
+    }
+    //keyboard and rtc sleepers are woken by their own interrupts, sleep() by a timer
+    return timer_next_deadline();
+}
+
+/* 
+ * idle_loop
+ *   DESCRIPTION: the idle task of a cpu. Runs whenever no process is ready there: hands the
+ *                cpu to the first process that becomes ready, otherwise stops the tick and
+ *                halts until an interrupt (or a reschedule ipi) arrives. The kernel lock is
+ *                only held while looking at the run queue, never while halted.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void idle_loop(){
+    while(1){
         cli();
-        process_switch(schedule[old_term_idx],schedule[active_term_idx]);
-        sti();
-            
+        kernel_lock();
+        tickless_exit();
+        update_load(this_cpu());
+
+        //nothing of our own: look for work on a busier cpu
+        if(run_queue_top_level() != SCHED_LEVELS || steal_work()){
+            switch_to_process(run_queue_pop());
+            kernel_unlock();
+            sti();
+            continue;
+        }
+
+#if TICKLESS_IDLE
+        tickless_enter();
+#endif
+        idle_halts++;
+        kernel_unlock();
+        //sti only takes effect after the next instruction, so no wake up slips in before hlt
+        asm volatile ("sti; hlt" : : : "memory");
     }
-    
-    
+}
 
+/* 
+ * tickless_enter
+ *   DESCRIPTION: replace the periodic tick with a single interrupt at the next deadline (or as
+ *                late as the 16 bit counter allows, which also keeps the 32 bit tsc math in
+ *                tickless_exit from wrapping). Call with interrupts disabled.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void tickless_enter(){
+    uint32_t reload_val = INPUT_FREQ/PIT_FREQ;
+    uint32_t ticks;
+    uint32_t count;
+
+    //an application processor's tick only preempts processes, it has no deadlines
+    if(this_cpu()->id != BOOT_CPU){
+        lapic_timer_stop();
+        return;
+    }
+    ticks = next_deadline();
+
+    if(ticks > PIT_MAX_COUNT / reload_val){
+        count = PIT_MAX_COUNT;
+    }
+    else{
+        count = ticks * reload_val;
+    }
+
+    outb(PIT_ONESHOT_MODE, PIT_CMD_REG);
+    outb(count & 0xFF, PIT_CH0);        //moving lower byte
+    outb(count >> 8, PIT_CH0);          //moving higher byte, counting starts
+    tickless_active = 1;
 }
 
+/* 
+ * pit_ticks_now
+ *   DESCRIPTION: the current tick. pit_ticks only catches up when the boot cpu leaves a
+ *                tickless idle period, so add the whole ticks it has been halted for.
+ *   INPUTS: none
+ *   OUTPUTS: ticks since boot
+ */
+uint32_t pit_ticks_now(){
+    if(!tickless_active){
+        return pit_ticks;
+    }
+    return pit_ticks + (rdtsc() - last_tick_tsc) / tsc_per_tick;
+}
 
+/* 
+ * tickless_exit
+ *   DESCRIPTION: add the whole ticks that passed while the idle task was halted to pit_ticks
+ *                and restart the periodic tick. No-op if the tick is already running.
+ *                Call with interrupts disabled.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void tickless_exit(){
+    uint32_t elapsed;
+    if(this_cpu()->id != BOOT_CPU){
+        lapic_timer_start();
+        return;
+    }
+    if(!tickless_active){
+        return;
+    }
+    tickless_active = 0;
+
+    //keep the partial tick in last_tick_tsc so repeated short idles do not lose time
+    elapsed = (rdtsc() - last_tick_tsc) / tsc_per_tick;
+    pit_ticks += elapsed;
+    last_tick_tsc += elapsed * tsc_per_tick;
+
+    pit_set_periodic();
+}
+
+/* 
+ * print_pit_stats
+ *   DESCRIPTION: print elapsed ticks against PIT interrupts taken, the difference being
+ *                the ticks skipped while idle
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void print_pit_stats(){
+    printf("pit: ticks=%u irqs=%u idle halts=%u\n", pit_ticks, pit_irq_count, idle_halts);
+}
+
+/* 
+ * print_load_stats
+ *   DESCRIPTION: print the load average, ready processes and work stealing counters of every
+ *                cpu; the steal cost is the average tsc cycles spent per process taken
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void print_load_stats(){
+    uint32_t k;
+    cpu_t* cpu;
+    for(k = 0; k < nr_cpus; k++){
+        cpu = &cpus[k];
+        update_load(cpu);
+        printf("cpu%d: load=%u.%u%u ready=%u steals=%u stolen=%u steal cost=%u cycles\n", k,
+               cpu->load_avg / LOAD_SCALE, (cpu->load_avg % LOAD_SCALE) / 10, cpu->load_avg % 10,
+               cpu_ready_count(cpu), cpu->steals, cpu->stolen,
+               cpu->steals ? cpu->steal_cycles / cpu->steals : 0);
+    }
+}
@@ -6,6 +6,8 @@
 #include "keyboard.h"
 #include "multi_term.h"
 #include "syscall.h"
+#include "smp.h"
+#include "timer.h"
 
 #define PIT_CH0             0x40        //channel 0 port
 #define PIT_CMD_REG         0x43        //cmd reg port
@@ -13,10 +15,109 @@
 #define PIT_FREQ            100         //set to about interrupt every 10ms -> 100Hz
 #define PIT_MODE            0x36        //00|11| 010|0   channel 0 | lobyte/hibyte | mode 3 | binary
 #define PIT_IRQ             0x00
+#define PIT_CH2             0x42        //channel 2 port (used to calibrate the tsc)
+#define PIT_CH2_GATE        0x61        //channel 2 gate / speaker control port
+#define PIT_CH2_MODE        0xB0        //10|11| 000|0   channel 2 | lobyte/hibyte | mode 0 | binary
+#define PIT_CH2_OUT         0x20        //bit of port 0x61 that mirrors the channel 2 output
+#define PIT_ONESHOT_MODE    0x30        //00|11| 000|0   channel 0 | lobyte/hibyte | mode 0 | binary
+#define PIT_MAX_COUNT       0xFFFF      //longest one-shot the 16 bit counter can do (~55ms)
+
+#define TICKLESS_IDLE       1           //stop the periodic tick while the idle task halts (0 keeps ticking)
+#define NO_DEADLINE         0xFFFFFFFF  //nothing is waiting on the clock
+
+#define SCHED_BOOST_TICKS   100         //move every process back to level 0 once a second
+#define STEAL_COOLDOWN_TICKS 10         //a process that migrated is not stolen again for 100ms
+#define LOAD_SCALE          100         //load averages are fixed point, 100 = one runnable process
+#define LOAD_DECAY          8           //each tick the load average moves 1/8 of the way to the current load
+#define LOAD_DECAY_MAX_TICKS 64         //catching up longer than this leaves nothing of the old load
+#define NICE_MIN            -2          //time slices 4x the level's quantum
+#define NICE_MAX            2           //never above the lowest level
 
 int i;
 
+//tsc cycles per PIT tick (10ms), measured once in init_pit
+uint32_t tsc_per_tick;
+
+//10ms ticks since boot, caught up from the tsc after every tickless idle period
+uint32_t pit_ticks;
+
+//PIT interrupts actually taken and times an idle task halted its cpu
+uint32_t pit_irq_count;
+uint32_t idle_halts;
+
 void init_pit();
 void pit_handler();
 
+//charge a tick to the process running on this cpu and preempt it if its slice is over
+//(PIT on the boot cpu, lapic timer on the others)
+void scheduler_tick();
+
+//measure how many tsc cycles one PIT tick takes
+void calibrate_tsc();
+
+//append a ready process to the tail of the run queue of its priority level on its cpu
+void run_queue_push(pcb_t* pcb);
+
+//take the first process of the highest non-empty priority level of this cpu (NULL if none is ready)
+pcb_t* run_queue_pop();
+
+//highest priority level with a ready process on this cpu (SCHED_LEVELS if none is ready)
+uint32_t run_queue_top_level();
+
+//unlink a process from the run queue if it is queued
+void run_queue_remove(pcb_t* pcb);
+
+//mark a process ready and queue it on its cpu (no-op if it already is ready or running)
+void make_ready(pcb_t* pcb);
+
+//switch this cpu from the current process to next
+void switch_to_process(pcb_t* next);
+
+//switch to the next ready process of this cpu, or its idle task
+void reschedule();
+
+//switch right away if a process of higher priority than the current one became ready
+void preempt_check();
+
+//move every process back to the highest priority level it may hold
+void priority_boost();
+
+//highest priority level a process may be lifted to (lower for a positive nice value)
+uint32_t sched_top_level(struct pcb* pcb);
+
+//give the cpu to the next ready process of the same or a higher level (system call)
+int32_t yield();
+
+//change the nice value of the current process and return the new one (system call)
+int32_t nice(int32_t inc);
+
+//idle cpu: move a ready process from the busiest other cpu to this one (1 if one was moved)
+uint32_t steal_work();
+
+//fill in the idle pcb of this cpu
+void init_idle_task();
+
+//turn the boot context of a cpu into its idle task and run idle_loop() (never returns)
+void start_idle();
+
+//body of the idle task: run whatever becomes ready, otherwise halt the cpu
+void idle_loop();
+
+//switch channel 0 to a one-shot for the next deadline before the idle task halts
+//(application processors stop their lapic timer)
+void tickless_enter();
+
+//catch pit_ticks up with the time spent halted and go back to the periodic tick
+//(application processors restart their lapic timer)
+void tickless_exit();
+
+//current tick, counting the ticks the boot cpu skipped while halted
+uint32_t pit_ticks_now();
+
+//print tick and interrupt counters (ctrl+s)
+void print_pit_stats();
+
+//print per-cpu load averages and work stealing counters (ctrl+s)
+void print_load_stats();
+
 #endif
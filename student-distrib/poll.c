@@ -0,0 +1,103 @@
+#include "poll.h"
+#include "pit.h"
+#include "signal.h"
+
+/*
+ * poll_scan
+ *   DESCRIPTION: fill revents of every pollfd from the poll ops of its file. With pt set,
+ *                each op also puts the current process on the queues that signal a change.
+ *                An op table without a poll op never blocks, so all requested events are ready.
+ *   INPUTS: fds - the pollfds, in the user page
+ *           nfds - how many
+ *           pt - entries to register with, NULL to only check
+ *   OUTPUTS: number of fds with a nonzero revents
+ */
+static int32_t poll_scan(pollfd_t* fds, uint32_t nfds, poll_table_t* pt){
+    file_descriptor_t* fd_array = get_pcb(curr_pid)->group->fd_array;
+    file_op_table_t* ops;
+    uint32_t ready;
+    int32_t count = 0;
+    uint32_t i;
+
+    for(i = 0; i < nfds; i++){
+        if(fds[i].fd < 0 || fds[i].fd >= MAX_FILES || fd_array[fds[i].fd].flags == FD_UNUSED){
+            fds[i].revents = POLLNVAL;
+            count++;
+            continue;
+        }
+        ops = fd_array[fds[i].fd].file_op_table_ptr;
+        ready = (ops->poll == NULL) ? (POLLIN | POLLOUT) : ops->poll(fds[i].fd, pt);
+        fds[i].revents = ready & fds[i].events;
+        if(fds[i].revents != 0){
+            count++;
+        }
+    }
+    return count;
+}
+
+/*
+ * poll
+ *   DESCRIPTION: system call: wait until at least one of the fds can be read or written
+ *                without blocking, so one process can serve the keyboard, its rtc and pipes
+ *                at once. The process sleeps on the wait queue of every fd (and on its
+ *                sleep_timer for a timeout) at the same time; a wake up on any of them makes
+ *                it scan the fds again. It is blocked before the scan, so an event arriving
+ *                between the check and the sleep only makes the sleep return at once.
+ *   INPUTS: fds - pollfds in the user page
+ *           nfds - how many, at most MAX_FILES
+ *           timeout - ms to wait, 0 to only check, POLL_FOREVER (-1) for no limit
+ *   OUTPUTS: number of fds with revents set, 0 on timeout, -1 for bad arguments or if a
+ *            signal came first
+ */
+int32_t poll(pollfd_t* fds, uint32_t nfds, int32_t timeout){
+    pcb_t* curr_pcb = get_pcb(curr_pid);
+    poll_table_t pt;
+    uint32_t flags;
+    uint32_t done;
+    int32_t count;
+
+    if(nfds > MAX_FILES || (uint32_t)fds < USER_MEM_START_VIR ||
+       (uint32_t)fds > USER_MEM_START_VIR + PAGE_SIZE_4MB - nfds * sizeof(pollfd_t)){
+        return -1;
+    }
+    if(timeout == 0){
+        return poll_scan(fds, nfds, NULL);
+    }
+
+    pt.count = 0;
+    cli_and_save(flags);
+    if(timeout > 0){
+        arm_sleep_timer(curr_pcb, timeout);
+    }
+    while(1){
+        curr_pcb->state = PROC_BLOCKED;
+        curr_pcb->polling = &pt;
+        if(timeout > 0){
+            poll_wait(&pt, &curr_pcb->sleep_wq);
+        }
+        count = poll_scan(fds, nfds, &pt);
+        done = count != 0 || (timeout > 0 && !timer_pending(&curr_pcb->sleep_timer));
+        if(!done && !signal_pending()){
+            //run someone else until one of the queues (or a signal) wakes us up
+            while(curr_pcb->state == PROC_BLOCKED){
+                reschedule();
+            }
+        }
+        poll_unwait(&pt);
+        curr_pcb->polling = NULL;
+        if(!done && signal_pending()){
+            count = -1;
+            done = 1;
+        }
+        if(done){
+            //off every queue: a waker that found us already made us ready, none can come now
+            if(curr_pcb->state == PROC_BLOCKED){
+                curr_pcb->state = PROC_RUNNING;
+            }
+            break;
+        }
+    }
+    del_timer(&curr_pcb->sleep_timer);
+    restore_flags(flags);
+    return count;
+}
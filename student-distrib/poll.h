@@ -0,0 +1,23 @@
+#ifndef _POLL_H
+#define _POLL_H
+
+#include "types.h"
+#include "lib.h"
+#include "syscall.h"
+
+#define POLLIN          0x1         // read() would not block (data, a line, a tick or end of file)
+#define POLLOUT         0x4         // write() would not block
+#define POLLNVAL        0x20        // revents only: fd is not open
+#define POLL_FOREVER    -1          // timeout of a poll() that waits until an fd is ready
+
+// One fd handed to poll(): the caller fills fd and events, the kernel fills revents
+typedef struct pollfd{
+    int32_t fd;
+    int16_t events;             //POLLIN and/or POLLOUT
+    int16_t revents;            //events of fd that are ready, or POLLNVAL
+} pollfd_t;
+
+//wait until one of nfds fds is ready or timeout ms passed; number of ready fds (system call)
+int32_t poll(pollfd_t* fds, uint32_t nfds, int32_t timeout);
+
+#endif /* _POLL_H */
@@ -0,0 +1,307 @@
+#include "process.h"
+#include "syscall.h"
+#include "kdata.h"
+
+//pid -> pcb, NULL for free pids
+static pcb_t* pid_table[MAX_PID];
+
+//free pids in FIFO order (so a pid is not handed out again right after it is freed)
+static uint16_t pid_free_next[MAX_PID];
+static uint32_t pid_free_head;
+static uint32_t pid_free_tail;
+#define PID_NONE    MAX_PID
+
+//pid table, free lists and process list
+static spinlock_t proc_lock = SPINLOCK_INIT("process table");
+
+//free 8KB kernel stacks, linked through their first word
+static uint32_t* kstack_free_head;
+static uint32_t kstack_free_count;
+
+//stack of free 4MB user frames (frame k is at 8MB + k*4MB)
+static uint32_t user_frame_free[USER_FRAMES_MAX];
+static uint32_t user_frame_free_count;
+
+//one page directory per user frame; the kernel part is copied from page_directory
+static int user_page_dirs[USER_FRAMES_MAX][NUM_ENTRIES] __attribute__((aligned (TABLE_SIZE)));
+
+/*
+ * init_process_table
+ *   DESCRIPTION: set up the pid free list, cut the kernel memory between pool_start and the
+ *                boot stack into 8KB kernel stacks and count how many 4MB user frames fit in
+ *                ram. The boot stack (top 8KB below 8MB) stays with the idle task, pid 0.
+ *   INPUTS: pool_start - first free byte after the kernel image and boot modules
+ *           mem_upper_kb - ram above 1MB reported by the boot loader, 0 if unknown
+ *   OUTPUTS: none
+ */
+void init_process_table(uint32_t pool_start, uint32_t mem_upper_kb){
+    uint32_t pid;
+    uint32_t block;
+    uint32_t frames;
+
+    for(pid = 0; pid < MAX_PID; pid++){
+        pid_table[pid] = NULL;
+        pid_free_next[pid] = pid + 1;
+    }
+    pid_free_next[MAX_PID - 1] = PID_NONE;
+    pid_free_head = IDLE_PID + 1;
+    pid_free_tail = MAX_PID - 1;
+    pid_table[IDLE_PID] = (pcb_t*)(KERNEL_MEM_START - PROCESS_STACK_SIZE);
+    cpus[BOOT_CPU].idle = pid_table[IDLE_PID];
+
+    process_list = NULL;
+    nr_processes = 0;
+
+    //keep the kernel stacks 8KB aligned like the old fixed slots below 8MB
+    kstack_free_head = NULL;
+    kstack_free_count = 0;
+    block = (pool_start + PROCESS_STACK_SIZE - 1) & ~(PROCESS_STACK_SIZE - 1);
+    for(; block + PROCESS_STACK_SIZE <= KERNEL_MEM_START - PROCESS_STACK_SIZE; block += PROCESS_STACK_SIZE){
+        *(uint32_t**)block = kstack_free_head;
+        kstack_free_head = (uint32_t*)block;
+        kstack_free_count++;
+    }
+
+    //user frames start at 8MB; ram ends at 1MB + mem_upper
+    if(mem_upper_kb == 0){
+        frames = USER_FRAMES_DEFAULT;
+    }
+    else if(mem_upper_kb * 1024 + 0x100000 <= USER_MEM_START_PHY){
+        frames = 0;
+    }
+    else{
+        frames = (mem_upper_kb * 1024 + 0x100000 - USER_MEM_START_PHY) / PAGE_SIZE_4MB;
+    }
+    if(frames > USER_FRAMES_MAX){
+        frames = USER_FRAMES_MAX;
+    }
+    //hand out the low frames first
+    user_frame_free_count = 0;
+    while(frames > 0){
+        frames--;
+        user_frame_free[user_frame_free_count++] = frames;
+    }
+}
+
+/*
+ * take_pcb
+ *   DESCRIPTION: take a pid and a kernel stack with the pcb at its bottom, place the pcb on a
+ *                cpu and add it to the process list. Call with proc_lock held, after checking
+ *                that both free lists are non-empty.
+ *   INPUTS: none
+ *   OUTPUTS: the new pcb
+ */
+static pcb_t* take_pcb(){
+    uint32_t pid;
+    pcb_t* pcb;
+
+    pid = pid_free_head;
+    pid_free_head = pid_free_next[pid];
+    if(pid_free_head == PID_NONE){
+        pid_free_tail = PID_NONE;
+    }
+
+    pcb = (pcb_t*)kstack_free_head;
+    kstack_free_head = *(uint32_t**)kstack_free_head;
+    kstack_free_count--;
+
+    pcb->pid = pid;
+    pcb->cpu = smp_place_process();
+    pcb->migrations = 0;
+    pid_table[pid] = pcb;
+
+    pcb->all_next = process_list;
+    process_list = pcb;
+    nr_processes++;
+    return pcb;
+}
+
+/*
+ * alloc_process
+ *   DESCRIPTION: allocate everything a new process needs in O(1): a pid from the free list,
+ *                a kernel stack with the pcb at its bottom and a 4MB user frame with its own
+ *                page directory. The pcb is added to the process list; the caller fills in
+ *                the rest of it.
+ *   INPUTS: none
+ *   OUTPUTS: the new pcb, NULL if pids, kernel stacks or user frames ran out
+ */
+pcb_t* alloc_process(){
+    uint32_t flags;
+    pcb_t* pcb;
+
+    spin_lock_irqsave(&proc_lock, flags);
+    if(pid_free_head == PID_NONE || kstack_free_head == NULL || user_frame_free_count == 0){
+        spin_unlock_irqrestore(&proc_lock, flags);
+        return NULL;
+    }
+
+    pcb = take_pcb();
+    pcb->group = pcb;
+    pcb->user_frame = user_frame_free[--user_frame_free_count];
+
+    //fresh address space: kernel mappings and the kernel data pages, the user page is added
+    //by setup_process_memory
+    pcb->page_dir = user_page_dirs[pcb->user_frame];
+    memcpy(pcb->page_dir, page_directory, TABLE_SIZE);
+    kdata_map(pcb);
+
+    spin_unlock_irqrestore(&proc_lock, flags);
+    return pcb;
+}
+
+/*
+ * alloc_thread
+ *   DESCRIPTION: allocate a pid and a kernel stack for a new thread of group. It runs in the
+ *                group's user frame and page directory, so no frame is taken.
+ *   INPUTS: group - main thread of the process
+ *   OUTPUTS: the new pcb, NULL if pids or kernel stacks ran out
+ */
+pcb_t* alloc_thread(pcb_t* group){
+    uint32_t flags;
+    pcb_t* pcb;
+
+    spin_lock_irqsave(&proc_lock, flags);
+    if(pid_free_head == PID_NONE || kstack_free_head == NULL){
+        spin_unlock_irqrestore(&proc_lock, flags);
+        return NULL;
+    }
+
+    pcb = take_pcb();
+    pcb->group = group;
+    pcb->user_frame = group->user_frame;
+    pcb->page_dir = group->page_dir;
+
+    spin_unlock_irqrestore(&proc_lock, flags);
+    return pcb;
+}
+
+/*
+ * free_process
+ *   DESCRIPTION: unlink a process from the process list and give its pid, kernel stack and
+ *                user frame back (a thread's frame stays with its main thread). The stack
+ *                may be handed out by any cpu as soon as this returns, and get_pcb() of the
+ *                pid returns NULL. So a process must not free itself and then keep running
+ *                code that may use its stack for long or look it up. It must hold the
+ *                kernel lock with interrupts off (after boot, alloc_process and alloc_thread
+ *                only run in system calls, under that lock), and it must leave the stack
+ *                without scheduling, as halt() does when it returns into the parent's
+ *                execute(). Otherwise, leave it to reap_zombie.
+ *   INPUTS: pcb - process to free
+ *   OUTPUTS: none
+ */
+void free_process(pcb_t* pcb){
+    uint32_t flags;
+    pcb_t** link;
+
+    //a process halted in sleep() must not be woken through its freed stack
+    del_timer(&pcb->sleep_timer);
+    del_timer(&pcb->alarm_timer);
+    spin_lock_irqsave(&proc_lock, flags);
+    fpu_release(pcb);
+    for(link = &process_list; *link != NULL; link = &(*link)->all_next){
+        if(*link == pcb){
+            *link = pcb->all_next;
+            nr_processes--;
+            break;
+        }
+    }
+
+    pid_table[pcb->pid] = NULL;
+    pid_free_next[pcb->pid] = PID_NONE;
+    if(pid_free_tail == PID_NONE){
+        pid_free_head = pcb->pid;
+    }
+    else{
+        pid_free_next[pid_free_tail] = pcb->pid;
+    }
+    pid_free_tail = pcb->pid;
+
+    if(pcb->group == pcb){
+        user_frame_free[user_frame_free_count++] = pcb->user_frame;
+    }
+    cpus[pcb->cpu].nr_procs--;
+
+    *(uint32_t**)pcb = kstack_free_head;
+    kstack_free_head = (uint32_t*)pcb;
+    kstack_free_count++;
+
+    spin_unlock_irqrestore(&proc_lock, flags);
+}
+
+/*
+ * reap_zombie
+ *   DESCRIPTION: free the orphan background process that halted on this cpu. It cannot free
+ *                itself: its kernel stack is in use until switch_to() leaves it, and once on
+ *                the free list another cpu may hand the stack out. Called by the task that
+ *                switch_to() resumed, right after the switch.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void reap_zombie(){
+    cpu_t* cpu = this_cpu();
+    pcb_t* pcb = cpu->zombie;
+
+    if(pcb != NULL){
+        cpu->zombie = NULL;
+        free_process(pcb);
+    }
+}
+
+/*
+ * alloc_kernel_stack
+ *   DESCRIPTION: take an 8KB kernel stack for a task that is not a process: the idle task of
+ *                an application processor, whose pcb sits at the bottom like a process's.
+ *                It is never given back.
+ *   INPUTS: none
+ *   OUTPUTS: the stack block, NULL if none is left
+ */
+uint32_t* alloc_kernel_stack(){
+    uint32_t flags;
+    uint32_t* block;
+
+    spin_lock_irqsave(&proc_lock, flags);
+    block = kstack_free_head;
+    if(block != NULL){
+        kstack_free_head = *(uint32_t**)block;
+        kstack_free_count--;
+    }
+    spin_unlock_irqrestore(&proc_lock, flags);
+    return block;
+}
+
+/*
+ * get_pcb
+ *   DESCRIPTION: look up the pcb of a pid in the process table. Every cpu has its own idle
+ *                task, all with IDLE_PID; it is the one of the cpu running this code.
+ *   INPUTS: pid - process id
+ *   OUTPUTS: the pcb, NULL if the pid is not in use
+ */
+pcb_t* get_pcb(uint32_t pid){
+    if(pid == IDLE_PID){
+        return this_cpu()->idle;
+    }
+    if(pid >= MAX_PID){
+        return NULL;
+    }
+    return pid_table[pid];
+}
+
+/*
+ * free_kernel_stacks
+ *   DESCRIPTION: number of kernel stacks left for new processes
+ *   INPUTS: none
+ *   OUTPUTS: free kernel stack count
+ */
+uint32_t free_kernel_stacks(){
+    return kstack_free_count;
+}
+
+/*
+ * free_user_frames
+ *   DESCRIPTION: number of 4MB user frames left for new processes
+ *   INPUTS: none
+ *   OUTPUTS: free user frame count
+ */
+uint32_t free_user_frames(){
+    return user_frame_free_count;
+}
@@ -0,0 +1,44 @@
+#ifndef _PROCESS_H
+#define _PROCESS_H
+
+#include "types.h"
+#include "lib.h"
+
+#define USER_FRAMES_MAX      64          // most 4MB user frames tracked (enough for 264MB of ram)
+#define USER_FRAMES_DEFAULT  6           // frames used when the boot loader does not report memory
+
+struct pcb;
+
+// end of the kernel image, provided by the linker
+extern uint8_t _end[];
+
+// every live process (not the idle task), linked through pcb->all_next
+struct pcb* process_list;
+uint32_t nr_processes;
+
+// walk every live process; p must not be freed inside the loop
+#define for_each_process(p) for ((p) = process_list; (p) != NULL; (p) = (p)->all_next)
+
+// carve the free kernel memory above pool_start into kernel stacks and count the user frames
+void init_process_table(uint32_t pool_start, uint32_t mem_upper_kb);
+
+// take a free pid, a kernel stack (the pcb sits at its bottom) and a user frame; NULL if any ran out
+struct pcb* alloc_process();
+
+// take a pid and a kernel stack for a thread sharing group's user frame and page directory
+struct pcb* alloc_thread(struct pcb* group);
+
+// give a process's pid, kernel stack and user frame back (call with interrupts disabled)
+void free_process(struct pcb* pcb);
+
+// free the orphan that halted on this cpu, now that the cpu runs on another stack
+void reap_zombie();
+
+// take a kernel stack that is never freed (idle task of an application processor)
+uint32_t* alloc_kernel_stack();
+
+// number of kernel stacks and user frames still free
+uint32_t free_kernel_stacks();
+uint32_t free_user_frames();
+
+#endif /* _PROCESS_H */
@@ -0,0 +1,89 @@
+#include "ring.h"
+
+/*
+ * ring_op
+ *   DESCRIPTION: run one queued system call through the same function its trap would reach
+ *   INPUTS: sqe - the entry, copied out of the ring
+ *   OUTPUTS: what the system call returned, -1 for an unknown opcode
+ */
+static int32_t ring_op(ring_sqe_t* sqe){
+    switch(sqe->opcode){
+        case RING_OP_NOP:
+            return 0;
+        case RING_OP_READ:
+            return read(sqe->fd, (void*)sqe->addr, sqe->len);
+        case RING_OP_WRITE:
+            return write(sqe->fd, (const void*)sqe->addr, sqe->len);
+        case RING_OP_OPEN:
+            return open((const uint8_t*)sqe->addr);
+        case RING_OP_CLOSE:
+            return close(sqe->fd);
+        default:
+            return -1;
+    }
+}
+
+/*
+ * ring_submit
+ *   DESCRIPTION: run every entry queued on the submission ring, in order, and post one
+ *                completion each. Stops early when the completion ring is full; the rest
+ *                stays queued for the next call. An entry may sleep like its system call
+ *                would (use non-blocking fds to avoid that). Entries queued while this runs
+ *                are picked up too, at most RING_ENTRIES of them per call.
+ *   INPUTS: ring - the rings
+ *   OUTPUTS: number of entries run
+ */
+int32_t ring_submit(io_ring_t* ring){
+    ring_sqe_t sqe;
+    ring_cqe_t* cqe;
+    uint32_t head;
+    uint32_t tail;
+    int32_t done = 0;
+
+    head = ring->sq_head;
+    while(done < RING_ENTRIES && head != ring->sq_tail){
+        tail = ring->cq_tail;
+        if(tail - ring->cq_head >= RING_ENTRIES){
+            break;
+        }
+        //copy first: the program may reuse the slot as soon as sq_head moves past it
+        sqe = ring->sq[head & RING_MASK];
+        ring->sq_head = ++head;
+
+        cqe = &ring->cq[tail & RING_MASK];
+        cqe->user_data = sqe.user_data;
+        cqe->res = ring_op(&sqe);
+        //the completion is filled in before the program may see it
+        asm volatile ("" : : : "memory");
+        ring->cq_tail = tail + 1;
+        done++;
+    }
+    ring_ops += done;
+    return done;
+}
+
+/*
+ * ring_enter
+ *   DESCRIPTION: system call: run the entries queued on a ring of the program (ring_submit),
+ *                so a batch of reads and writes costs one trap instead of one per call
+ *   INPUTS: ring - the rings, in the user page
+ *   OUTPUTS: number of entries run, -1 for a bad pointer
+ */
+int32_t ring_enter(io_ring_t* ring){
+    if((uint32_t)ring < USER_MEM_START_VIR ||
+       (uint32_t)ring > USER_MEM_START_VIR + PAGE_SIZE_4MB - sizeof(io_ring_t)){
+        return -1;
+    }
+    ring_enters++;
+    return ring_submit(ring);
+}
+
+/*
+ * print_ring_stats
+ *   DESCRIPTION: print how many ring_enter calls ran how many system calls
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void print_ring_stats(){
+    printf("rings: enters=%u ops=%u\n", ring_enters, ring_ops);
+}
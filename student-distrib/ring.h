@@ -0,0 +1,58 @@
+#ifndef _RING_H
+#define _RING_H
+
+#include "types.h"
+#include "lib.h"
+#include "syscall.h"
+
+#define RING_ENTRIES        32          // slots in each ring (power of two)
+#define RING_MASK           (RING_ENTRIES - 1)
+
+#define RING_OP_NOP         0           // completes with 0
+#define RING_OP_READ        1           // read(fd, addr, len)
+#define RING_OP_WRITE       2           // write(fd, addr, len)
+#define RING_OP_OPEN        3           // open(addr)
+#define RING_OP_CLOSE       4           // close(fd)
+
+// One queued system call
+typedef struct ring_sqe{
+    uint32_t opcode;            //RING_OP_*
+    int32_t fd;
+    uint32_t addr;              //buffer, or file name for RING_OP_OPEN
+    int32_t len;
+    uint32_t user_data;         //copied to the completion so the program can match them up
+} ring_sqe_t;
+
+// Result of one queued system call
+typedef struct ring_cqe{
+    uint32_t user_data;
+    int32_t res;                //what the system call returned
+} ring_cqe_t;
+
+/* Submission and completion rings in the program's own memory. The program fills
+ * sq[sq_tail & RING_MASK] and moves sq_tail; ring_enter runs entries from sq_head and
+ * posts their results at cq_tail. The program reaps from cq_head. Each side only moves
+ * its own two indices, so neither needs a lock. */
+typedef struct io_ring{
+    volatile uint32_t sq_head;  //kernel: entries taken so far
+    volatile uint32_t sq_tail;  //program: entries queued so far
+    volatile uint32_t cq_head;  //program: completions reaped so far
+    volatile uint32_t cq_tail;  //kernel: completions posted so far
+    ring_sqe_t sq[RING_ENTRIES];
+    ring_cqe_t cq[RING_ENTRIES];
+} io_ring_t;
+
+//system calls made through ring_enter and the traps they saved (ctrl+s)
+uint32_t ring_enters;
+uint32_t ring_ops;
+
+//run the queued entries of ring while the completion ring has room; number run
+int32_t ring_submit(io_ring_t* ring);
+
+//ring_submit on a ring in the user page (system call)
+int32_t ring_enter(io_ring_t* ring);
+
+//print ring counters (ctrl+s)
+void print_ring_stats();
+
+#endif /* _RING_H */
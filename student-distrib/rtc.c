@@ -1,5 +1,8 @@
 #include "rtc.h"
 #include "lib.h"
+#include "pit.h"
+#include "poll.h"
+#include "signal.h"
 
 #define RTC_IRQ       0x08
 #define RTC_INDEX     0x70
@@ -9,6 +12,9 @@
 #define register_C    0x0C //status register
 #define RATE_1024_HZ  0x06 // when rate = 6, frequency = 32768/(2^(rate - 1)) = 1024
 #define FREQ_MAX      1024
+//the index port selects the register the data port reads or writes
+static spinlock_t cmos_lock = SPINLOCK_INIT("cmos");
+
 //int rtc_interrupt_occurred;
 //int max_rtc_count_before_show; // 2 = min freq; each round is 1024 Hz
 //int rtc_count; //count the rtc int in current round
@@ -24,12 +30,12 @@
 void init_rtc(){ //follows instruction on osdev
     //turn on IRQ8
     unsigned int flags;
-    cli_and_save(flags);  
+    spin_lock_irqsave(&cmos_lock, flags);
     outb(register_B, RTC_INDEX);
     char prev = inb(CMOS); //CMOS_IO_PORT reads the curr value of register B
     outb(register_B, RTC_INDEX);
     outb(prev | 0x40, CMOS); // 0x40 = 0100 0000, so this turns on bit 6 of register B
-    restore_flags(flags);
+    spin_unlock_irqrestore(&cmos_lock, flags);
     enable_irq(RTC_IRQ);
     read_register_C();
 }
@@ -47,34 +53,31 @@ void rtc_handler(){
     //if rtc has been opened
     //increment counter (file pos) for all process that has rtc opened
     send_eoi(RTC_IRQ);
-    uint32_t pid;
-    for(pid = 0; pid < MAX_PID; pid++){
-        //skip if process is not set
-        if(pid_status[pid] == 1){
-            pcb_t* pcb = get_pcb(pid);
-            //check if current process has opened rtc (rtc_fd_idx is -1 if not opened)
-            //note rtc_fd_idx is set in the open syscall
-            uint32_t rtc_fd = pcb->rtc_fd_idx;
-            if(rtc_fd != -1){
-                pcb->fd_array[rtc_fd].file_pos = pcb->fd_array[rtc_fd].file_pos + 1;  //increment counter
-
-                //check counter has reached max count
-                if(pcb->fd_array[rtc_fd].file_pos == pcb->max_rtc_count){
-                    pcb->rtc_interrupt = 1;                             //signal interrupt 
-                    pcb->fd_array[rtc_fd].file_pos = 0;        //reset counter
-                }
-                else{
-                    pcb->rtc_interrupt = 0;
-                }
+    pcb_t* pcb;
+    for_each_process(pcb){
+        //check if current process has opened rtc (rtc_fd_idx is -1 if not opened)
+        //note rtc_fd_idx is set in the open syscall
+        uint32_t rtc_fd = pcb->rtc_fd_idx;
+        if(rtc_fd != -1){
+            pcb->group->fd_array[rtc_fd].file_pos = pcb->group->fd_array[rtc_fd].file_pos + 1;  //increment counter
+
+            //check counter has reached max count
+            //rtc_interrupt stays set until rtc_read consumes it, so a reader that
+            //is not scheduled on this exact tick does not miss its interrupt
+            if(pcb->group->fd_array[rtc_fd].file_pos == pcb->max_rtc_count){
+                pcb->rtc_interrupt = 1;                             //signal interrupt 
+                pcb->group->fd_array[rtc_fd].file_pos = 0;        //reset counter
+                wake_up_boost(&pcb->rtc_wq);               //unblock rtc_read
             }
         }
-
     }
 
   
     
     read_register_C();
-    
+
+    //a woken rtc reader outranks cpu bound processes, let it run now
+    preempt_check();
 }
 
 
@@ -88,8 +91,11 @@ void rtc_handler(){
  *   OUTPUTS: none
  */
 void read_register_C() {
+    uint32_t flags;
+    spin_lock_irqsave(&cmos_lock, flags);
     outb(register_C, RTC_INDEX);
     inb(CMOS);
+    spin_unlock_irqrestore(&cmos_lock, flags);
 }
 
 
@@ -101,7 +107,7 @@ void read_register_C() {
  *   INPUTS: fd - file descriptor
  *           buf - buffer
  *           nbytes - should be 4 
- *   OUTPUTS: 0 on success, -1 on failure
+ *   OUTPUTS: 0 on success, -1 on failure or if a signal came first
  */
 int rtc_read(int32_t fd, void* buf, int32_t nbytes){
     // synchronize with interrupt handler 
@@ -113,12 +119,16 @@ int rtc_read(int32_t fd, void* buf, int32_t nbytes){
         return -1;
     }
 
-     pcb_t* pcb = get_pcb(schedule[active_term_idx]);
+     pcb_t* pcb = get_pcb(curr_pid);
      
      //if the current process has rtc open, block until interrupt has occured
      //if(pcb->rtc_fd_idx != -1){
 
-       while(!(pcb->rtc_interrupt)){};
+        //sleep instead of spinning; rtc_handler wakes us when our virtual rtc fires
+        wait_event_interruptible(&pcb->rtc_wq, pcb->rtc_interrupt);
+        if(!pcb->rtc_interrupt){
+            return -1;
+        }
         pcb->rtc_interrupt = 0;
     
      //}
@@ -132,6 +142,24 @@ int rtc_read(int32_t fd, void* buf, int32_t nbytes){
 
 
 
+/* 
+ * rtc_poll
+ *   DESCRIPTION: poll op of the rtc: ready to read once the virtual rtc of the process fired
+ *                since the last rtc_read. rtc_handler wakes rtc_wq when it does.
+ *   INPUTS: fd - file descriptor
+ *           pt - poll() entries to register with rtc_wq, NULL to only check
+ *   OUTPUTS: POLLIN if rtc_read would return at once, and POLLOUT (rtc_write never blocks)
+ */
+uint32_t rtc_poll(int32_t fd, poll_table_t* pt){
+    pcb_t* pcb = get_pcb(curr_pid);
+
+    poll_wait(pt, &pcb->rtc_wq);
+    if(pcb->rtc_interrupt){
+        return POLLIN | POLLOUT;
+    }
+    return POLLOUT;
+}
+
 /* 
  * rtc_write
  *   DESCRIPTION: Change the rtc frequency into value in buf
@@ -157,7 +185,7 @@ int rtc_write(int32_t fd, const void* buf, int32_t nbytes){
         return -1;
     }
 
-    pcb_t* pcb = get_pcb(schedule[active_term_idx]);
+    pcb_t* pcb = get_pcb(curr_pid);
     pcb->rtc_fd_idx = fd; 
     pcb->max_rtc_count = FREQ_MAX / f; //update the max count of rtc interrupt per 1024 ticks
 
@@ -178,7 +206,7 @@ int rtc_open(const uint8_t* filename){ //initializes RTC frequency to 2Hz.
     if (filename == NULL ) {
         return -1;
     }
-    pcb_t* pcb = get_pcb(schedule[active_term_idx]);
+    pcb_t* pcb = get_pcb(curr_pid);
     pcb->max_rtc_count = FREQ_MAX / FREQ_MAX; // default: freq 1024hz -> count before = 1
    
     //set frequency		
@@ -199,7 +227,7 @@ int rtc_close(int32_t fd){//does nothing unless we virtualize RTC
     if (fd < 0 || fd >= 8 ) { //fd goes from 0 to 8. because 8 is the size of file array
         return -1;
     }
-    pcb_t* pcb = get_pcb(schedule[active_term_idx]);
+    pcb_t* pcb = get_pcb(curr_pid);
     pcb->max_rtc_count = 0;
     pcb->rtc_interrupt = 0;
     pcb->rtc_fd_idx = -1;
@@ -225,12 +253,12 @@ int rtc_set_rate(int rate) {
     }
     
     //set frequency		
-    cli_and_save(flags);
+    spin_lock_irqsave(&cmos_lock, flags);
     outb(register_A, RTC_INDEX);		// set index to register A, disable NMI
     prev=inb(CMOS);	                    // get initial value of register A
     outb(register_A, RTC_INDEX);	    // reset index to A
     outb((prev & 0xF0) | rate, CMOS);   // write only our rate to A. Note, rate is the bottom 4 bits. 0xF0 = 1111 0000
-    restore_flags(flags);
+    spin_unlock_irqrestore(&cmos_lock, flags);
 
     return 0;
 }
@@ -25,6 +25,9 @@ void read_register_C();
 //block a flag until the next rtc inerrupt
 int rtc_read(int32_t fd, void* buf, int32_t nbytes); 
 
+//POLLIN once the virtual rtc of the process fired (rtc_read returns at once)
+uint32_t rtc_poll(int32_t fd, struct poll_table* pt);
+
 //Change the rtc frequency into value in buf
 int rtc_write(int32_t fd, const void* buf, int32_t nbytes); 
 
@@ -0,0 +1,284 @@
+#include "signal.h"
+#include "pit.h"
+
+//movl $SIGRETURN_NR, %eax; int $0x80; nop: a handler returns into this copy on its stack
+static const uint8_t sigreturn_code[SIG_TRAMPOLINE_SIZE] = {
+    0xB8, SIGRETURN_NR, 0x00, 0x00, 0x00, 0xCD, 0x80, 0x90
+};
+
+//eflags bits a signal frame may change: carry, parity, adjust, zero, sign, trap, direction, overflow
+#define EFLAGS_USER     0x0DD5
+
+/*
+ * send_signal
+ *   DESCRIPTION: mark a signal pending for a process. It is delivered the next time the
+ *                process goes back to user mode. A process sleeping on a wait queue is woken:
+ *                an interruptible sleep (terminal, rtc, pipe, poll, sleep, wait) then returns
+ *                -1, other sleeps just go back to sleep. A process running user code on
+ *                another cpu is sent the reschedule ipi, on whose return it gets the signal.
+ *                A signal ignored by default with no handler is dropped here, so it wakes
+ *                nobody. Call with the kernel lock held.
+ *   INPUTS: pcb - the process (or thread)
+ *           signum - SIG_*
+ *   OUTPUTS: none
+ */
+void send_signal(pcb_t* pcb, int32_t signum){
+    if(signum < 0 || signum >= NUM_SIGNALS){
+        return;
+    }
+    if(pcb->group->sig_handlers[signum] == NULL && (signum == SIG_ALARM || signum == SIG_USER1)){
+        return;
+    }
+    pcb->sig_pending |= 1 << signum;
+    if(pcb->sig_masked){
+        return;
+    }
+    //a parent blocked in execute() is on no queue and must stay blocked
+    if(pcb->state == PROC_BLOCKED && (pcb->waiting_on != NULL || pcb->polling != NULL)){
+        remove_wait(pcb);
+        make_ready(pcb);
+    }
+    else if(pcb->state == PROC_RUNNING && pcb->cpu != this_cpu()->id &&
+            cpus[pcb->cpu].running_pid == pcb->pid){
+        smp_send_resched(pcb->cpu);
+    }
+}
+
+/*
+ * next_signal
+ *   DESCRIPTION: pick the lowest pending signal and take it off the pending set. Signals
+ *                with no handler whose default is to be ignored are dropped on the way.
+ *                Nothing is picked while a handler runs; the signals stay pending.
+ *   INPUTS: pcb - the process
+ *   OUTPUTS: signal to deliver (a handler, or the default action: kill), -1 if none
+ */
+int32_t next_signal(pcb_t* pcb){
+    void** handlers = pcb->group->sig_handlers;
+    int32_t signum;
+
+    if(pcb->sig_masked){
+        return -1;
+    }
+    for(signum = 0; signum < NUM_SIGNALS; signum++){
+        if(!(pcb->sig_pending & (1 << signum))){
+            continue;
+        }
+        pcb->sig_pending &= ~(1 << signum);
+        if(handlers[signum] == NULL && (signum == SIG_ALARM || signum == SIG_USER1)){
+            continue;
+        }
+        return signum;
+    }
+    return -1;
+}
+
+/*
+ * signal_pending
+ *   DESCRIPTION: tell the sysenter return path whether to go back through intr_return, and
+ *                an interruptible sleep whether to give up
+ *   INPUTS: none
+ *   OUTPUTS: 1 if the current process has a pending signal and no handler running
+ */
+int32_t signal_pending(){
+    pcb_t* pcb = get_pcb(curr_pid);
+    return pcb->sig_pending != 0 && !pcb->sig_masked;
+}
+
+/*
+ * push_signal_frame
+ *   DESCRIPTION: make the interrupted user context call handler(signum). Below the user esp
+ *                go the code that calls sigreturn, the context itself, signum and, as the
+ *                return address, the code; the context then resumes at the handler.
+ *   INPUTS: regs - the user context on the kernel stack
+ *           signum - the signal
+ *           handler - its handler in the user page
+ *   OUTPUTS: 0, -1 if the user stack has no room for the frame
+ */
+static int32_t push_signal_frame(hw_context_t* regs, int32_t signum, uint32_t handler){
+    uint32_t esp = regs->esp;
+    uint32_t code;
+
+    if(esp > USER_MEM_START_VIR + PAGE_SIZE_4MB ||
+       esp < USER_MEM_START_VIR + SIG_TRAMPOLINE_SIZE + sizeof(hw_context_t) + 2 * sizeof(uint32_t)){
+        return -1;
+    }
+    esp -= SIG_TRAMPOLINE_SIZE;
+    code = esp;
+    memcpy((void*)code, sigreturn_code, SIG_TRAMPOLINE_SIZE);
+    esp -= sizeof(hw_context_t);
+    memcpy((void*)esp, regs, sizeof(hw_context_t));
+    esp -= sizeof(uint32_t);
+    *(uint32_t*)esp = signum;
+    esp -= sizeof(uint32_t);
+    *(uint32_t*)esp = code;
+
+    regs->esp = esp;
+    regs->eip = handler;
+    return 0;
+}
+
+/*
+ * deliver_signals
+ *   DESCRIPTION: on the way back to user mode, run the next pending signal of the current
+ *                process: push a frame so the process continues in the handler, or take
+ *                the default action and halt it (status 0 for ctrl+c like before, otherwise
+ *                HALT_EXCEPTION). Other signals are masked until the handler calls
+ *                sigreturn. Returns at once when the context is kernel code.
+ *                Called from intr_return with the kernel lock held.
+ *   INPUTS: regs - the context intr_return restores
+ *   OUTPUTS: none
+ */
+void deliver_signals(hw_context_t* regs){
+    pcb_t* pcb;
+    int32_t signum;
+    uint32_t handler;
+
+    if((regs->cs & 0xFFFF) != USER_CS || curr_pid == IDLE_PID){
+        return;
+    }
+    pcb = get_pcb(curr_pid);
+    signum = next_signal(pcb);
+    if(signum < 0){
+        return;
+    }
+    handler = (uint32_t)pcb->group->sig_handlers[signum];
+    if(handler == 0){
+        halt_with_status(signum == SIG_INTERRUPT ? 0 : HALT_EXCEPTION);
+    }
+    if(push_signal_frame(regs, signum, handler) != 0){
+        halt_with_status(HALT_EXCEPTION);
+    }
+    pcb->sig_masked = 1;
+}
+
+/*
+ * signal_exception
+ *   DESCRIPTION: an exception handler found a fault: if it came from user mode, send the
+ *                process signum, which intr_return delivers before the faulting instruction
+ *                runs again. A fault inside a handler cannot be delivered and kills the process.
+ *   INPUTS: regs - the faulting context
+ *           signum - SIG_DIV_ZERO or SIG_SEGFAULT
+ *   OUTPUTS: 1 if the signal was sent, 0 for a fault in the kernel
+ */
+int32_t signal_exception(hw_context_t* regs, int32_t signum){
+    pcb_t* pcb;
+
+    if((regs->cs & 0xFFFF) != USER_CS || curr_pid == IDLE_PID){
+        return 0;
+    }
+    pcb = get_pcb(curr_pid);
+    if(pcb->sig_masked){
+        halt_with_status(HALT_EXCEPTION);
+    }
+    send_signal(pcb, signum);
+    return 1;
+}
+
+/*
+ * reset_signals
+ *   DESCRIPTION: give a process the default action for every signal, with nothing pending,
+ *                no handler running and no alarm
+ *   INPUTS: pcb - the process, with an initialized alarm_timer
+ *   OUTPUTS: none
+ */
+void reset_signals(pcb_t* pcb){
+    int32_t signum;
+
+    del_timer(&pcb->alarm_timer);
+    pcb->sig_pending = 0;
+    pcb->sig_masked = 0;
+    for(signum = 0; signum < NUM_SIGNALS; signum++){
+        pcb->sig_handlers[signum] = NULL;
+    }
+}
+
+/*
+ * set_handler
+ *   DESCRIPTION: system call: run handler_address(signum) when the process gets signum.
+ *                Handlers belong to the process, every thread uses them.
+ *   INPUTS: signum - SIG_*
+ *           handler_address - function in the user page, NULL for the default action
+ *   OUTPUTS: 0, -1 for a bad signal or address
+ */
+int32_t set_handler(int32_t signum, void* handler_address){
+    uint32_t addr = (uint32_t)handler_address;
+
+    if(signum < 0 || signum >= NUM_SIGNALS){
+        return -1;
+    }
+    if(addr != 0 && (addr < USER_MEM_START_VIR || addr >= USER_MEM_START_VIR + PAGE_SIZE_4MB)){
+        return -1;
+    }
+    get_pcb(curr_pid)->group->sig_handlers[signum] = handler_address;
+    return 0;
+}
+
+/*
+ * sigreturn
+ *   DESCRIPTION: system call made by the code a handler returns into: copy the context the
+ *                signal interrupted from the user stack into the int 0x80 frame, so the
+ *                process continues there with every register as the handler left it. The
+ *                segments and privileged eflags bits are not taken from the user stack.
+ *                Unmasks signals.
+ *   INPUTS: none
+ *   OUTPUTS: eax of the restored context, -1 outside a handler
+ */
+int32_t sigreturn(){
+    pcb_t* pcb = get_pcb(curr_pid);
+    hw_context_t* regs = (hw_context_t*)(KERNEL_STACK_TOP(pcb) - sizeof(hw_context_t));
+    hw_context_t* saved = (hw_context_t*)(regs->esp + sizeof(uint32_t));
+
+    if(!pcb->sig_masked){
+        return -1;
+    }
+    if((uint32_t)saved < USER_MEM_START_VIR ||
+       (uint32_t)saved > USER_MEM_START_VIR + PAGE_SIZE_4MB - sizeof(hw_context_t)){
+        halt_with_status(HALT_EXCEPTION);
+    }
+
+    regs->ebx = saved->ebx;
+    regs->ecx = saved->ecx;
+    regs->edx = saved->edx;
+    regs->esi = saved->esi;
+    regs->edi = saved->edi;
+    regs->ebp = saved->ebp;
+    regs->eax = saved->eax;
+    regs->eip = saved->eip;
+    regs->esp = saved->esp;
+    regs->eflags = (regs->eflags & ~EFLAGS_USER) | (saved->eflags & EFLAGS_USER);
+    pcb->sig_masked = 0;
+    return regs->eax;
+}
+
+/*
+ * alarm_timeout
+ *   DESCRIPTION: alarm_timer of a process fired: send it SIG_ALARM
+ *   INPUTS: timer - the process's alarm_timer
+ *   OUTPUTS: none
+ */
+static void alarm_timeout(timer_t* timer){
+    send_signal((pcb_t*)timer->data, SIG_ALARM);
+}
+
+/*
+ * alarm
+ *   DESCRIPTION: system call: send SIG_ALARM to the calling process (or thread) once ms
+ *                milliseconds have passed, rounded up to whole ticks, replacing an alarm
+ *                set earlier. The process keeps running meanwhile.
+ *   INPUTS: ms - milliseconds until the signal, 0 to cancel
+ *   OUTPUTS: 0
+ */
+int32_t alarm(uint32_t ms){
+    pcb_t* pcb = get_pcb(curr_pid);
+    timer_t* timer = &pcb->alarm_timer;
+    uint32_t ticks = (ms + (1000 / PIT_FREQ) - 1) / (1000 / PIT_FREQ);
+
+    del_timer(timer);
+    if(ms == 0){
+        return 0;
+    }
+    timer->fn = alarm_timeout;
+    timer->data = pcb;
+    add_timer(timer, pit_ticks_now() + ticks);
+    return 0;
+}
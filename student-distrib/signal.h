@@ -0,0 +1,67 @@
+#ifndef _SIGNAL_H
+#define _SIGNAL_H
+
+#include "types.h"
+#include "lib.h"
+#include "syscall.h"
+
+#define SIG_DIV_ZERO        0           // divide error or fpu exception; kills by default
+#define SIG_SEGFAULT        1           // any other exception in user mode; kills by default
+#define SIG_INTERRUPT       2           // ctrl+c; kills by default
+#define SIG_ALARM           3           // alarm() expired; ignored by default
+#define SIG_USER1           4           // ignored by default
+
+#define HALT_EXCEPTION      256         // halt status of a process killed by an exception signal
+#define SIGRETURN_NR        10          // system call number of sigreturn (syscall_linkage.S)
+#define SIG_TRAMPOLINE_SIZE 8           // bytes of code on the user stack that call sigreturn
+
+/* Registers of a user context, as the entry wrappers leave them on the kernel stack
+ * (SAVE_ALL in linkage.h) and as a signal frame holds them on the user stack */
+typedef struct hw_context{
+    uint32_t ebx;
+    uint32_t ecx;
+    uint32_t edx;
+    uint32_t esi;
+    uint32_t edi;
+    uint32_t ebp;
+    uint32_t eax;
+    uint32_t ds;
+    uint32_t es;
+    uint32_t fs;
+    uint32_t vector;            //exception number, 0x80 for a system call, -1 for an irq
+    uint32_t error_code;
+    uint32_t eip;
+    uint32_t cs;                //only the low 16 bits are the selector
+    uint32_t eflags;
+    uint32_t esp;               //esp and ss only when cs is USER_CS
+    uint32_t ss;
+} hw_context_t;
+
+//mark signum pending for a process; it runs at the process's next return to user mode
+void send_signal(pcb_t* pcb, int32_t signum);
+
+//take the next signal to deliver to pcb off its pending set, dropping ignored ones; -1 if none
+int32_t next_signal(pcb_t* pcb);
+
+//1 if the current process has a signal to deliver (sysenter return path)
+int32_t signal_pending();
+
+//deliver a pending signal on the way back to user mode (intr_return)
+void deliver_signals(hw_context_t* regs);
+
+//an exception in user mode raises signum for the current process; 0 for a kernel exception
+int32_t signal_exception(hw_context_t* regs, int32_t signum);
+
+//forget the handlers, pending signals and alarm of a process (new program)
+void reset_signals(pcb_t* pcb);
+
+//set the handler of signum for the current process, NULL for the default action (system call)
+int32_t set_handler(int32_t signum, void* handler_address);
+
+//return from a signal handler to the context it interrupted (system call, int 0x80 only)
+int32_t sigreturn();
+
+//send SIG_ALARM to the current process after ms milliseconds, 0 cancels (system call)
+int32_t alarm(uint32_t ms);
+
+#endif /* _SIGNAL_H */
@@ -0,0 +1,546 @@
+#include "smp.h"
+#include "syscall.h"
+#include "pit.h"
+#include "page.h"
+#include "fpu.h"
+#include "sysenter.h"
+
+#define NO_CPU          0xFFFFFFFF      //kernel_lock_owner while nobody holds the kernel lock
+#define EBDA_SEG_PTR    0x40E           //bios data area: segment of the extended bios data area
+#define BASE_MEM_KB     0x413           //bios data area: kb of base memory
+#define BIOS_ROM_START  0xF0000
+#define BIOS_ROM_SIZE   0x10000
+#define AP_START_TICKS  100             //give an application processor one second to come up
+
+//physical address of the local apic registers (from the mp config table)
+static uint32_t lapic_phys = LAPIC_BASE_DEFAULT;
+
+//application processor being started; it does not know its cpu_t before loading its gdt
+static cpu_t* volatile ap_booting;
+
+//big kernel lock
+static spinlock_t kernel_lock_word = SPINLOCK_INIT("kernel");
+static volatile uint32_t kernel_lock_owner = NO_CPU;
+static uint32_t kernel_lock_count;
+
+//local apic register access; the read back makes sure the write reached the apic
+static inline uint32_t lapic_read(uint32_t reg){
+    return lapic[reg >> 2];
+}
+
+static inline void lapic_write(uint32_t reg, uint32_t val){
+    lapic[reg >> 2] = val;
+    (void)lapic[LAPIC_ID >> 2];
+}
+
+/*
+ * tsc_delay_us
+ *   DESCRIPTION: busy wait using the tsc (calibrated by init_pit)
+ *   INPUTS: us - microseconds to wait
+ *   OUTPUTS: none
+ */
+static void tsc_delay_us(uint32_t us){
+    uint32_t start = rdtsc();
+    uint32_t cycles = (tsc_per_tick / (1000000 / PIT_FREQ)) * us;
+    while(rdtsc() - start < cycles){
+        asm volatile ("pause");
+    }
+}
+
+/*
+ * mp_checksum
+ *   DESCRIPTION: mp structures are valid when their bytes add up to 0
+ *   INPUTS: addr, len - the structure
+ *   OUTPUTS: 1 if the checksum is good
+ */
+static uint32_t mp_checksum(uint8_t* addr, uint32_t len){
+    uint8_t sum = 0;
+    uint32_t k;
+    for(k = 0; k < len; k++){
+        sum += addr[k];
+    }
+    return sum == 0;
+}
+
+/*
+ * mp_search
+ *   DESCRIPTION: look for the mp floating pointer structure on 16 byte boundaries of a range
+ *   INPUTS: base, len - physical range to scan
+ *   OUTPUTS: the structure, NULL if it is not there
+ */
+static mp_float_t* mp_search(uint32_t base, uint32_t len){
+    uint32_t addr;
+    for(addr = base; addr + sizeof(mp_float_t) <= base + len; addr += 16){
+        if(strncmp((int8_t*)addr, (int8_t*)"_MP_", 4) == 0 && mp_checksum((uint8_t*)addr, sizeof(mp_float_t))){
+            return (mp_float_t*)addr;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * smp_detect
+ *   DESCRIPTION: find the enabled processors and the local apic address in the mp config
+ *                table the bios left in low memory. Reads physical memory directly, so it
+ *                runs before setup_paging. Without a table the machine is uniprocessor.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void smp_detect(){
+    mp_float_t* mpf;
+    mp_config_t* conf;
+    mp_proc_t* proc;
+    uint8_t* entry;
+    uint32_t k;
+
+    nr_cpus = 1;
+    cpus[BOOT_CPU].id = BOOT_CPU;
+    cpus[BOOT_CPU].online = 1;
+
+    //first kb of the ebda, last kb of base memory, then the bios rom
+    mpf = mp_search((*(uint16_t*)EBDA_SEG_PTR) << 4, 1024);
+    if(mpf == NULL){
+        mpf = mp_search((*(uint16_t*)BASE_MEM_KB) * 1024 - 1024, 1024);
+    }
+    if(mpf == NULL){
+        mpf = mp_search(BIOS_ROM_START, BIOS_ROM_SIZE);
+    }
+    //no table, or one of the default configurations we do not bother with
+    if(mpf == NULL || mpf->config == 0){
+        return;
+    }
+
+    conf = (mp_config_t*)mpf->config;
+    if(strncmp(conf->signature, (int8_t*)"PCMP", 4) != 0 || !mp_checksum((uint8_t*)conf, conf->length)){
+        return;
+    }
+    lapic_phys = conf->lapic_addr;
+
+    entry = (uint8_t*)(conf + 1);
+    for(k = 0; k < conf->entry_count; k++){
+        if(*entry != MP_PROCESSOR){
+            entry += MP_ENTRY_SIZE;
+            continue;
+        }
+        proc = (mp_proc_t*)entry;
+        entry += sizeof(mp_proc_t);
+        if(!(proc->flags & MP_PROC_ENABLED)){
+            continue;
+        }
+        if(proc->flags & MP_PROC_BSP){
+            cpus[BOOT_CPU].apic_id = proc->apic_id;
+        }
+        else if(nr_cpus < MAX_CPUS){
+            cpus[nr_cpus].id = nr_cpus;
+            cpus[nr_cpus].apic_id = proc->apic_id;
+            nr_cpus++;
+        }
+    }
+}
+
+/*
+ * setup_cpu_tables
+ *   DESCRIPTION: give a cpu its own copy of the gdt whose tss descriptor points at the cpu's
+ *                own tss, and load them. From then on this_cpu() works on that cpu.
+ *   INPUTS: cpu - the cpu running this code
+ *   OUTPUTS: none
+ */
+static void setup_cpu_tables(cpu_t* cpu){
+    seg_desc_t the_tss_desc;
+
+    memcpy(cpu->gdt, (void*)gdt_desc.addr, sizeof(cpu->gdt));
+    cpu->gdt_desc.size = sizeof(cpu->gdt) - 1;
+    cpu->gdt_desc.addr = (uint32_t)cpu->gdt;
+
+    //start from the boot tss (ss0, ldt selector) and descriptor, marked not busy
+    memcpy(&cpu->tss, &tss, sizeof(tss_t));
+    the_tss_desc = tss_desc_ptr;
+    the_tss_desc.type = 0x9;
+    SET_TSS_PARAMS(the_tss_desc, &cpu->tss, tss_size);
+    cpu->gdt[KERNEL_TSS >> 3] = the_tss_desc;
+
+    lgdt(&cpu->gdt_desc.size);
+    ltr(KERNEL_TSS);
+    lldt(KERNEL_LDT);
+}
+
+/*
+ * lapic_init
+ *   DESCRIPTION: software enable the local apic of this cpu. The boot cpu keeps receiving the
+ *                8259 interrupts through lint0 (virtual wire mode); the application
+ *                processors only get ipis and their own timer.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+static void lapic_init(){
+    lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | SPURIOUS_VECTOR);
+    lapic_write(LAPIC_TPR, 0);
+    if(this_cpu()->id == BOOT_CPU){
+        lapic_write(LAPIC_LVT_LINT0, LAPIC_EXTINT);
+        lapic_write(LAPIC_LVT_LINT1, LAPIC_NMI);
+    }
+    else{
+        lapic_write(LAPIC_LVT_LINT0, LAPIC_LVT_MASKED);
+        lapic_write(LAPIC_LVT_LINT1, LAPIC_LVT_MASKED);
+    }
+    lapic_write(LAPIC_LVT_ERROR, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_EOI, 0);
+}
+
+/*
+ * calibrate_lapic_timer
+ *   DESCRIPTION: count lapic timer ticks during one scheduler tick worth of tsc cycles; every
+ *                cpu's timer runs off the same bus clock
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+static void calibrate_lapic_timer(){
+    uint32_t start;
+
+    lapic_write(LAPIC_TIMER_INIT, 0xFFFFFFFF);
+    start = rdtsc();
+    while(rdtsc() - start < tsc_per_tick){};
+    lapic_ticks_per_tick = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CURR);
+    lapic_write(LAPIC_TIMER_INIT, 0);
+    if(lapic_ticks_per_tick == 0){
+        lapic_ticks_per_tick = 1;
+    }
+}
+
+/*
+ * lapic_send_ipi
+ *   DESCRIPTION: send an inter-processor interrupt and wait until the apic accepted it
+ *   INPUTS: apic_id - destination
+ *           icr - delivery mode, level and vector
+ *   OUTPUTS: none
+ */
+static void lapic_send_ipi(uint32_t apic_id, uint32_t icr){
+    lapic_write(LAPIC_ICR_HIGH, apic_id << 24);
+    lapic_write(LAPIC_ICR_LOW, icr);
+    while(lapic_read(LAPIC_ICR_LOW) & ICR_PENDING){
+        asm volatile ("pause");
+    }
+}
+
+/*
+ * start_ap
+ *   DESCRIPTION: give an application processor an idle stack and wake it with the
+ *                INIT-SIPI-SIPI sequence; it starts in the trampoline at AP_TRAMPOLINE
+ *   INPUTS: cpu - the processor to start
+ *   OUTPUTS: 1 once it is online, 0 if it did not come up
+ */
+static uint32_t start_ap(cpu_t* cpu){
+    uint32_t start;
+    uint32_t k;
+
+    //its idle task lives at the bottom of its boot stack, like the boot cpu's
+    cpu->idle = (pcb_t*)alloc_kernel_stack();
+    if(cpu->idle == NULL){
+        return 0;
+    }
+    ap_boot_esp = KERNEL_STACK_TOP(cpu->idle);
+    ap_booting = cpu;
+
+    lapic_send_ipi(cpu->apic_id, ICR_INIT | ICR_LEVEL_TRIGGER | ICR_LEVEL_ASSERT);
+    tsc_delay_us(200);
+    lapic_send_ipi(cpu->apic_id, ICR_INIT | ICR_LEVEL_TRIGGER);
+    tsc_delay_us(10000);
+    for(k = 0; k < 2; k++){
+        lapic_send_ipi(cpu->apic_id, ICR_STARTUP | (AP_TRAMPOLINE >> KB_PAGE_NUM_OFFSET));
+        tsc_delay_us(200);
+    }
+
+    start = rdtsc();
+    for(k = 0; k < AP_START_TICKS && !cpu->online; ){
+        if(rdtsc() - start >= tsc_per_tick){
+            start = rdtsc();
+            k++;
+        }
+    }
+    return cpu->online;
+}
+
+/*
+ * smp_init
+ *   DESCRIPTION: map the local apic, move the boot cpu to its own gdt and tss, and start the
+ *                application processors found by smp_detect one at a time. They wait for the
+ *                kernel lock, which the boot cpu holds until start_idle.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void smp_init(){
+    page_dir_entry_mb lapic_pde;
+    page_table_entry tramp_pte;
+    uint32_t eax, ebx, ecx, edx;
+    uint32_t k;
+
+    setup_cpu_tables(&cpus[BOOT_CPU]);
+
+    asm volatile ("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+    if(!(edx & CPUID_APIC)){
+        nr_cpus = 1;
+        return;
+    }
+
+    //one uncached supervisor 4MB page for the apic registers; user page directories are
+    //copies of page_directory made later, so they get it too
+    setup_page_dir_entry_mb(&lapic_pde, 1, 1, 0, 1, 1, 0, 0, 1, 0, 0, 0, 0, lapic_phys >> MB_PAGE_NUM_OFFSET);
+    page_directory[lapic_phys >> MB_PAGE_NUM_OFFSET] = *(int*)&lapic_pde;
+    load_page_directory(page_directory);
+    lapic = (volatile uint32_t*)lapic_phys;
+
+    cpus[BOOT_CPU].apic_id = lapic_read(LAPIC_ID) >> 24;
+    lapic_init();
+    calibrate_lapic_timer();
+
+    if(nr_cpus == 1){
+        return;
+    }
+
+    //the trampoline runs before paging, it only needs to be at AP_TRAMPOLINE while we copy it
+    *(uint16_t*)ap_trampoline_gdt = gdt_desc.size;
+    *(uint32_t*)(ap_trampoline_gdt + 2) = gdt_desc.addr;
+    setup_page_table_entry(&tramp_pte, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, AP_TRAMPOLINE >> KB_PAGE_NUM_OFFSET);
+    page_table[AP_TRAMPOLINE >> KB_PAGE_NUM_OFFSET] = tramp_pte;
+    load_page_directory(page_directory);
+    memcpy((void*)AP_TRAMPOLINE, ap_trampoline, ap_trampoline_end - ap_trampoline);
+
+    for(k = 1; k < nr_cpus; k++){
+        if(!start_ap(&cpus[k])){
+            printf("smp: cpu %d (apic %d) did not start\n", k, cpus[k].apic_id);
+            break;
+        }
+    }
+    nr_cpus = k;
+
+    setup_page_table_entry(&tramp_pte, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    page_table[AP_TRAMPOLINE >> KB_PAGE_NUM_OFFSET] = tramp_pte;
+    load_page_directory(page_directory);
+}
+
+/*
+ * ap_main
+ *   DESCRIPTION: C entry of an application processor (from ap_start32 in smp_asm.S, on the
+ *                stack start_ap gave it): load its own gdt and tss, enable its apic, fpu and sysenter,
+ *                report online and become this cpu's idle task
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void ap_main(){
+    cpu_t* cpu = ap_booting;
+
+    setup_cpu_tables(cpu);
+    cpu->tss.esp0 = ap_boot_esp;
+    lapic_init();
+    init_fpu();
+    init_sysenter();
+
+    cpu->running_pid = IDLE_PID;
+    cpu->term_idx = 0;
+    cpu->online = 1;
+    start_idle();
+}
+
+/*
+ * smp_place_process
+ *   DESCRIPTION: pick the online cpu with the fewest processes for a new process and count it
+ *   INPUTS: none
+ *   OUTPUTS: index of the cpu
+ */
+uint32_t smp_place_process(){
+    uint32_t best = BOOT_CPU;
+    uint32_t k;
+    for(k = 0; k < nr_cpus; k++){
+        if(cpus[k].online && cpus[k].nr_procs < cpus[best].nr_procs){
+            best = k;
+        }
+    }
+    cpus[best].nr_procs++;
+    return best;
+}
+
+/*
+ * smp_move_process
+ *   DESCRIPTION: place a process on another cpu. It must not be on a run queue, and must not
+ *                own the fpu of another cpu: its fpu state stays in that cpu's registers until
+ *                another process there needs them.
+ *   INPUTS: pcb - the process
+ *           cpu_id - its new cpu
+ *   OUTPUTS: none
+ */
+void smp_move_process(pcb_t* pcb, uint32_t cpu_id){
+    cpus[pcb->cpu].nr_procs--;
+    pcb->cpu = cpu_id;
+    cpus[cpu_id].nr_procs++;
+}
+
+/*
+ * smp_send_resched
+ *   DESCRIPTION: interrupt another cpu so it looks at its run queue (wakes it from hlt)
+ *   INPUTS: cpu_id - target cpu
+ *   OUTPUTS: none
+ */
+void smp_send_resched(uint32_t cpu_id){
+    if(lapic == NULL || cpu_id == this_cpu()->id || !cpus[cpu_id].online){
+        return;
+    }
+    lapic_send_ipi(cpus[cpu_id].apic_id, RESCHED_VECTOR);
+}
+
+/*
+ * lapic_timer_start / lapic_timer_stop
+ *   DESCRIPTION: run this cpu's scheduler tick every 10ms, or stop it while the cpu idles
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void lapic_timer_start(){
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_TIMER_PERIODIC | LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_TIMER_INIT, lapic_ticks_per_tick);
+}
+
+void lapic_timer_stop(){
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_TIMER_INIT, 0);
+}
+
+/*
+ * lapic_timer_handler
+ *   DESCRIPTION: scheduler tick of an application processor (the boot cpu ticks from the PIT)
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void lapic_timer_handler(){
+    lapic_write(LAPIC_EOI, 0);
+    scheduler_tick();
+}
+
+/*
+ * resched_ipi_handler
+ *   DESCRIPTION: another cpu queued a process here, sent a signal to the running process or
+ *                asked us to halt it (the main thread of a running thread is halting). Waking
+ *                from hlt is enough for the idle loop; a signal is delivered when this
+ *                interrupt returns to user mode; a running process is preempted if the new
+ *                one has a higher priority.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void resched_ipi_handler(){
+    lapic_write(LAPIC_EOI, 0);
+    //a thread whose main thread is halting
+    if(curr_pid != IDLE_PID && get_pcb(curr_pid)->kill_pending){
+        halt(0);
+    }
+    preempt_check();
+}
+
+/*
+ * spurious_handler
+ *   DESCRIPTION: the apic raised its spurious vector; it must not be acknowledged
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void spurious_handler(){
+}
+
+/*
+ * kernel_lock
+ *   DESCRIPTION: take the big kernel lock, or go one level deeper if this cpu already holds
+ *                it. Spins with interrupts as they were so a waiting cpu still takes its own
+ *                interrupts (whose handlers spin here too).
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void kernel_lock(){
+    uint32_t flags;
+
+    cli_and_save(flags);
+    if(kernel_lock_owner == this_cpu()->id){
+        kernel_lock_count++;
+        restore_flags(flags);
+        return;
+    }
+    while(!spin_trylock(&kernel_lock_word)){
+        restore_flags(flags);
+        while(kernel_lock_word.locked){
+            asm volatile ("pause");
+        }
+        cli_and_save(flags);
+    }
+    //an interrupt while spinning may have switched us out; look up the cpu again
+    kernel_lock_owner = this_cpu()->id;
+    kernel_lock_count = 1;
+    restore_flags(flags);
+}
+
+/*
+ * kernel_unlock
+ *   DESCRIPTION: leave one level of the kernel lock, releasing it at the outermost level
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void kernel_unlock(){
+    uint32_t flags;
+
+    cli_and_save(flags);
+    if(--kernel_lock_count == 0){
+        kernel_lock_owner = NO_CPU;
+        spin_unlock(&kernel_lock_word);
+    }
+    restore_flags(flags);
+}
+
+/*
+ * kernel_lock_depth
+ *   DESCRIPTION: how deep this cpu holds the kernel lock; a process switched out keeps its
+ *                depth in switch_to_process() and gets it back when it runs again
+ *   INPUTS: none
+ *   OUTPUTS: depth, 0 if this cpu does not hold the lock
+ */
+uint32_t kernel_lock_depth(){
+    uint32_t flags;
+    uint32_t depth = 0;
+
+    cli_and_save(flags);
+    if(kernel_lock_owner == this_cpu()->id){
+        depth = kernel_lock_count;
+    }
+    restore_flags(flags);
+    return depth;
+}
+
+/*
+ * kernel_lock_set_depth
+ *   DESCRIPTION: set the depth of the kernel lock this cpu holds after resuming a process at
+ *                a different depth. 0 releases the lock: used on every way back to user mode
+ *                that does not return through a kernel entry wrapper (first run of a process,
+ *                execute, root shell restart). Call with interrupts disabled.
+ *   INPUTS: depth - new depth
+ *   OUTPUTS: none
+ */
+void kernel_lock_set_depth(uint32_t depth){
+    if(depth == 0){
+        if(kernel_lock_owner == this_cpu()->id){
+            kernel_lock_count = 0;
+            kernel_lock_owner = NO_CPU;
+            spin_unlock(&kernel_lock_word);
+        }
+        return;
+    }
+    kernel_lock_count = depth;
+}
+
+/*
+ * print_smp_stats
+ *   DESCRIPTION: print the processes, ticks, context switches and yields of every cpu
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void print_smp_stats(){
+    uint32_t k;
+    for(k = 0; k < nr_cpus; k++){
+        printf("cpu%d: apic=%d procs=%u ticks=%u switches=%u yields=%u\n", k, cpus[k].apic_id,
+               cpus[k].nr_procs, cpus[k].ticks, cpus[k].switches, cpus[k].yields);
+    }
+}
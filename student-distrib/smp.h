@@ -0,0 +1,198 @@
+#ifndef _SMP_H
+#define _SMP_H
+
+#include "types.h"
+#include "lib.h"
+#include "x86_desc.h"
+
+#define MAX_CPUS            8           // most cpus brought up
+#define BOOT_CPU            0           // index of the cpu that ran entry()
+#define GDT_ENTRIES         8           // null, null, kernel cs/ds, user cs/ds, tss, ldt
+
+#define SCHED_LEVELS        3           //number of MLFQ priority levels, 0 is the highest
+
+#define LAPIC_BASE_DEFAULT  0xFEE00000  // local apic registers unless the mp table says otherwise
+#define LAPIC_ID            0x020       // apic id in bits 31:24
+#define LAPIC_TPR           0x080       // task priority
+#define LAPIC_EOI           0x0B0       // end of interrupt
+#define LAPIC_SVR           0x0F0       // spurious vector and software enable
+#define LAPIC_ICR_LOW       0x300       // interrupt command register (writing the low half sends)
+#define LAPIC_ICR_HIGH      0x310       // destination apic id in bits 31:24
+#define LAPIC_LVT_TIMER     0x320
+#define LAPIC_LVT_LINT0     0x350
+#define LAPIC_LVT_LINT1     0x360
+#define LAPIC_LVT_ERROR     0x370
+#define LAPIC_TIMER_INIT    0x380       // initial count
+#define LAPIC_TIMER_CURR    0x390       // current count
+#define LAPIC_TIMER_DIV     0x3E0       // divide configuration
+
+#define LAPIC_SVR_ENABLE    0x100
+#define LAPIC_LVT_MASKED    0x10000
+#define LAPIC_TIMER_PERIODIC 0x20000
+#define LAPIC_TIMER_DIV_16  0x3
+#define LAPIC_EXTINT        0x700       // lint0 delivers the 8259 interrupts (virtual wire mode)
+#define LAPIC_NMI           0x400
+#define ICR_INIT            0x500
+#define ICR_STARTUP         0x600
+#define ICR_LEVEL_ASSERT    0x4000
+#define ICR_LEVEL_TRIGGER   0x8000
+#define ICR_PENDING         0x1000      // delivery status: the ipi has not been accepted yet
+
+#define LAPIC_TIMER_VECTOR  0x40        // per-cpu scheduler tick on the application processors
+#define RESCHED_VECTOR      0x41        // ipi: a process was queued on this cpu (or should halt)
+#define SPURIOUS_VECTOR     0xFF
+
+#define AP_TRAMPOLINE       0x7000      // real mode startup code for the application processors (4KB aligned, below 1MB)
+
+#define MP_PROCESSOR        0           // mp config table entry types (processor entries are 20 bytes, the rest 8)
+#define MP_PROC_ENABLED     0x01
+#define MP_PROC_BSP         0x02
+#define MP_ENTRY_SIZE       8
+
+#define CPUID_APIC          (1 << 9)    // cpuid 1 edx: on-chip local apic
+
+struct pcb;
+
+// MP floating pointer structure, found by its "_MP_" signature in low memory
+typedef struct __attribute__((packed)) mp_float{
+    int8_t signature[4];
+    uint32_t config;            //physical address of the mp config table, 0 for a default configuration
+    uint8_t length;             //in 16 byte units
+    uint8_t spec_rev;
+    uint8_t checksum;
+    uint8_t features[5];
+} mp_float_t;
+
+// MP configuration table header, followed by entry_count entries
+typedef struct __attribute__((packed)) mp_config{
+    int8_t signature[4];        //"PCMP"
+    uint16_t length;
+    uint8_t spec_rev;
+    uint8_t checksum;
+    int8_t oem_id[8];
+    int8_t product_id[12];
+    uint32_t oem_table;
+    uint16_t oem_table_size;
+    uint16_t entry_count;
+    uint32_t lapic_addr;
+    uint16_t ext_length;
+    uint8_t ext_checksum;
+    uint8_t reserved;
+} mp_config_t;
+
+// MP config table processor entry
+typedef struct __attribute__((packed)) mp_proc{
+    uint8_t type;               //MP_PROCESSOR
+    uint8_t apic_id;
+    uint8_t apic_version;
+    uint8_t flags;              //MP_PROC_ENABLED, MP_PROC_BSP
+    uint32_t signature;
+    uint32_t features;
+    uint32_t reserved[2];
+} mp_proc_t;
+
+//FIFO of PROC_READY processes of one priority level, linked through pcb->run_next
+typedef struct run_queue{
+    struct pcb* head;
+    struct pcb* tail;
+    uint32_t count;
+} run_queue_t;
+
+// Per-cpu state. The gdt must stay the first member: this_cpu() finds the cpu_t from the gdtr.
+typedef struct cpu{
+    seg_desc_t gdt[GDT_ENTRIES] __attribute__((aligned (16)));  //copy of the boot gdt with this cpu's tss
+    x86_desc_t gdt_desc;
+    tss_t tss;                  //esp0 of the process running on this cpu
+    uint32_t id;                //index in cpus[]
+    uint32_t apic_id;
+    volatile uint32_t online;   //set by the cpu once it reached its idle loop
+    uint32_t running_pid;       //process running on this cpu, IDLE_PID when none is (curr_pid)
+    int term_idx;               //terminal of the running process (active_term_idx)
+    struct pcb* idle;           //this cpu's idle task, the pcb at the bottom of its boot stack
+    struct pcb* fpu_owner;      //process whose fpu state is in this cpu's registers
+    struct pcb* zombie;         //orphan that halted here, freed by reap_zombie after the switch
+    run_queue_t run_queues[SCHED_LEVELS];
+    uint32_t nr_procs;          //live processes placed on this cpu
+    uint32_t ticks;             //scheduler ticks taken
+    uint32_t switches;          //context switches done
+    uint32_t yields;            //yield() calls that gave the cpu away
+    uint32_t load_avg;          //decayed count of runnable processes, in LOAD_SCALE units (pit.c)
+    uint32_t load_tick;         //pit_ticks at the last load_avg update
+    uint32_t steals;            //processes this cpu took from others while idle
+    uint32_t stolen;            //processes other cpus took from this one
+    uint32_t steal_cycles;      //tsc cycles spent in steal_work (migration cost)
+} cpu_t;
+
+cpu_t cpus[MAX_CPUS];
+uint32_t nr_cpus;
+
+// mapped local apic registers, NULL until smp_init (uniprocessor)
+volatile uint32_t* lapic;
+
+// lapic timer counts (divided by 16) per 10ms scheduler tick, measured on the boot cpu
+uint32_t lapic_ticks_per_tick;
+
+/* The cpu running this code. Every cpu loads its own copy of the gdt, so the gdtr base
+ * points into its cpu_t; before smp_init the boot gdt is loaded and this is the boot cpu. */
+static inline cpu_t* this_cpu(void) {
+    struct {
+        uint16_t limit;
+        uint32_t base;
+    } __attribute__((packed)) gdtr;
+    uint32_t offset;
+    asm volatile ("sgdt %0" : "=m"(gdtr));
+    offset = gdtr.base - (uint32_t)cpus;
+    if (offset < sizeof(cpus)) {
+        return &cpus[offset / sizeof(cpu_t)];
+    }
+    return &cpus[BOOT_CPU];
+}
+
+// find the processors in the mp tables (call before paging is enabled)
+void smp_detect();
+
+// map the local apic and start every application processor found by smp_detect
+void smp_init();
+
+// body of an application processor once it runs 32 bit code with paging (never returns)
+void ap_main();
+
+// cpu with the fewest processes, for a new process
+uint32_t smp_place_process();
+
+// move a process that is not running (or is about to run here) to another cpu's run queue
+void smp_move_process(struct pcb* pcb, uint32_t cpu_id);
+
+// send the reschedule ipi to another cpu
+void smp_send_resched(uint32_t cpu_id);
+
+// stop and restart the lapic timer of this cpu (idle application processors)
+void lapic_timer_stop();
+void lapic_timer_start();
+
+// lapic timer, reschedule ipi and spurious interrupt handlers
+void lapic_timer_handler();
+void resched_ipi_handler();
+void spurious_handler();
+
+// Big kernel lock: one cpu at a time runs kernel code. Taken on every kernel entry and
+// recursive on the same cpu (an interrupt can arrive while a syscall holds it).
+void kernel_lock();
+void kernel_unlock();
+
+// depth of the kernel lock held by this cpu, saved across context switches
+uint32_t kernel_lock_depth();
+
+// set the depth of the kernel lock this cpu holds; 0 releases it (return to user mode)
+void kernel_lock_set_depth(uint32_t depth);
+
+// print per-cpu counters (ctrl+s)
+void print_smp_stats();
+
+// real mode startup code copied to AP_TRAMPOLINE and its data (smp_asm.S)
+extern uint8_t ap_trampoline[];
+extern uint8_t ap_trampoline_end[];
+extern uint8_t ap_trampoline_gdt[];
+extern uint32_t ap_boot_esp;
+
+#endif /* _SMP_H */
@@ -0,0 +1,285 @@
+#include "sync.h"
+#include "syscall.h"
+
+/*
+ * mutex_init
+ *   DESCRIPTION: set up an unlocked mutex with no waiters
+ *   INPUTS: m - the mutex
+ *           name - shown in debug output
+ *   OUTPUTS: none
+ */
+void mutex_init(mutex_t* m, const int8_t* name){
+    init_wait_queue(&m->wq);
+    m->locked = 0;
+    m->owner = NULL;
+    m->held_next = NULL;
+    m->contended = 0;
+    m->name = name;
+}
+
+/*
+ * mutex_give
+ *   DESCRIPTION: make pcb the owner of m and remember it in the pcb so halt() can release it.
+ *                The idle task never halts and has no list. Call with m->wq.lock held.
+ *   INPUTS: m - the mutex
+ *           pcb - the new owner
+ *   OUTPUTS: none
+ */
+static void mutex_give(mutex_t* m, pcb_t* pcb){
+    m->locked = 1;
+    m->owner = pcb;
+    m->held_next = NULL;
+    if(pcb != this_cpu()->idle){
+        m->held_next = pcb->held_mutexes;
+        pcb->held_mutexes = m;
+    }
+}
+
+/*
+ * mutex_release
+ *   DESCRIPTION: take m off its owner's list and hand it to the first waiter, or leave it
+ *                free when nobody waits. The waiter is woken holding the mutex already.
+ *   INPUTS: m - a locked mutex
+ *   OUTPUTS: none
+ */
+static void mutex_release(mutex_t* m){
+    uint32_t flags;
+    pcb_t* owner;
+    mutex_t** link;
+
+    spin_lock_irqsave(&m->wq.lock, flags);
+    owner = m->owner;
+    if(owner != NULL && owner != this_cpu()->idle){
+        for(link = &owner->held_mutexes; *link != NULL; link = &(*link)->held_next){
+            if(*link == m){
+                *link = m->held_next;
+                break;
+            }
+        }
+    }
+
+    if(m->wq.head == NULL){
+        m->locked = 0;
+        m->owner = NULL;
+        m->held_next = NULL;
+        spin_unlock_irqrestore(&m->wq.lock, flags);
+        return;
+    }
+
+    //hand off: the waiter at the head owns the mutex before it even runs
+    mutex_give(m, m->wq.head->proc);
+    spin_unlock_irqrestore(&m->wq.lock, flags);
+    wake_up_nr(&m->wq, 0, 1);
+}
+
+/*
+ * mutex_lock
+ *   DESCRIPTION: take m. While another process holds it the caller sleeps on the mutex's
+ *                wait queue and the cpu runs someone else; mutex_unlock wakes it as the new
+ *                owner. Not for interrupt handlers or the idle task, which cannot sleep.
+ *   INPUTS: m - the mutex
+ *   OUTPUTS: none
+ */
+void mutex_lock(mutex_t* m){
+    uint32_t flags;
+    pcb_t* curr_pcb = get_pcb(curr_pid);
+
+    spin_lock_irqsave(&m->wq.lock, flags);
+    if(!m->locked){
+        mutex_give(m, curr_pcb);
+        spin_unlock_irqrestore(&m->wq.lock, flags);
+        return;
+    }
+
+    m->contended++;
+    while(m->owner != curr_pcb){
+        sleep_on_locked(&m->wq, 0);
+    }
+    spin_unlock_irqrestore(&m->wq.lock, flags);
+}
+
+/*
+ * mutex_trylock
+ *   DESCRIPTION: take m only if nobody holds it
+ *   INPUTS: m - the mutex
+ *   OUTPUTS: 1 if the caller now holds m, 0 otherwise
+ */
+int32_t mutex_trylock(mutex_t* m){
+    uint32_t flags;
+    int32_t taken = 0;
+
+    spin_lock_irqsave(&m->wq.lock, flags);
+    if(!m->locked){
+        mutex_give(m, get_pcb(curr_pid));
+        taken = 1;
+    }
+    spin_unlock_irqrestore(&m->wq.lock, flags);
+    return taken;
+}
+
+/*
+ * mutex_unlock
+ *   DESCRIPTION: release m, handing it to the process that waited longest
+ *   INPUTS: m - a mutex held by the caller
+ *   OUTPUTS: none
+ */
+void mutex_unlock(mutex_t* m){
+    mutex_release(m);
+}
+
+/*
+ * mutex_release_all
+ *   DESCRIPTION: release every mutex pcb still holds. A process halted while sleeping with a
+ *                mutex (ctrl+c during a terminal read) would otherwise block the other
+ *                processes on that mutex forever. Call after remove_wait().
+ *   INPUTS: pcb - the halting process
+ *   OUTPUTS: none
+ */
+void mutex_release_all(pcb_t* pcb){
+    while(pcb->held_mutexes != NULL){
+        mutex_release(pcb->held_mutexes);
+    }
+}
+
+/*
+ * sem_init
+ *   DESCRIPTION: set up a semaphore
+ *   INPUTS: sem - the semaphore
+ *           count - units available at first
+ *   OUTPUTS: none
+ */
+void sem_init(semaphore_t* sem, int32_t count){
+    init_wait_queue(&sem->wq);
+    sem->count = count;
+}
+
+/*
+ * sem_down
+ *   DESCRIPTION: take a unit of sem, sleeping while none is left
+ *   INPUTS: sem - the semaphore
+ *   OUTPUTS: none
+ */
+void sem_down(semaphore_t* sem){
+    uint32_t flags;
+
+    spin_lock_irqsave(&sem->wq.lock, flags);
+    while(sem->count <= 0){
+        sleep_on_locked(&sem->wq, 0);
+    }
+    sem->count--;
+    spin_unlock_irqrestore(&sem->wq.lock, flags);
+}
+
+/*
+ * sem_trydown
+ *   DESCRIPTION: take a unit of sem without sleeping
+ *   INPUTS: sem - the semaphore
+ *   OUTPUTS: 1 if a unit was taken, 0 if none was left
+ */
+int32_t sem_trydown(semaphore_t* sem){
+    uint32_t flags;
+    int32_t taken = 0;
+
+    spin_lock_irqsave(&sem->wq.lock, flags);
+    if(sem->count > 0){
+        sem->count--;
+        taken = 1;
+    }
+    spin_unlock_irqrestore(&sem->wq.lock, flags);
+    return taken;
+}
+
+/*
+ * sem_up
+ *   DESCRIPTION: give a unit of sem back and wake the longest waiter; it takes the unit
+ *                when it runs (or sleeps again if someone was faster)
+ *   INPUTS: sem - the semaphore
+ *   OUTPUTS: none
+ */
+void sem_up(semaphore_t* sem){
+    uint32_t flags;
+
+    spin_lock_irqsave(&sem->wq.lock, flags);
+    sem->count++;
+    spin_unlock_irqrestore(&sem->wq.lock, flags);
+    wake_up_nr(&sem->wq, 0, 1);
+}
+
+/*
+ * init_futex
+ *   DESCRIPTION: set up the futex hash buckets
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void init_futex(){
+    int i;
+    for(i = 0; i < FUTEX_BUCKETS; i++){
+        init_wait_queue(&futex_queues[i]);
+    }
+}
+
+/*
+ * futex_key
+ *   DESCRIPTION: physical address of a futex word in the current process's 4MB user page.
+ *                Processes sharing the frame get the same key for the same word.
+ *   INPUTS: addr - user virtual address of the futex word
+ *   OUTPUTS: the key (never 0), 0 if addr is not an aligned word of the user page
+ */
+static uint32_t futex_key(uint32_t* addr){
+    uint32_t vaddr = (uint32_t)addr;
+    pcb_t* curr_pcb = get_pcb(curr_pid);
+
+    if(vaddr < USER_MEM_START_VIR || vaddr > USER_MEM_START_VIR + PAGE_SIZE_4MB - sizeof(uint32_t)){
+        return 0;
+    }
+    if(vaddr & (sizeof(uint32_t) - 1)){
+        return 0;
+    }
+    return USER_MEM_START_PHY + curr_pcb->user_frame * PAGE_SIZE_4MB + (vaddr - USER_MEM_START_VIR);
+}
+
+/*
+ * futex_wait
+ *   DESCRIPTION: system call: sleep until futex_wake() on the same word, unless the word no
+ *                longer holds val. The compare happens under the bucket lock, so a wake up
+ *                sent after the user changed the word cannot be lost. User locks only make
+ *                this call when they find the lock taken.
+ *   INPUTS: addr - futex word in the user page
+ *           val - value the caller saw in the word
+ *   OUTPUTS: 0 once woken, -1 for a bad address or if *addr != val
+ */
+int32_t futex_wait(uint32_t* addr, uint32_t val){
+    uint32_t flags;
+    uint32_t key = futex_key(addr);
+    wait_queue_t* wq;
+
+    if(key == 0){
+        return -1;
+    }
+    wq = &futex_queues[(key >> 2) & (FUTEX_BUCKETS - 1)];
+
+    spin_lock_irqsave(&wq->lock, flags);
+    if(*addr != val){
+        spin_unlock_irqrestore(&wq->lock, flags);
+        return -1;
+    }
+    sleep_on_locked(wq, key);
+    spin_unlock_irqrestore(&wq->lock, flags);
+    return 0;
+}
+
+/*
+ * futex_wake
+ *   DESCRIPTION: system call: wake up to n processes sleeping in futex_wait() on the word
+ *   INPUTS: addr - futex word in the user page
+ *           n - most processes to wake
+ *   OUTPUTS: number of processes woken, -1 for a bad address
+ */
+int32_t futex_wake(uint32_t* addr, uint32_t n){
+    uint32_t key = futex_key(addr);
+
+    if(key == 0){
+        return -1;
+    }
+    return wake_up_nr(&futex_queues[(key >> 2) & (FUTEX_BUCKETS - 1)], key, n);
+}
@@ -0,0 +1,69 @@
+#ifndef _SYNC_H
+#define _SYNC_H
+
+#include "types.h"
+#include "lib.h"
+#include "wait_queue.h"
+
+#define FUTEX_BUCKETS       16          // hash buckets of futex sleepers (power of two)
+
+struct pcb;
+
+/* Sleeping lock for code that may block while holding it (terminal reads, fd table).
+ * A waiter sleeps on wq instead of spinning; unlock hands the mutex straight to the
+ * first waiter so a process arriving later cannot take it away again. */
+typedef struct mutex{
+    wait_queue_t wq;            //waiters; wq.lock also guards the fields below
+    uint32_t locked;
+    struct pcb* owner;          //process holding the mutex, NULL when free
+    struct mutex* held_next;    //next mutex held by owner (pcb->held_mutexes)
+    uint32_t contended;         //lock calls that had to sleep
+    const int8_t* name;
+} mutex_t;
+
+// Counting semaphore: sem_down sleeps while count is 0
+typedef struct semaphore{
+    wait_queue_t wq;            //waiters; wq.lock also guards count
+    int32_t count;
+} semaphore_t;
+
+// futex sleepers, hashed by the physical address of the futex word
+wait_queue_t futex_queues[FUTEX_BUCKETS];
+
+//set up an unlocked mutex
+void mutex_init(mutex_t* m, const int8_t* name);
+
+//take m, sleeping until it is free (not from interrupt handlers)
+void mutex_lock(mutex_t* m);
+
+//take m if it is free; 1 on success, 0 if someone holds it
+int32_t mutex_trylock(mutex_t* m);
+
+//release m and hand it to the first waiter
+void mutex_unlock(mutex_t* m);
+
+//release every mutex a halting process still holds (e.g. ctrl+c while reading)
+void mutex_release_all(struct pcb* pcb);
+
+//set up a semaphore with count units available
+void sem_init(semaphore_t* sem, int32_t count);
+
+//take a unit, sleeping until one is available
+void sem_down(semaphore_t* sem);
+
+//take a unit if one is available; 1 on success, 0 otherwise
+int32_t sem_trydown(semaphore_t* sem);
+
+//give a unit back and wake one waiter (may be called from interrupt handlers)
+void sem_up(semaphore_t* sem);
+
+//set up the futex hash buckets
+void init_futex();
+
+//sleep while the user word at addr still holds val; 0 once woken, -1 if the value differed
+int32_t futex_wait(uint32_t* addr, uint32_t val);
+
+//wake at most n processes sleeping on the user word at addr; returns how many woke
+int32_t futex_wake(uint32_t* addr, uint32_t n);
+
+#endif /* _SYNC_H */
@@ -1,24 +1,178 @@
 #include "syscall.h"
+#include "pit.h"
+#include "pipe.h"
+#include "poll.h"
+#include "kdata.h"
+#include "signal.h"
+
+static int32_t release_fd(pcb_t* group, int32_t fd);
+static int32_t release_fd_locked(pcb_t* group, int32_t fd);
+static void inherit_files(pcb_t* pcb, int32_t in_fd, int32_t out_fd);
+
+/* 
+ * release_children
+ *   DESCRIPTION: called when a process halts or restarts: free its halted background
+ *                children and orphan the running ones so they free their own pid when they halt
+ *   INPUTS: parent - the process going away
+ *   OUTPUTS: none
+ */
+static void release_children(pcb_t* parent){
+    pcb_t* child;
+    pcb_t* next;
+    for(child = process_list; child != NULL; child = next){
+        next = child->all_next;
+        if(child->background && child->parent_pid == parent->pid){
+            if(child->state == PROC_ZOMBIE){
+                free_process(child);
+            }
+            else{
+                child->parent_pid = -1;
+            }
+        }
+    }
+}
+
+/* 
+ * reap_threads
+ *   DESCRIPTION: called by a halting main thread: free every other thread of its process.
+ *                A thread switched out in the kernel (ready or sleeping) or already a zombie
+ *                is freed right away. One running on another cpu is asked to halt from its
+ *                reschedule ipi and freed once it is off that cpu; we sleep until then.
+ *   INPUTS: group - the main thread
+ *   OUTPUTS: none
+ */
+static void reap_threads(pcb_t* group){
+    uint32_t flags;
+    uint32_t running;
+    pcb_t* thread;
+
+    cli_and_save(flags);
+    group->group_exiting = 1;
+    while(1){
+        running = 0;
+        for(thread = process_list; thread != NULL; thread = thread->all_next){
+            if(thread->group != group || thread == group){
+                continue;
+            }
+            if(thread->state != PROC_RUNNING){
+                break;
+            }
+            thread->kill_pending = 1;
+            smp_send_resched(thread->cpu);
+            running = 1;
+        }
+
+        if(thread != NULL){
+            //freeing may free the thread's own zombie children too, so scan again afterwards
+            remove_wait(thread);
+            mutex_release_all(thread);
+            run_queue_remove(thread);
+            release_children(thread);
+            free_process(thread);
+            continue;
+        }
+        if(!running){
+            break;
+        }
+        //halt() of the thread, or switch_to_process() taking it off its cpu, wakes us
+        sleep_on(&group->thread_wq);
+    }
+    //a root shell restarts with the same pcb
+    group->group_exiting = 0;
+    restore_flags(flags);
+}
 
 /* 
  * halt
+ *   DESCRIPTION: system call: terminates current process and return back to the parent process
+ *   INPUTS: status (returned to the parent process)
+ *   OUTPUTS: does not return
+ */
+int32_t halt(uint8_t status) {
+    return halt_with_status(status);
+}
+
+/* 
+ * halt_with_status
  *   DESCRIPTION: terminates current process and return back to the parent process; 
- *                restart shell if current process is the root shell
+ *                restart shell if current process is the root shell. The status may be
+ *                HALT_EXCEPTION, which halt() cannot pass.
  *   INPUTS: status (returned to the parent process)
  *   OUTPUTS: 0 on success
  */
-int32_t halt(uint8_t status) {
+int32_t halt_with_status(uint32_t status) {
     
-    uint32_t curr_pid = schedule[active_term_idx];
     pcb_t* curr_pcb = get_pcb(curr_pid);
+
+    //a thread: the address space and files stay with the main thread, only the thread goes
+    //away. It is a zombie until thread_join (or the main thread halting) frees it.
+    if(curr_pcb->group != curr_pcb){
+        cli();
+        remove_wait(curr_pcb);
+        mutex_release_all(curr_pcb);
+        run_queue_remove(curr_pcb);
+        release_children(curr_pcb);
+        curr_pcb->exit_status = status;
+        curr_pcb->state = PROC_ZOMBIE;
+        wake_up(&curr_pcb->group->thread_wq);
+        reschedule();
+    }
+
+    //the other threads run in the address space we are about to free
+    reap_threads(curr_pcb);
+
+    //a background process has no execute() frame to return to: it becomes a zombie until
+    //its parent collects the status with wait(), then gives the cpu away for good
+    if(curr_pcb->background){
+        cli();
+        remove_wait(curr_pcb);
+        mutex_release_all(curr_pcb);
+        run_queue_remove(curr_pcb);
+        release_children(curr_pcb);
+
+        //fd 0 and 1 too: they may be inherited pipe ends or files
+        int i; //for-loop index
+        for (i = 0; i < MAX_FILES; i++) {  
+            release_fd(curr_pcb, i);
+        }
+
+        curr_pcb->exit_status = status;
+        curr_pcb->state = PROC_ZOMBIE;
+        if(curr_pcb->parent_pid == (uint32_t)-1){
+            //nobody will wait for an orphan; it still runs on its kernel stack, so the next
+            //task on this cpu frees it once switch_to() has left that stack
+            this_cpu()->zombie = curr_pcb;
+        }
+        else{
+            wake_up(&get_pcb(curr_pcb->parent_pid)->child_wq);
+        }
+        reschedule();
+    }
+
     //restart if attempting to halt of root shell of any terminal
     if(curr_pcb->parent_pid == -1){
         cli();
+        //halted while sleeping or queued (e.g. ctrl+c during a read): it keeps the cpu
+        remove_wait(curr_pcb);
+        mutex_release_all(curr_pcb);
+        run_queue_remove(curr_pcb);
+        release_children(curr_pcb);
+        fpu_release(curr_pcb);
+        reset_signals(curr_pcb);
+        curr_pcb->state = PROC_RUNNING;
+        //the new shell starts with only stdin and stdout; a pipe end left open would keep
+        //the other side waiting forever
+        int i; //for-loop index
+        for (i = 2; i < MAX_FILES; i++) {
+            release_fd(curr_pcb, i);
+        }
         uint32_t prog_eip;
         prog_eip = curr_pcb->user_eip;
         uint32_t prog_esp;
         prog_esp = USER_MEM_START_VIR + PAGE_SIZE_4MB - 4;
 
+        //straight back to user mode, not through the syscall wrapper
+        kernel_lock_set_depth(0);
         sti();
         asm volatile(
                     "pushl %3           \n\t"   // push ds onto stack          
@@ -36,26 +190,32 @@ int32_t halt(uint8_t status) {
 
     else{
         cli();
-        //close current process
-        pid_status[curr_pid] = 0;
-        
-        // get parent pid
+        //halted while sleeping or queued (e.g. ctrl+c during a read): leave the queues first
+        remove_wait(curr_pcb);
+        mutex_release_all(curr_pcb);
+        run_queue_remove(curr_pcb);
+        release_children(curr_pcb);
+        curr_pcb->state = PROC_ZOMBIE;
+
+        // Set all file descriptor to be not used (before curr_pid moves to the parent).
+        int i; //for-loop index
+        for (i = 0; i < MAX_FILES; i++) {  
+            release_fd(curr_pcb, i);
+        }
+
+        // get parent pid; the parent was blocked in execute() and takes the cpu back
         uint32_t parent_pid = curr_pcb->parent_pid;
+        pcb_t* parent_pcb = get_pcb(parent_pid);
         schedule[active_term_idx] = parent_pid; //update schedule pid
+        curr_pid = parent_pid;
+        parent_pcb->state = PROC_RUNNING;
+        smp_move_process(parent_pcb, this_cpu()->id);
 
         // Restore paging for the parent process.
         setup_process_memory(parent_pid);
-
-        // Set all file descriptor to be not used.
-        int i; //for-loop index
-        for (i = 0; i < MAX_FILES; i++) {  
-            if(curr_pcb->fd_array[i].flags == 1){
-                close(i);
-            }   
-        }
         // Set esp0 to be the start of the kernel memory for the process.
-        tss.esp0 = KERNEL_MEM_START - (parent_pid*PROCESS_STACK_SIZE) - 4; 
-        tss.ss0 = KERNEL_DS;
+        this_cpu()->tss.esp0 = KERNEL_STACK_TOP(parent_pcb); 
+        this_cpu()->tss.ss0 = KERNEL_DS;
 
         //get kernel_ebp to return back to execute program
         uint32_t ebp;
@@ -63,7 +223,12 @@ int32_t halt(uint8_t status) {
         uint32_t esp;
         esp = curr_pcb->exe_esp;
 
-        sti();
+        //close current process; interrupts stay off until we are back on the parent's stack
+        //so the freed kernel stack cannot be handed out while we still run on it
+        //(the parent's iret back to user mode turns them on again)
+        free_process(curr_pcb);
+        //the parent's syscall wrapper releases the kernel lock it took for execute()
+        kernel_lock_set_depth(1);
         //asm volatile ("movl %0, %%eax\n" : :"r"((int)status));
         // Return back to the execute program of the child process. We saved the ebp for the execute() program. 
         // So using the leave & ret command, we can return from the execute() and back to the parent process (next instruction after system call).
@@ -73,7 +238,7 @@ int32_t halt(uint8_t status) {
                         "leave                      \n\t"   // %esp = %ebp, popl %ebp
                         "ret                        \n\t"   // movl (%esp) %eip, %esp = %esp + 4
                         :
-                        : "r"(ebp),"r"(esp), "r" ((uint32_t)status)
+                        : "r"(ebp),"r"(esp), "r" (status)
                         : "eax", "ebp", "esp"
                         );
         
@@ -85,30 +250,70 @@ int32_t halt(uint8_t status) {
 /* 
  * set_process_memory
  *   DESCRIPTION: helper function to map user program phys addr to user program virtual (128MB)
+ *                in the process's page directory and switch to that page directory
  *   INPUTS: pid of the program to be mapped
  *   OUTPUTS: none
  */
 
 void setup_process_memory(uint32_t pid) {
-    // Set up page directory to map virtual address 0x08048000 to physical address 8MB (0x800000) + pid * 4MB (0x400000)
-    uint32_t paddr = USER_MEM_START_PHY + (pid * PAGE_SIZE_4MB);
+    pcb_t* pcb = get_pcb(pid);
+    // Set up the process's page directory to map virtual address 0x08048000 to physical address 8MB (0x800000) + frame * 4MB (0x400000)
+    uint32_t paddr = USER_MEM_START_PHY + (pcb->user_frame * PAGE_SIZE_4MB);
     page_dir_entry_mb prog_dir_entry; 
     setup_page_dir_entry_mb(&prog_dir_entry,1, 1, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, paddr>>MB_PAGE_NUM_OFFSET);
-    page_directory[USER_MEMORY_VIR >> MB_PAGE_NUM_OFFSET] = *(int*)&prog_dir_entry;
-    //flush_tlb: processor will flush the tlb once it notices that cr3 has been changed
-    asm volatile ("movl %cr3, %eax  \n\t"
-                  "movl %eax, %cr3  \n\t"      
-                );
+    pcb->page_dir[USER_MEMORY_VIR >> MB_PAGE_NUM_OFFSET] = *(int*)&prog_dir_entry;
+    //loading cr3 also flushes the tlb
+    load_page_directory(pcb->page_dir);
 }
 
 /* 
- * execute
- *   DESCRIPTION: load and execute a new program
- *   INPUTS: command
- *   OUTPUTS: 0 on success, -1 on failure
+ * init_pcb_state
+ *   DESCRIPTION: set the scheduling, wait queue and rtc fields of a new process or thread
+ *   INPUTS: pcb - the new pcb
+ *   OUTPUTS: none
  */
-int32_t execute(const uint8_t* command) {
-    cli();
+static void init_pcb_state(pcb_t* pcb) {
+    pcb->exit_status = 0;
+    init_wait_queue(&pcb->child_wq);
+    init_wait_queue(&pcb->thread_wq);
+    pcb->group_exiting = 0;
+    pcb->kill_pending = 0;
+
+    pcb->state = PROC_RUNNING;
+    pcb->run_next = NULL;
+    pcb->nice = 0;
+    pcb->level = 0;             //new processes start with the highest priority
+    pcb->ticks_used = 0;
+    pcb->waiting_on = NULL;
+    pcb->polling = NULL;
+    pcb->held_mutexes = NULL;
+    pcb->fpu_used = 0;          //gets a clean fpu state on its first fpu instruction
+    memset(pcb->sys_calls, 0, sizeof(pcb->sys_calls));
+    memset(pcb->sys_cycles, 0, sizeof(pcb->sys_cycles));
+
+    //init rtc values for the process
+    pcb->max_rtc_count = 0;
+    pcb->rtc_interrupt = 0;
+    pcb->rtc_fd_idx = -1;       //set when rtc is opened for this process
+    init_wait_queue(&pcb->rtc_wq);
+
+    init_timer(&pcb->sleep_timer, NULL, NULL);
+    init_wait_queue(&pcb->sleep_wq);
+
+    init_timer(&pcb->alarm_timer, NULL, NULL);
+    reset_signals(pcb);
+}
+
+/* 
+ * load_program
+ *   DESCRIPTION: parse the command, allocate a pid, copy the program into its 4MB user page and
+ *                fill in its pcb. The new program's user page is left mapped at 128MB.
+ *   INPUTS: command - program name followed by its args
+ *           parent_pid - pid of the parent process, -1 for a terminal's first shell
+ *           background - 1 if the parent keeps running (spawn), 0 if it waits in execute()
+ *   OUTPUTS: pid of the new process, -1 on failure
+ */
+static int32_t load_program(const uint8_t* command, uint32_t parent_pid, uint32_t background) {
     //parse cmd
     uint32_t i;
     uint32_t exe_end;
@@ -119,6 +324,7 @@ int32_t execute(const uint8_t* command) {
 
     uint8_t filename[MAX_FILENAME_LEN];
     uint8_t args_temp[ARGS_BUF_SIZE];
+    dentry_t file_dentry;   //local: another process may load a program while we sleep
     //clear filename & arg to '\0'
     for(i = 0; i < MAX_FILENAME_LEN; i++){
         filename[i] = '\0';
@@ -161,51 +367,36 @@ int32_t execute(const uint8_t* command) {
         return -1;
     }
 
-    //paging (mapping v mem to p mem based on pid)/////////////////////////////////////////
-    uint32_t new_pid = MAX_PID;
-
-    //check which pid is available
-    for(i =0; i < MAX_PID; i++){
-        if(pid_status[i] == 0){
-            new_pid = i;
-            pid_status[i] = 1;
-            break;
-        }
-    }
+    //create PCB//////////////////////////////////////////////////////////////////////////////
 
-    //if pid_num is not set -> no pid available
-    if(new_pid == MAX_PID){
+    //take a pid, a kernel stack (holding the pcb) and a user frame from the process table
+    pcb_t* pcb = alloc_process();
+    if(pcb == NULL){
         return -1;
     }
+    uint32_t new_pid = pcb->pid;
+
+    //paging (mapping v mem to p mem based on the user frame)////////////////////////////////
     setup_process_memory(new_pid);
 
-    // Copy the user code to the corresponding physical memory address (8MB (0x800000) + pid * 4MB (0x400000) + 0x48000)
+    // Copy the user code to the corresponding physical memory address (8MB (0x800000) + frame * 4MB (0x400000) + 0x48000)
     inode_t* file_inode = info.inode_start + file_dentry.inode_num;
     read_data(file_dentry.inode_num,0,(uint8_t *)PROGRAM_START,file_inode->length);
 
-    //create PCB//////////////////////////////////////////////////////////////////////////////
-
-    //determine pcb_t location based on pid
-    pcb_t* pcb = (pcb_t*) (KERNEL_MEM_START - (new_pid + 1)*PROCESS_STACK_SIZE);
-
-    //update the current active pid
-    pcb->parent_pid = schedule[active_term_idx];
-    schedule[active_term_idx] = new_pid;
-    pcb->pid = new_pid;
-
-    //store the kernel stack esp & ebp into pcb
-    uint32_t ebp;
-    asm volatile ("movl %%ebp, %0\n" :"=r"(ebp));
-    pcb->kernel_ebp = ebp;
-    pcb->exe_ebp = ebp;
-    uint32_t esp;
-    asm volatile ("movl %%esp, %0\n" :"=r"(esp));
-    pcb->kernel_esp = esp;
-    pcb->exe_esp = esp;
+    pcb->parent_pid = parent_pid;
+    pcb->term_idx = active_term_idx;
+    pcb->background = background;
+    kdata_publish(pcb);
+    init_pcb_state(pcb);
+    if(parent_pid != (uint32_t)-1){
+        pcb->nice = get_pcb(parent_pid)->nice;
+        pcb->level = sched_top_level(pcb);
+    }
     
     setup_file_op_table();
 
     //set up file descriptor for each file
+    mutex_init(&pcb->fd_lock, (int8_t*)"fd table");
     for(i = 0; i < MAX_FILES; i++){
         pcb->fd_array[i].file_op_table_ptr = NULL;
         pcb->fd_array[i].inode = NULL;
@@ -213,11 +404,6 @@ int32_t execute(const uint8_t* command) {
         pcb->fd_array[i].flags = 0; //not in use
     }
 
-    //init rtc values for the process
-    pcb->max_rtc_count = 0;
-    pcb->rtc_interrupt = 0;
-    pcb->rtc_fd_idx = -1;       //set when rtc is opened for this process
-
     //when process is started, automatically open stdin and stdout (fd 0, 1 respectively)
     //storing appropriate file op table and marking as in-use
     pcb->fd_array[0].file_op_table_ptr = &stdin_op;
@@ -230,24 +416,118 @@ int32_t execute(const uint8_t* command) {
     for(i = 0; i < ARGS_BUF_SIZE; i++){
         pcb->args[i] = args_temp[i];  
     }
+
+    // Get the program entry (virtual address of the first line instruction) from the start (24-27 bytes) of the file and store as eip.
+    uint8_t eip_buf[4];
+    read_data(file_dentry.inode_num,EIP_START_BYTE,eip_buf,4); //eip is stored at byte 24 to 27
+    pcb->user_eip = *((int*) eip_buf); //save prog eip in pcb
+
+    return new_pid;
+}
+
+/* 
+ * build_first_frame
+ *   DESCRIPTION: lay out a new process's kernel stack the way switch_to() leaves a switched
+ *                out process: callee-saved registers and a return address, here spawn_return,
+ *                which irets to pcb->user_eip with interrupts enabled
+ *   INPUTS: pcb - the new process
+ *           user_esp - its user stack pointer
+ *   OUTPUTS: none
+ */
+static void build_first_frame(pcb_t* pcb, uint32_t user_esp) {
+    uint32_t* stack = (uint32_t*)KERNEL_STACK_TOP(pcb);
+
+    //iret frame for the first entry to user mode
+    *(--stack) = USER_DS;
+    *(--stack) = user_esp;
+    *(--stack) = EFLAGS_IF;
+    *(--stack) = USER_CS;
+    *(--stack) = pcb->user_eip;
+    //switch_to() pops ebp, ebx, esi, edi and returns
+    *(--stack) = (uint32_t)spawn_return;
+    *(--stack) = 0;
+    *(--stack) = 0;
+    *(--stack) = 0;
+    *(--stack) = 0;
+    pcb->kernel_esp = (uint32_t)stack;
+}
+
+/* 
+ * execute
+ *   DESCRIPTION: load and execute a new program; it inherits the caller's fds
+ *   INPUTS: command
+ *   OUTPUTS: 0 on success, -1 on failure
+ */
+int32_t execute(const uint8_t* command) {
+    uint32_t flags;
+    uint32_t parent_pid;
+    int32_t new_pid;
+
+    pcb_t* group = get_pcb(curr_pid)->group;
+
+    //the parent waits inside execute() with its kernel stack; only a main thread may do that
+    if(group != get_pcb(curr_pid)){
+        return -1;
+    }
+
+    //held until the child has its copies of our fds; taken before the child's page directory
+    //is loaded, since sleeping on it afterwards would switch back to ours
+    mutex_lock(&group->fd_lock);
+    cli_and_save(flags);
+
+    //the first shell of a terminal has no parent
+    if(schedule[active_term_idx] == (uint32_t)-1){
+        parent_pid = -1;
+    }
+    else{
+        parent_pid = curr_pid;
+    }
+
+    new_pid = load_program(command, parent_pid, 0);
+    if(new_pid == -1){
+        restore_flags(flags);
+        mutex_unlock(&group->fd_lock);
+        return -1;
+    }
+    pcb_t* pcb = get_pcb(new_pid);
+    if(parent_pid != (uint32_t)-1){
+        inherit_files(pcb, -1, -1);
+    }
+    mutex_unlock(&group->fd_lock);
+    //the child takes over the parent's cpu
+    smp_move_process(pcb, this_cpu()->id);
+
+    //update the current active pid
+    if(parent_pid != (uint32_t)-1){
+        //the parent waits inside execute() until the child halts, it is not on the run queue
+        get_pcb(curr_pid)->state = PROC_BLOCKED;
+    }
+    schedule[active_term_idx] = new_pid;
+    curr_pid = new_pid;
+
+    //store the kernel stack esp & ebp into pcb so halt() can return from this execute()
+    uint32_t ebp;
+    asm volatile ("movl %%ebp, %0\n" :"=r"(ebp));
+    pcb->exe_ebp = ebp;
+    uint32_t esp;
+    asm volatile ("movl %%esp, %0\n" :"=r"(esp));
+    pcb->exe_esp = esp;
     
     //prepare for context switch///////////////////////////////////////////////////////
 
     // Set esp0 to be the start of the kernel memory for the process.
-    tss.esp0 = KERNEL_MEM_START - ((pcb->pid)*PROCESS_STACK_SIZE) - 4; 
-    tss.ss0 = KERNEL_DS;
+    this_cpu()->tss.esp0 = KERNEL_STACK_TOP(pcb); 
+    this_cpu()->tss.ss0 = KERNEL_DS;
 
-    // Get the program entry (virtual address of the first line instruction) from the start (24-27 bytes) of the file and store as eip.
-    uint8_t eip_buf[4];
-    read_data(file_dentry.inode_num,EIP_START_BYTE,eip_buf,4); //eip is stored at byte 24 to 27
-    int prog_eip = *((int*) eip_buf);
-    pcb->user_eip = prog_eip; //save prog eip in pcb
+    int prog_eip = pcb->user_eip;
 
     // The stack memery for the user program should start at the bottom of the assigned 4MB page. 
     // The page has user code on the top (low address, at 0x08048000), and stack on the bottom, growing upward.
     // Minus 4 because the reading memory from low to high address. e.g. esp = a, then popl esp get memory content from a to a + 4.
     uint32_t prog_esp = USER_MEM_START_VIR + PAGE_SIZE_4MB - 4;
     
+    //straight to user mode, not through the syscall wrapper
+    kernel_lock_set_depth(0);
     sti();
     // IRET is equivalent to the "popl eip, popl cs, popfl, popl esp, popl ds"
     // We use IRET to transfer control to the user program. e.g. pass the address of the user program entry as eip. 
@@ -268,6 +548,264 @@ int32_t execute(const uint8_t* command) {
 
 }
 
+/* 
+ * spawn
+ *   DESCRIPTION: load a new program and put it on the run queue without waiting for it, so
+ *                one terminal can run several programs at once. The child inherits the
+ *                caller's fds and enters user mode the first time the scheduler switches to it.
+ *   INPUTS: command - program name followed by its args
+ *   OUTPUTS: pid of the new process, -1 on failure
+ */
+int32_t spawn(const uint8_t* command) {
+    return spawn_io(command, -1, -1);
+}
+
+/* 
+ * inherit_files
+ *   DESCRIPTION: give a new child copies of the caller's open fds under the same numbers, with
+ *                fd 0 and 1 optionally taken from other fds of the caller (spawn_io). Each file
+ *                is told through its dup op (a pipe counts its ends). A copy has its own file
+ *                position. The virtual rtc belongs to one process, so rtc fds stay behind; a
+ *                closed fd 0 or 1 leaves the child on the terminal. Call with the caller's
+ *                fd_lock held.
+ *   INPUTS: pcb - the new process, stdin and stdout on the terminal so far
+ *           in_fd - open fd of the caller for the child's fd 0, -1 for the caller's fd 0
+ *           out_fd - open fd of the caller for the child's fd 1, -1 for the caller's fd 1
+ *   OUTPUTS: none
+ */
+static void inherit_files(pcb_t* pcb, int32_t in_fd, int32_t out_fd) {
+    file_descriptor_t* parent_fds = get_pcb(curr_pid)->group->fd_array;
+    file_descriptor_t* file;
+    int32_t src;
+    int32_t i;
+
+    for(i = 0; i < MAX_FILES; i++){
+        src = i;
+        if(i == 0 && in_fd != -1){
+            src = in_fd;
+        }
+        if(i == 1 && out_fd != -1){
+            src = out_fd;
+        }
+        if(parent_fds[src].flags == FD_UNUSED || parent_fds[src].file_op_table_ptr == &rtc_op){
+            continue;
+        }
+        file = &pcb->fd_array[i];
+        *file = parent_fds[src];
+        if(file->file_op_table_ptr->dup != NULL){
+            file->file_op_table_ptr->dup(file);
+        }
+    }
+}
+
+/* 
+ * spawn_io
+ *   DESCRIPTION: spawn() with the child's stdin and stdout taken from fds of the caller, e.g.
+ *                the two ends of a pipe. The child inherits the caller's other fds as well. The
+ *                caller keeps its own copies and usually closes them.
+ *   INPUTS: command - program name followed by its args
+ *           in_fd - open fd of the caller for the child's fd 0, -1 for the caller's fd 0
+ *           out_fd - open fd of the caller for the child's fd 1, -1 for the caller's fd 1
+ *   OUTPUTS: pid of the new process, -1 on failure
+ */
+int32_t spawn_io(const uint8_t* command, int32_t in_fd, int32_t out_fd) {
+    pcb_t* group = get_pcb(curr_pid)->group;
+    uint32_t flags;
+    int32_t new_pid;
+    pcb_t* pcb;
+
+    if(in_fd < -1 || in_fd >= MAX_FILES || out_fd < -1 || out_fd >= MAX_FILES){
+        return -1;
+    }
+    //another thread must not close the fds while they are copied
+    mutex_lock(&group->fd_lock);
+    if((in_fd != -1 && group->fd_array[in_fd].flags == FD_UNUSED) ||
+       (out_fd != -1 && group->fd_array[out_fd].flags == FD_UNUSED)){
+        mutex_unlock(&group->fd_lock);
+        return -1;
+    }
+
+    cli_and_save(flags);
+    new_pid = load_program(command, curr_pid, 1);
+    if(new_pid == -1){
+        restore_flags(flags);
+        mutex_unlock(&group->fd_lock);
+        return -1;
+    }
+    pcb = get_pcb(new_pid);
+    inherit_files(pcb, in_fd, out_fd);
+
+    //the parent keeps running, give it its address space back
+    load_page_directory(get_pcb(curr_pid)->page_dir);
+
+    build_first_frame(pcb, USER_MEM_START_VIR + PAGE_SIZE_4MB - 4);
+    make_ready(pcb);
+
+    restore_flags(flags);
+    mutex_unlock(&group->fd_lock);
+    return new_pid;
+}
+
+/* 
+ * start_shell
+ *   DESCRIPTION: load the root shell of a terminal and queue it. Like spawn() it enters user
+ *                mode the first time the scheduler picks it.
+ *   INPUTS: term_idx - terminal the shell runs in
+ *   OUTPUTS: pid of the shell, -1 on failure
+ */
+int32_t start_shell(uint32_t term_idx) {
+    uint32_t flags;
+    int32_t new_pid;
+    pcb_t* pcb;
+
+    cli_and_save(flags);
+    new_pid = load_program((uint8_t*)"shell", -1, 0);
+    if(new_pid == -1){
+        restore_flags(flags);
+        return -1;
+    }
+    pcb = get_pcb(new_pid);
+    pcb->term_idx = term_idx;
+    kdata_publish(pcb);
+    schedule[term_idx] = new_pid;
+
+    //keep running in the address space of whoever we interrupted (usually the idle task)
+    load_page_directory(get_pcb(curr_pid)->page_dir);
+
+    build_first_frame(pcb, USER_MEM_START_VIR + PAGE_SIZE_4MB - 4);
+    make_ready(pcb);
+
+    restore_flags(flags);
+    return new_pid;
+}
+
+/* 
+ * wait
+ *   DESCRIPTION: sleep until a background child started with spawn() halts, then free it
+ *   INPUTS: pid - the child to wait for, -1 for any background child
+ *   OUTPUTS: the child's halt status, -1 if there is no such child or a signal came first
+ */
+int32_t wait(int32_t pid) {
+    pcb_t* curr_pcb = get_pcb(curr_pid);
+    pcb_t* child_pcb;
+    uint32_t flags;
+    uint32_t found;
+    int32_t status;
+
+    cli_and_save(flags);
+    while(1){
+        found = 0;
+        for_each_process(child_pcb){
+            if(child_pcb->background && child_pcb->parent_pid == curr_pid &&
+               (pid == -1 || (uint32_t)pid == child_pcb->pid)){
+                found = 1;
+                if(child_pcb->state == PROC_ZOMBIE){
+                    status = child_pcb->exit_status;
+                    free_process(child_pcb);
+                    restore_flags(flags);
+                    return status;
+                }
+            }
+        }
+        if(!found){
+            restore_flags(flags);
+            return -1;
+        }
+        if(signal_pending()){
+            restore_flags(flags);
+            return -1;
+        }
+        //halt() of a background child wakes its parent
+        sleep_on(&curr_pcb->child_wq);
+    }
+}
+
+/* 
+ * thread_create
+ *   DESCRIPTION: start a new thread of the current process. It shares the page directory,
+ *                user frame and fd table of the main thread and gets its own kernel stack;
+ *                the caller provides its user stack. Like a spawned process it enters user
+ *                mode when its cpu first picks it.
+ *   INPUTS: entry - user address the thread starts at
+ *           user_esp - top of the thread's user stack
+ *   OUTPUTS: id of the thread (a pid), -1 on failure
+ */
+int32_t thread_create(uint32_t entry, uint32_t user_esp) {
+    pcb_t* curr_pcb = get_pcb(curr_pid);
+    pcb_t* group = curr_pcb->group;
+    pcb_t* pcb;
+    uint32_t flags;
+
+    //both must lie in the user page
+    if(entry < USER_MEM_START_VIR || entry >= USER_MEM_START_VIR + PAGE_SIZE_4MB){
+        return -1;
+    }
+    if(user_esp <= USER_MEM_START_VIR || user_esp > USER_MEM_START_VIR + PAGE_SIZE_4MB || (user_esp & 0x3)){
+        return -1;
+    }
+
+    cli_and_save(flags);
+    if(group->group_exiting){
+        restore_flags(flags);
+        return -1;
+    }
+    pcb = alloc_thread(group);
+    if(pcb == NULL){
+        restore_flags(flags);
+        return -1;
+    }
+
+    //not a child: wait() skips it, thread_join() collects it
+    pcb->parent_pid = -1;
+    pcb->term_idx = curr_pcb->term_idx;
+    pcb->background = 1;
+    init_pcb_state(pcb);
+    pcb->nice = curr_pcb->nice;
+    pcb->level = sched_top_level(pcb);
+    pcb->user_eip = entry;
+
+    build_first_frame(pcb, user_esp);
+    make_ready(pcb);
+
+    restore_flags(flags);
+    return pcb->pid;
+}
+
+/* 
+ * thread_join
+ *   DESCRIPTION: sleep until a thread of the current process halts, then free it
+ *   INPUTS: tid - the thread, as returned by thread_create
+ *   OUTPUTS: the thread's halt status, -1 if tid is not another thread of this process
+ */
+int32_t thread_join(int32_t tid) {
+    pcb_t* curr_pcb = get_pcb(curr_pid);
+    pcb_t* group = curr_pcb->group;
+    pcb_t* thread;
+    uint32_t flags;
+    int32_t status;
+
+    if(tid < 0){
+        return -1;
+    }
+
+    cli_and_save(flags);
+    while(1){
+        thread = get_pcb(tid);
+        if(thread == NULL || thread == curr_pcb || thread == group || thread->group != group){
+            restore_flags(flags);
+            return -1;
+        }
+        if(thread->state == PROC_ZOMBIE){
+            status = thread->exit_status;
+            free_process(thread);
+            restore_flags(flags);
+            return status;
+        }
+        //halt() of a thread wakes every joiner of the process
+        sleep_on(&group->thread_wq);
+    }
+}
+
 /* 
  * open
  *   DESCRIPTION: Provides access to filesystem, find dentry based on filename, locate unused fd and set up data
@@ -276,11 +814,13 @@ int32_t execute(const uint8_t* command) {
  */
 int32_t open(const uint8_t* filename) {
     int i; // for-loop index
+    dentry_t file_dentry;
     if (filename == NULL || read_dentry_by_name(filename, &file_dentry) == -1) {
         return -1;
     }
-    pcb_t* curr_pcb = get_pcb(schedule[active_term_idx]);
-    file_descriptor_t* fd_array = curr_pcb->fd_array;
+    pcb_t* group = get_pcb(curr_pid)->group;
+    file_descriptor_t* fd_array = group->fd_array;
+    mutex_lock(&group->fd_lock);
     // Find the next unused file descriptor.
     for (i = 0; i < MAX_FILES; i++) {
         if (fd_array[i].flags == FD_UNUSED) {
@@ -296,17 +836,38 @@ int32_t open(const uint8_t* filename) {
                 fd_array[i].file_op_table_ptr = &file_op;
             }
             fd_array[i].file_op_table_ptr->open(filename);
+            mutex_unlock(&group->fd_lock);
             return i;
         }
     }
+    mutex_unlock(&group->fd_lock);
     return -1; //no fd available
 }
 
+/* 
+ * would_block
+ *   DESCRIPTION: for an fd with FD_NONBLOCK set, ask the poll op of its file whether the read
+ *                or write would have to sleep. Files without a poll op never sleep, and
+ *                blocking fds are not asked.
+ *   INPUTS: file - an open fd
+ *           fd - its number
+ *           event - POLLIN for a read, POLLOUT for a write
+ *   OUTPUTS: 1 if the call must return ERR_WOULD_BLOCK, 0 if it may go ahead
+ */
+static int32_t would_block(file_descriptor_t* file, int32_t fd, uint32_t event) {
+    if (!(file->flags & FD_NONBLOCK) || file->file_op_table_ptr->poll == NULL) {
+        return 0;
+    }
+    return !(file->file_op_table_ptr->poll(fd, NULL) & event);
+}
+
 /* 
  * read
- *   DESCRIPTION: checks for valid inputs and calls the read function based on the file type
+ *   DESCRIPTION: checks for valid inputs and calls the read function based on the file type.
+ *                On an FD_NONBLOCK fd a read that would sleep (no line entered, no rtc tick,
+ *                empty pipe) returns ERR_WOULD_BLOCK instead.
  *   INPUTS: fd, buf, nbytes
- *   OUTPUTS: 0 on success, -1 on failure
+ *   OUTPUTS: 0 on success, -1 on failure, ERR_WOULD_BLOCK if not ready
  */
 
 int32_t read(int32_t fd, void* buf, int32_t nbytes) {
@@ -318,21 +879,26 @@ int32_t read(int32_t fd, void* buf, int32_t nbytes) {
     if (buf == NULL || nbytes < 0) {
         return -1;
     }
-    pcb_t* curr_pcb = get_pcb(schedule[active_term_idx]);
-    file_descriptor_t* fd_array = curr_pcb->fd_array;
+    pcb_t* curr_pcb = get_pcb(curr_pid);
+    file_descriptor_t* fd_array = curr_pcb->group->fd_array;
     // Can not read from unused file descriptor
     if (fd_array[fd].flags == FD_UNUSED) {
         return -1;
     }
+    if (would_block(&fd_array[fd], fd, POLLIN)) {
+        return ERR_WOULD_BLOCK;
+    }
     return fd_array[fd].file_op_table_ptr->read(fd, buf, nbytes);
     
 }
 
 /* 
  * write
- *   DESCRIPTION: checks for valid inputs and calls the write function based on the file type
+ *   DESCRIPTION: checks for valid inputs and calls the write function based on the file type.
+ *                On an FD_NONBLOCK fd a write that could not copy a single byte without
+ *                sleeping (full pipe) returns ERR_WOULD_BLOCK instead.
  *   INPUTS: fd, buf, nbytes
- *   OUTPUTS: 0 on success, -1 on failure
+ *   OUTPUTS: 0 on success, -1 on failure, ERR_WOULD_BLOCK if not ready
  */
 int32_t write(int32_t fd, const void* buf, int32_t nbytes) {
     // Check for invalid file descriptor.
@@ -343,12 +909,15 @@ int32_t write(int32_t fd, const void* buf, int32_t nbytes) {
     if (buf == NULL || nbytes < 0) {
         return -1;
     }
-    pcb_t* curr_pcb = get_pcb(schedule[active_term_idx]);
-    file_descriptor_t* fd_array = curr_pcb->fd_array;
+    pcb_t* curr_pcb = get_pcb(curr_pid);
+    file_descriptor_t* fd_array = curr_pcb->group->fd_array;
     // Can not write to unopened file descriptor
     if (fd_array[fd].flags == FD_UNUSED) {
         return -1;
     }
+    if (would_block(&fd_array[fd], fd, POLLOUT)) {
+        return ERR_WOULD_BLOCK;
+    }
     return fd_array[fd].file_op_table_ptr->write(fd, buf, nbytes);
 }
 
@@ -360,20 +929,165 @@ int32_t write(int32_t fd, const void* buf, int32_t nbytes) {
  */
 
 int32_t close(int32_t fd) {
-    // Check for invalid file descriptor.
-    if (fd < 2 || fd >= MAX_FILES) {
+    // Check for invalid file descriptor. fd 0 and 1 may be closed too, e.g. to redirect them.
+    if (fd < 0 || fd >= MAX_FILES) {
         return -1;
     }
-    pcb_t* curr_pcb = get_pcb(schedule[active_term_idx]);
-    file_descriptor_t* fd_array = curr_pcb->fd_array;
+    return release_fd(get_pcb(curr_pid)->group, fd);
+}
+
+/* 
+ * release_fd
+ *   DESCRIPTION: close any fd of the current process (close() and halt())
+ *   INPUTS: group - main thread of the current process
+ *           fd - the fd
+ *   OUTPUTS: result of the close op, -1 if fd was not open
+ */
+static int32_t release_fd(pcb_t* group, int32_t fd) {
+    int32_t ret;
+    mutex_lock(&group->fd_lock);
+    ret = release_fd_locked(group, fd);
+    mutex_unlock(&group->fd_lock);
+    return ret;
+}
+
+/* 
+ * release_fd_locked
+ *   DESCRIPTION: release_fd() with group->fd_lock already held. The file's close op runs while
+ *                the fd still names the file, so a pipe knows which end went away.
+ *   INPUTS: group - main thread of the current process
+ *           fd - the fd
+ *   OUTPUTS: result of the close op, -1 if fd was not open
+ */
+static int32_t release_fd_locked(pcb_t* group, int32_t fd) {
+    file_descriptor_t* fd_array = group->fd_array;
+    int32_t ret;
     // Can not write to unopened file descriptor
     if (fd_array[fd].flags == FD_UNUSED) {
         return -1;
     }
+    ret = fd_array[fd].file_op_table_ptr->close(fd);
     fd_array[fd].inode = NULL;
     fd_array[fd].file_pos = 0;
     fd_array[fd].flags = FD_UNUSED;
-    return fd_array[fd].file_op_table_ptr->close(fd);
+    return ret;
+}
+
+/* 
+ * dup_fd_locked
+ *   DESCRIPTION: make fd new_fd a copy of the open fd fd and tell the file. Call with
+ *                group->fd_lock held and new_fd unused.
+ *   INPUTS: group - main thread of the current process
+ *           fd - open fd to copy
+ *           new_fd - unused fd to fill
+ *   OUTPUTS: new_fd
+ */
+static int32_t dup_fd_locked(pcb_t* group, int32_t fd, int32_t new_fd) {
+    file_descriptor_t* file = &group->fd_array[new_fd];
+
+    *file = group->fd_array[fd];
+    if (file->file_op_table_ptr->dup != NULL) {
+        file->file_op_table_ptr->dup(file);
+    }
+    return new_fd;
+}
+
+/* 
+ * dup
+ *   DESCRIPTION: open the lowest unused fd on the same file as fd
+ *   INPUTS: fd - an open fd
+ *   OUTPUTS: the new fd, -1 if fd is not open or no fd is free
+ */
+int32_t dup(int32_t fd) {
+    pcb_t* group = get_pcb(curr_pid)->group;
+    int32_t new_fd;
+
+    if (fd < 0 || fd >= MAX_FILES) {
+        return -1;
+    }
+    mutex_lock(&group->fd_lock);
+    if (group->fd_array[fd].flags == FD_UNUSED) {
+        mutex_unlock(&group->fd_lock);
+        return -1;
+    }
+    for (new_fd = 0; new_fd < MAX_FILES; new_fd++) {
+        if (group->fd_array[new_fd].flags == FD_UNUSED) {
+            dup_fd_locked(group, fd, new_fd);
+            mutex_unlock(&group->fd_lock);
+            return new_fd;
+        }
+    }
+    mutex_unlock(&group->fd_lock);
+    return -1;
+}
+
+/* 
+ * dup2
+ *   DESCRIPTION: make new_fd refer to the same file as fd, closing what new_fd had open first.
+ *                The shell redirects a program's stdin or stdout this way.
+ *   INPUTS: fd - an open fd
+ *           new_fd - fd to replace
+ *   OUTPUTS: new_fd, -1 if fd is not open or new_fd is out of range
+ */
+int32_t dup2(int32_t fd, int32_t new_fd) {
+    pcb_t* group = get_pcb(curr_pid)->group;
+
+    if (fd < 0 || fd >= MAX_FILES || new_fd < 0 || new_fd >= MAX_FILES) {
+        return -1;
+    }
+    mutex_lock(&group->fd_lock);
+    if (group->fd_array[fd].flags == FD_UNUSED) {
+        mutex_unlock(&group->fd_lock);
+        return -1;
+    }
+    if (fd != new_fd) {
+        release_fd_locked(group, new_fd);
+        dup_fd_locked(group, fd, new_fd);
+    }
+    mutex_unlock(&group->fd_lock);
+    return new_fd;
+}
+
+/* 
+ * fcntl
+ *   DESCRIPTION: read or change the flags of an open fd. Only FD_NONBLOCK can be changed:
+ *                with it set, reads and writes return ERR_WOULD_BLOCK instead of sleeping,
+ *                so a program can keep drawing while it checks for input. The flag belongs
+ *                to the fd; a copy made by dup() or inherited by a child starts with it too.
+ *   INPUTS: fd - an open fd
+ *           cmd - F_GETFL or F_SETFL
+ *           arg - F_SETFL: FD_NONBLOCK to set the flag, 0 to clear it
+ *   OUTPUTS: F_GETFL: the fd's FD_NONBLOCK bit; F_SETFL: 0; -1 for a bad fd or cmd
+ */
+int32_t fcntl(int32_t fd, int32_t cmd, int32_t arg) {
+    pcb_t* group = get_pcb(curr_pid)->group;
+    file_descriptor_t* file;
+    int32_t ret;
+
+    if (fd < 0 || fd >= MAX_FILES) {
+        return -1;
+    }
+    //another thread may close or dup over the fd between the check and the update
+    mutex_lock(&group->fd_lock);
+    file = &group->fd_array[fd];
+    if (file->flags == FD_UNUSED) {
+        mutex_unlock(&group->fd_lock);
+        return -1;
+    }
+    switch (cmd) {
+        case F_GETFL:
+            ret = file->flags & FD_NONBLOCK;
+            break;
+        case F_SETFL:
+            file->flags = (file->flags & ~FD_NONBLOCK) | (arg & FD_NONBLOCK);
+            ret = 0;
+            break;
+        default:
+            ret = -1;
+            break;
+    }
+    mutex_unlock(&group->fd_lock);
+    return ret;
 }
 
 /* 
@@ -383,10 +1097,10 @@ int32_t close(int32_t fd) {
  *   OUTPUTS: 0 on success, -1 on failure
  */
 int32_t getargs(uint8_t* buf, int32_t nbytes) {
-    pcb_t* curr_pcb = get_pcb(schedule[active_term_idx]);
+    pcb_t* curr_pcb = get_pcb(curr_pid);
     
     //no args
-    if(curr_pcb->args[0] == '\0'){    //TODO should it be able to accept arg that begins with space?
+    if(curr_pcb->group->args[0] == '\0'){    //TODO should it be able to accept arg that begins with space?
         return -1;
     }
 
@@ -401,7 +1115,7 @@ int32_t getargs(uint8_t* buf, int32_t nbytes) {
     }
 
     //copy args to buf
-    memcpy(buf,&(curr_pcb->args), ARGS_BUF_SIZE);
+    memcpy(buf,&(curr_pcb->group->args), ARGS_BUF_SIZE);
     return 0;
 }
 
@@ -421,7 +1135,7 @@ int32_t vidmap(uint8_t** screen_start) {
     }
     page_dir_entry_kb vid_map_pde;
     setup_page_dir_entry_kb(&vid_map_pde, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, (int)vid_map_page_table>>PAGE_TABLE_NUM_OFFSET);
-    page_directory[VID_MAP_VIR >> MB_PAGE_NUM_OFFSET] = *(int*)&vid_map_pde;
+    get_pcb(curr_pid)->page_dir[VID_MAP_VIR >> MB_PAGE_NUM_OFFSET] = *(int*)&vid_map_pde;
     
     //check if current active process is being displayed
     uint32_t vid_mem_addr;
@@ -453,12 +1167,24 @@ int32_t vidmap(uint8_t** screen_start) {
     return 0;
 }
 
-int32_t set_handler(int32_t signum, void* handler_address) {
-    return 0;
-}
+/* 
+ * isatty
+ *   DESCRIPTION: tell whether fd is open on the terminal, so a program like grep can read a
+ *                pipe on its stdin instead of waiting for keyboard input
+ *   INPUTS: fd
+ *   OUTPUTS: 1 for the terminal, 0 for another file, -1 if fd is not open
+ */
+int32_t isatty(int32_t fd) {
+    file_op_table_t* ops;
 
-int32_t sigreturn() {
-    return 0;
+    if (fd < 0 || fd >= MAX_FILES) {
+        return -1;
+    }
+    if (get_pcb(curr_pid)->group->fd_array[fd].flags == FD_UNUSED) {
+        return -1;
+    }
+    ops = get_pcb(curr_pid)->group->fd_array[fd].file_op_table_ptr;
+    return ops == &stdin_op || ops == &stdout_op || ops == &terminal_op;
 }
 
 //stdin is a read only file
@@ -474,8 +1200,11 @@ int32_t stdout_read(int32_t fd, void* buf, int32_t nbytes){
 
 
 int32_t file_executable(const uint8_t* filename) {
-    //read_dentry_by_name(filename, &file_dentry);
+    dentry_t file_dentry;
     uint8_t buf[4];
+    if (read_dentry_by_name(filename, &file_dentry) == -1) {
+        return -1;
+    }
     uint32_t result = read_data(file_dentry.inode_num, 0, buf, 4);
     if (result == -1) {
         return -1;
@@ -502,6 +1231,7 @@ void setup_file_op_table(){
     stdin_op.read = terminal_read;
     stdin_op.write = stdin_write;
     stdin_op.close = terminal_close;
+    stdin_op.poll = terminal_poll;
 
     stdout_op.open = terminal_open;
     stdout_op.read = stdout_read;
@@ -522,48 +1252,28 @@ void setup_file_op_table(){
     rtc_op.read = rtc_read;
     rtc_op.write = rtc_write;
     rtc_op.close = rtc_close;
+    rtc_op.poll = rtc_poll;
 
     terminal_op.open = terminal_open;
     terminal_op.read = terminal_read;
     terminal_op.write = terminal_write;
     terminal_op.close = terminal_close;
+    terminal_op.poll = terminal_poll;
 }
 
-pcb_t* get_pcb(uint32_t pid){
-    pcb_t* pcb;
-    pcb = (pcb_t*) (KERNEL_MEM_START - (pid + 1)*PROCESS_STACK_SIZE);
-    return pcb;
-}
-
-void process_switch(uint32_t from_pid, uint32_t to_pid){
-    pcb_t* from_pcb = get_pcb(from_pid);
-    pcb_t* to_pcb = get_pcb(to_pid);
-
-    //save esp and ebp of current terminal kernel stack
-    uint32_t ebp;
-    asm volatile ("movl %%ebp, %0\n" :"=r"(ebp));
-    from_pcb->kernel_ebp = ebp;
-    uint32_t esp;
-    asm volatile ("movl %%esp, %0\n" :"=r"(esp));
-    from_pcb->kernel_esp = esp;
-
-
-    // Set esp0 to be the start of the kernel memory for target terminal process.
-    tss.esp0 = KERNEL_MEM_START - ((to_pcb->pid)*PROCESS_STACK_SIZE) - 4; 
-    tss.ss0 = KERNEL_DS;
-
-    //maps user program to current pid in the target terminal
-    setup_process_memory(to_pcb->pid);
-    
-    //restore ebp and esp of target terminal process
-    asm volatile(   "movl %0, %%ebp         \n\t"   // restore ebp for the next process
-                    "movl %1, %%esp         \n\t"
-                    "leave                  \n\t"
-                    "ret                    \n\t"
-                    :
-                    : "r"(to_pcb->kernel_ebp), "r"(to_pcb->kernel_esp)
-                    : "memory"
-                    );
-
-        
+/* 
+ * process_switch
+ *   DESCRIPTION: save the current kernel context and resume to_pcb's: this cpu's tss.esp0,
+ *                its kernel stack and page directory (see switch_to in switch_asm.S).
+ *                Returns when from_pcb is switched back to. Takes the pcbs, not pids: a
+ *                halting process giving up the cpu for good may be a zombie, and its pid
+ *                must not be looked up again. Call with interrupts disabled.
+ *   INPUTS: from_pcb - the process giving up the cpu
+ *           to_pcb - the process to run
+ *   OUTPUTS: none
+ */
+void process_switch(pcb_t* from_pcb, pcb_t* to_pcb){
+    fpu_switch(to_pcb);
+    this_cpu()->tss.esp0 = KERNEL_STACK_TOP(to_pcb);
+    switch_to(&from_pcb->kernel_esp, to_pcb->kernel_esp, (uint32_t)to_pcb->page_dir);
 }
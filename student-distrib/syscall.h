@@ -9,30 +9,53 @@
 #include "rtc.h"
 #include "x86_desc.h"
 #include "multiboot.h"
+#include "wait_queue.h"
+#include "process.h"
+#include "fpu.h"
+#include "smp.h"
+#include "sync.h"
+#include "timer.h"
 
-#define MAX_PID                  6           // Maximum number of allowed process. 
+#define MAX_PID                  1024        // Size of the pid table (pids 0 to MAX_PID - 1).
+#define IDLE_PID                 0           // pid of the idle task, it keeps the boot stack just below 8MB
 #define PAGE_SIZE_4MB            0x400000    // 4mb
 #define USER_MEM_START_PHY       0x800000    // 8MB
 #define KERNEL_MEM_START         0x800000    // 8MB
 #define PROCESS_STACK_SIZE       0x2000      // 8kb
+#define KERNEL_STACK_TOP(pcb)    ((uint32_t)(pcb) + PROCESS_STACK_SIZE - 4)  // esp0 of a process, its pcb sits at the bottom of the stack
 #define MAX_FILES                8           // Maximum number of files allowed to open simultaneously.
+#define SYSSTAT_CALLS            32          // system call numbers that get counters (sysstat.c)
+#define NUM_SIGNALS              5           // signals a process can get (signal.h)
 #define USER_MEM_START_VIR       0x8000000  // The starting virtual address of the block for the user program memory (first 10 bits for 0x08048000)
 #define PROGRAM_START            0x08048000 // The start of the program code in virtual memory
 #define EIP_START_BYTE           24         // Index of the bytes storing the user program start
 #define FD_UNUSED                0          // File type number for unused file descriptors
 #define FD_USED                  1          // File type number for file descriptors in use
+#define FD_NONBLOCK              0x2        // Flag bit of a used fd: read/write that would sleep returns ERR_WOULD_BLOCK
+#define ERR_WOULD_BLOCK          -2         // Return value of a read/write on an FD_NONBLOCK fd that is not ready
+#define F_GETFL                  3          // fcntl command: return the fd's FD_NONBLOCK bit
+#define F_SETFL                  4          // fcntl command: set the fd's FD_NONBLOCK bit from arg
 #define ARGS_BUF_SIZE            1024       // large enough number to store args
 #define NUM_TERMS           3           //support max of 3 terminals
+#define PROC_RUNNING             0          // Process is the one currently on the cpu
+#define PROC_READY               1          // Process is waiting in the run queue
+#define PROC_BLOCKED             2          // Process is sleeping on a wait queue (or waiting for its child)
+#define PROC_ZOMBIE              3          // Process has halted and is being torn down (or waits to be reaped)
+#define EFLAGS_IF                0x202      // eflags with interrupts enabled (bit 1 is always set)
 
-//array that keep track of availablity of pids (0 -available, 1 - unavailable)
-uint32_t pid_status[MAX_PID]; //supports max of two processes
+struct file_descriptor;
 
 //struct of function ptrs to open,read,write,close ops.
+//dup (may be NULL) is told when an fd is copied, by dup()/dup2() or into a child.
+//poll (may be NULL: never blocks) returns the POLLIN/POLLOUT events that would not block now,
+//after poll_wait() on every queue woken when that changes
 typedef struct file_op_table{
    int32_t (*open) (const uint8_t* filename);
    int32_t (*read) (int32_t fd, void* buf, int32_t nbytes);
    int32_t (*write) (int32_t fd, const void* buf, int32_t nbytes);
    int32_t (*close) (int32_t fd);
+   void (*dup) (struct file_descriptor* file);
+   uint32_t (*poll) (int32_t fd, poll_table_t* pt);
 } file_op_table_t;
 
 typedef struct file_descriptor{
@@ -47,21 +70,59 @@ typedef struct pcb{
     uint32_t pid;
     uint32_t parent_pid;
     uint32_t user_eip;          //used to restart shell for base shells
-    uint32_t kernel_ebp; 
     uint32_t exe_ebp;
-    uint32_t kernel_esp;
+    uint32_t kernel_esp;        //saved by switch_to() while the process is switched out
     uint32_t exe_esp;
+    uint32_t state;             //PROC_RUNNING, PROC_READY, PROC_BLOCKED or PROC_ZOMBIE
+    uint32_t term_idx;          //terminal the process reads from and writes to
+    struct pcb* run_next;       //next process in the run queue while PROC_READY
+    uint32_t level;             //MLFQ priority level, 0 is the highest
+    uint32_t ticks_used;        //PIT ticks used of the quantum at the current level
+    int32_t nice;               //NICE_MIN..NICE_MAX: longer slices below 0, lower top level above
+    wait_entry_t* waiting_on;   //wait queue entry while blocked, NULL otherwise
+    poll_table_t* polling;      //entries on every polled queue while in poll(), NULL otherwise
+    struct mutex* held_mutexes; //mutexes the process holds, released if it halts holding them
+    uint32_t background;        //1 if started with spawn(): halts to a zombie instead of returning to execute()
+    int32_t exit_status;        //halt status kept for wait() while a background process is a zombie
+    wait_queue_t child_wq;      //wait() sleeps here until a background child halts
+    struct pcb* group;          //main thread of the process (itself unless made by thread_create)
+    wait_queue_t thread_wq;     //main thread: thread_join and halt() sleep here until a thread halts
+    uint32_t group_exiting;     //main thread: halting, thread_create fails
+    uint32_t kill_pending;      //thread: the main thread is halting, halt at the next reschedule ipi
+    uint32_t user_frame;        //4MB frame holding the user program, at 8MB + user_frame*4MB
+    struct pcb* all_next;       //next process in process_list
+    int* page_dir;              //page directory loaded into cr3 while the process runs
+    uint32_t cpu;               //cpu whose run queue the process is on; it only runs there
+    uint32_t migrations;        //times an idle cpu stole the process
+    uint32_t migrate_tick;      //pit_ticks at the last steal (cool-down)
+    uint32_t fpu_used;          //1 once the process executed an fpu/sse instruction
+    uint32_t sys_index;         //jmp_table index of the system call in progress (sysstat)
+    uint64_t sys_start;         //tsc when it was dispatched
+    uint32_t sys_calls[SYSSTAT_CALLS];  //system calls made, by jmp_table index
+    uint64_t sys_cycles[SYSSTAT_CALLS]; //tsc cycles spent in them
+    uint32_t sig_pending;       //bit per signal sent and not delivered yet
+    uint32_t sig_masked;        //1 while a signal handler runs: no other signal until sigreturn
+    void* sig_handlers[NUM_SIGNALS];    //main thread: handler of each signal, NULL for the default
+    timer_t alarm_timer;        //queued while an alarm() is pending
+    uint8_t fpu_state[FPU_STATE_SIZE] __attribute__((aligned (16)));   //fxsave area while another process owns the fpu
     //rtc 
     uint32_t max_rtc_count;
     uint32_t rtc_interrupt;
     uint32_t rtc_fd_idx;
-    file_descriptor_t fd_array[MAX_FILES];
+    wait_queue_t rtc_wq;        //rtc_read sleeps here until the virtual rtc fires
+    timer_t sleep_timer;        //queued while the process is in sleep()
+    wait_queue_t sleep_wq;      //sleep() waits here for sleep_timer
+    mutex_t fd_lock;            //fd_array slots taken and given back by open() and close()
+    file_descriptor_t fd_array[MAX_FILES];  //used through group: every thread shares the main thread's
     uint8_t args[ARGS_BUF_SIZE]; //args parsed from the cmd in execute; used for getargs
 } pcb_t;
 
-//array that holds the current active process pid in each terminal
+//array that holds the foreground process pid in each terminal
 uint32_t schedule[NUM_TERMS];
 
+//pid of the process running on this cpu (IDLE_PID when none is)
+#define curr_pid (this_cpu()->running_pid)
+
 // Operator tables for each file type
 file_op_table_t stdin_op;
 file_op_table_t stdout_op;
@@ -77,7 +138,7 @@ void setup_file_op_table();
 //set up process memory
 void setup_process_memory(uint32_t pid);
 //switches the current active process
-void process_switch(uint32_t from_pid, uint32_t to_pid);
+void process_switch(pcb_t* from_pcb, pcb_t* to_pcb);
 //stdin write and stdout read function (return error)
 int32_t stdin_write(int32_t fd, const void* buf, int32_t nbytes);
 int32_t stdout_read(int32_t fd, void* buf, int32_t nbytes);
@@ -85,6 +146,8 @@ pcb_t* get_pcb(uint32_t pid);
 
 // Quit a program after execution.
 int32_t halt(uint8_t status);
+// halt() with a status that does not fit a byte (HALT_EXCEPTION for a process killed by a signal)
+int32_t halt_with_status(uint32_t status);
 // Execute a user level program.
 int32_t execute(const uint8_t* command);
 // Read a file by file descriptor.
@@ -95,11 +158,33 @@ int32_t write(int32_t fd, const void* buf, int32_t nbytes);
 int32_t open(const uint8_t* filename);
 // Close a file descriptor if valid.
 int32_t close(int32_t fd);
+// Open the lowest unused fd on the same file as fd.
+int32_t dup(int32_t fd);
+// Make new_fd refer to the same file as fd, closing new_fd first if it is open.
+int32_t dup2(int32_t fd, int32_t new_fd);
+// Get or set the FD_NONBLOCK flag of an fd (F_GETFL / F_SETFL).
+int32_t fcntl(int32_t fd, int32_t cmd, int32_t arg);
 // Checks for valid inputs and copy args into buf
 int32_t getargs(uint8_t* buf, int32_t nbytes);
 // Map virtual memory to the video memory.
 int32_t vidmap(uint8_t** screen_start);
-int32_t set_handler(int32_t signum, void* handler_address);
-int32_t sigreturn();
+// Start a program in the background and return its pid without waiting for it.
+int32_t spawn(const uint8_t* command);
+// Like spawn(), with the child's fd 0 and 1 copied from the caller's in_fd and out_fd (-1: fd 0 / 1).
+int32_t spawn_io(const uint8_t* command, int32_t in_fd, int32_t out_fd);
+// 1 if fd is open on the terminal, 0 if it is open on something else, -1 if it is not open.
+int32_t isatty(int32_t fd);
+// Wait for a background child to halt and return its status.
+int32_t wait(int32_t pid);
+// Start a thread of the current process at entry with its own user stack; returns its id.
+int32_t thread_create(uint32_t entry, uint32_t user_esp);
+// Wait for a thread of the current process to halt and return its status.
+int32_t thread_join(int32_t tid);
+// Start the root shell of a terminal.
+int32_t start_shell(uint32_t term_idx);
+// First return to user mode of a spawned process or root shell (syscall_linkage.S).
+void spawn_return();
+// Save the current kernel context and resume another one (switch_asm.S).
+void switch_to(uint32_t* prev_esp, uint32_t next_esp, uint32_t next_cr3);
 
 #endif
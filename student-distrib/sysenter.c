@@ -0,0 +1,39 @@
+#include "sysenter.h"
+#include "x86_desc.h"
+#include "smp.h"
+
+/* 
+ * wrmsr
+ *   DESCRIPTION: write a model specific register
+ *   INPUTS: msr - register number
+ *           value - low 32 bits (the high ones are cleared)
+ *   OUTPUTS: none
+ */
+static void wrmsr(uint32_t msr, uint32_t value){
+    asm volatile ("wrmsr" : : "c"(msr), "a"(value), "d"(0));
+}
+
+/* 
+ * init_sysenter
+ *   DESCRIPTION: set up sysenter on this cpu. sysenter loads cs from MSR_SYSENTER_CS, ss from
+ *                the next gdt entry and esp and eip from the other two MSRs. The kernel stack
+ *                changes with every context switch, so esp is pointed at this cpu's tss.esp0
+ *                field instead and sysenter_entry loads the real stack from there. sysexit
+ *                returns to USER_CS and USER_DS, the entries 16 and 24 bytes past KERNEL_CS.
+ *                User programs check cpuid themselves and keep using int 0x80 without it.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void init_sysenter(){
+    uint32_t eax, ebx, ecx, edx;
+
+    asm volatile ("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+    if(!(edx & CPUID_SEP)){
+        return;
+    }
+
+    wrmsr(MSR_SYSENTER_CS, KERNEL_CS);
+    wrmsr(MSR_SYSENTER_ESP, (uint32_t)&this_cpu()->tss.esp0);
+    wrmsr(MSR_SYSENTER_EIP, (uint32_t)sysenter_entry);
+    sysenter_enabled = 1;
+}
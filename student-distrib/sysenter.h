@@ -0,0 +1,21 @@
+#ifndef _SYSENTER_H
+#define _SYSENTER_H
+
+#include "types.h"
+#include "lib.h"
+
+#define MSR_SYSENTER_CS     0x174       // code segment of sysenter; ss is +8, sysexit uses +16/+24
+#define MSR_SYSENTER_ESP    0x175       // stack pointer loaded by sysenter
+#define MSR_SYSENTER_EIP    0x176       // entry point of sysenter
+#define CPUID_SEP           (1 << 11)   // cpuid 1 edx: sysenter/sysexit
+
+//1 once the boot cpu set up sysenter (all cpus of a machine agree)
+uint32_t sysenter_enabled;
+
+//point this cpu's SYSENTER MSRs at sysenter_entry and its tss.esp0, if the cpu has sysenter
+void init_sysenter();
+
+//fast system call entry (syscall_linkage.S)
+extern void sysenter_entry();
+
+#endif /* _SYSENTER_H */
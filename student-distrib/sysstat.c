@@ -0,0 +1,105 @@
+#include "sysstat.h"
+
+/*
+ * syscall_enter
+ *   DESCRIPTION: note which system call the current process dispatches and when. The values
+ *                live in the pcb, so a call that sleeps or is switched out still finds its own
+ *                start at syscall_exit. Runs under the kernel lock.
+ *   INPUTS: index - jmp_table index (system call number - 1)
+ *   OUTPUTS: none
+ */
+void syscall_enter(uint32_t index){
+    pcb_t* pcb = get_pcb(curr_pid);
+
+    pcb->sys_index = index;
+    pcb->sys_start = rdtsc64();
+}
+
+/*
+ * syscall_exit
+ *   DESCRIPTION: the system call noted by syscall_enter returned: add it to the process's
+ *                and the system's counters and to its latency histogram. halt never gets
+ *                here; execute returns after its child halted, so it counts the child's
+ *                whole run. Runs under the kernel lock.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void syscall_exit(){
+    pcb_t* pcb = get_pcb(curr_pid);
+    uint32_t index = pcb->sys_index;
+    uint64_t cycles = rdtsc64() - pcb->sys_start;
+
+    if(index >= SYSSTAT_CALLS){
+        return;
+    }
+    //a process stolen by another cpu mid call may see that cpu's tsc slightly behind
+    if((int64_t)cycles < 0){
+        cycles = 0;
+    }
+    pcb->sys_calls[index]++;
+    pcb->sys_cycles[index] += cycles;
+    sysstat_calls[index]++;
+    sysstat_cycles[index] += cycles;
+    sysstat_hist[index][sysstat_bucket(cycles)]++;
+}
+
+/*
+ * sysstat_bucket
+ *   DESCRIPTION: log2 bucket of a latency: the index of its highest set bit, 0 for 0 and 1,
+ *                and the last bucket for everything from 2^(SYSSTAT_BUCKETS-1) up
+ *   INPUTS: cycles - the latency
+ *   OUTPUTS: bucket index
+ */
+uint32_t sysstat_bucket(uint64_t cycles){
+    uint32_t low = (uint32_t)cycles;
+    uint32_t bit;
+
+    if((cycles >> 32) != 0){
+        return SYSSTAT_BUCKETS - 1;
+    }
+    if(low == 0){
+        return 0;
+    }
+    asm ("bsrl %1, %0" : "=r"(bit) : "r"(low));
+    return bit;
+}
+
+/*
+ * sysstat
+ *   DESCRIPTION: system call: copy system call counters to the program. For SYSSTAT_ALL it gets
+ *                the counters of every process since boot and the latency histograms; for a
+ *                pid those of that process or thread, with empty histograms.
+ *   INPUTS: pid - a running process, or SYSSTAT_ALL
+ *           buf - where to put them, in the user page
+ *   OUTPUTS: 0, -1 for an unknown pid or a bad pointer
+ */
+int32_t sysstat(int32_t pid, sysstat_t* buf){
+    pcb_t* pcb = NULL;
+    uint32_t i;
+
+    if((uint32_t)buf < USER_MEM_START_VIR ||
+       (uint32_t)buf > USER_MEM_START_VIR + PAGE_SIZE_4MB - sizeof(sysstat_t)){
+        return -1;
+    }
+    if(pid != SYSSTAT_ALL){
+        if(pid <= IDLE_PID || (pcb = get_pcb(pid)) == NULL){
+            return -1;
+        }
+    }
+
+    for(i = 0; i < SYSSTAT_CALLS; i++){
+        if(pcb == NULL){
+            buf->calls[i] = sysstat_calls[i];
+            buf->kcycles[i] = (uint32_t)(sysstat_cycles[i] >> 10);
+        }else{
+            buf->calls[i] = pcb->sys_calls[i];
+            buf->kcycles[i] = (uint32_t)(pcb->sys_cycles[i] >> 10);
+        }
+    }
+    if(pcb == NULL){
+        memcpy(buf->hist, sysstat_hist, sizeof(sysstat_hist));
+    }else{
+        memset(buf->hist, 0, sizeof(buf->hist));
+    }
+    return 0;
+}
@@ -0,0 +1,36 @@
+#ifndef _SYSSTAT_H
+#define _SYSSTAT_H
+
+#include "types.h"
+#include "lib.h"
+#include "syscall.h"
+
+#define SYSSTAT_BUCKETS     32          // log2 latency buckets: bucket b counts 2^b to 2^(b+1)-1 cycles
+#define SYSSTAT_ALL         -1          // sysstat pid for the counters of the whole system
+
+// Counters handed to the program by sysstat, indexed by system call number - 1
+typedef struct sysstat{
+    uint32_t calls[SYSSTAT_CALLS];                      //calls made
+    uint32_t kcycles[SYSSTAT_CALLS];                    //tsc cycles spent in them / 1024
+    uint32_t hist[SYSSTAT_CALLS][SYSSTAT_BUCKETS];      //latencies; whole system only
+} sysstat_t;
+
+//calls and cycles of the whole system, by jmp_table index
+uint32_t sysstat_calls[SYSSTAT_CALLS];
+uint64_t sysstat_cycles[SYSSTAT_CALLS];
+//log2 latency histogram of each system call
+uint32_t sysstat_hist[SYSSTAT_CALLS][SYSSTAT_BUCKETS];
+
+//system call index is about to be dispatched: note the time (syscall_linkage.S)
+void syscall_enter(uint32_t index);
+
+//the dispatched system call returned: count it and its latency (syscall_linkage.S)
+void syscall_exit();
+
+//histogram bucket of a latency of cycles
+uint32_t sysstat_bucket(uint64_t cycles);
+
+//copy the counters of process pid, or of the whole system for SYSSTAT_ALL, to buf (system call)
+int32_t sysstat(int32_t pid, sysstat_t* buf);
+
+#endif /* _SYSSTAT_H */
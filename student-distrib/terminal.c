@@ -1,10 +1,40 @@
 #include "terminal.h"
+#include "pit.h"
+#include "poll.h"
+#include "signal.h"
+
+#define US_PER_TICK     (1000000 / PIT_FREQ)
+
+/* record_input_latency;
+ * Inputs: term_idx - terminal whose reader just got its line
+ * Return Value: none
+ * Function: add the time from the enter key press to the reader running again
+ * to the latency stats of the terminal */
+static void record_input_latency(int term_idx) {
+    uint32_t cycles_per_us = tsc_per_tick / US_PER_TICK;
+    uint32_t us;
+    terminal_t* term = &terminal[term_idx];
+
+    if (cycles_per_us == 0) {
+        cycles_per_us = 1;
+    }
+    us = (rdtsc() - term->enter_tsc) / cycles_per_us;
+
+    if (term->lat_samples == 0 || us < term->lat_min_us) {
+        term->lat_min_us = us;
+    }
+    if (us > term->lat_max_us) {
+        term->lat_max_us = us;
+    }
+    term->lat_total_us += us;
+    term->lat_samples++;
+}
 
 /* terminal_read;
  * Inputs: fd - not used for ckpt2
  *         buf - pointer to the user buffer to modify
  *         nbytes - the max number of characters to read
- * Return Value: read_num - number of characters successfully read
+ * Return Value: read_num - number of characters successfully read, -1 if a signal came first
  * Function: Read from keyboard buffer 
  * returns only when enter key is pressed and should always add /n before return
  * able to handler buffer overflow*/
@@ -21,40 +51,71 @@ int32_t terminal_read(int32_t fd, void* buf, int32_t nbytes) {
         return read_num;
     }
 
-    //TODO check this logic
-    //if(visible_term_idx == active_term_idx){
-        //wait until user had input something
-        while(1){
-            if(terminal[visible_term_idx].enter_flag == 1 && (visible_term_idx == active_term_idx)){
-                break;
-            }
-        }
+    //keys only reach the visible terminal, so enter_flag of our own terminal is set
+    //exactly when the user pressed enter while this terminal was on screen
+    int term_idx = active_term_idx;
+
+    //a second reader of the terminal (a background process) sleeps here, not on read_wq,
+    //so a line goes to exactly one of them
+    mutex_lock(&terminal[term_idx].read_lock);
+
+    //sleep until user had input something; keyboard_handler wakes us on enter
+    //ctrl+c (or any other signal) ends the read with nothing
+    wait_event_interruptible(&terminal[term_idx].read_wq, terminal[term_idx].enter_flag == 1);
+    if (terminal[term_idx].enter_flag != 1) {
+        mutex_unlock(&terminal[term_idx].read_lock);
+        return -1;
+    }
+
+    if (terminal[term_idx].enter_timed) {
+        terminal[term_idx].enter_timed = 0;
+        record_input_latency(term_idx);
+    }
     
-        int i;
-        // iterating the keyboard buffer
-        for (i = 0; i < nbytes; i++) {
-            //last char in the buf is always '\n'
-            if(i == (kbuf_size - 1)){
-                char_buf[i] = '\n';
-                read_num++;
-                break;
-            }
-
-            //char_buf[i] = kbuf_entered[current_terminal_idx][i];
-            char_buf[i] = terminal[visible_term_idx].kbuf_entered[i];
+    int i;
+    uint32_t flags;
+    //the keyboard handler fills kbuf_entered again on the next enter
+    spin_lock_irqsave(&terminal[term_idx].lock, flags);
+    // iterating the keyboard buffer
+    for (i = 0; i < nbytes; i++) {
+        //last char in the buf is always '\n'
+        if(i == (kbuf_size - 1)){
+            char_buf[i] = '\n';
             read_num++;
+            break;
+        }
 
-            // end reading at newline character
-            if (char_buf[i] == '\n') {
-                break;
-            }
+        //char_buf[i] = kbuf_entered[current_terminal_idx][i];
+        char_buf[i] = terminal[term_idx].kbuf_entered[i];
+        read_num++;
+
+        // end reading at newline character
+        if (char_buf[i] == '\n') {
+            break;
         }
+    }
 
-        terminal[visible_term_idx].enter_flag = 0;
-    //}
+    terminal[term_idx].enter_flag = 0;
+    spin_unlock_irqrestore(&terminal[term_idx].lock, flags);
+    mutex_unlock(&terminal[term_idx].read_lock);
     return read_num;
 }
 
+/* terminal_poll;
+ * Inputs: fd - the terminal fd
+ *         pt - poll() entries to register with read_wq, NULL to only check
+ * Return Value: POLLIN if a line was entered (terminal_read returns at once), and POLLOUT
+ * Function: poll op of the terminal; keyboard_handler wakes read_wq on enter */
+uint32_t terminal_poll(int32_t fd, poll_table_t* pt) {
+    int term_idx = active_term_idx;
+
+    poll_wait(pt, &terminal[term_idx].read_wq);
+    if (terminal[term_idx].enter_flag == 1) {
+        return POLLIN | POLLOUT;
+    }
+    return POLLOUT;
+}
+
 /* terminal_write;
  * Inputs: fd - not used for ckpt2
  *         buf - pointer to the user buffer to write
@@ -70,33 +131,28 @@ int32_t terminal_write(int32_t fd, const void* buf, int32_t nbytes) {
 
     //what we are seeing is not the active process
     //write to backup mem
-    
-    cli();
+    //(putc_term locks the screen and picks video memory or backup mem one character at a time)
 
     if (char_buf == NULL) {
         return write_num;
     }
 
+    //processes sharing the terminal do not interleave their lines
+    int term_idx = active_term_idx;
+    mutex_lock(&terminal[term_idx].write_lock);
+
     // iterating the user buffer
     int i;
     for (i = 0; i < nbytes; i++) { 
         // skip null characters
         if ((char_buf[i] != NULL_CHAR)) {
-            // printf("terminal_index:%d,%d\n", active_term_idx, visible_term_idx);
-            if( active_term_idx != visible_term_idx){
-                // printf("terminal_index:%d,%d\n", active_term_idx, visible_term_idx);
-                putc_diff(char_buf[i], active_term_idx);
-                //putc(char_buf[i]);
-            }
-            else{
-                putc(char_buf[i]);
-            }
-                write_num++; 
+            putc_term(char_buf[i], term_idx);
+            write_num++; 
         }
         
     }
 
-    sti();
+    mutex_unlock(&terminal[term_idx].write_lock);
     //update_cursor(terminal[active_term_idx].terminal_screen_x, terminal[active_term_idx].terminal_screen_y);
     return write_num;
 }
@@ -116,3 +172,21 @@ int32_t terminal_open(const uint8_t* filename) {
 int32_t terminal_close(int32_t fd) {
     return 0;
 }
+
+/* print_input_latency;
+ * Inputs: none
+ * Return Value: none
+ * Function: print min/avg/max time from enter to the blocked reader running, per terminal */
+void print_input_latency() {
+    int idx;
+    printf("\ninput latency (us):\n");
+    for (idx = 0; idx < NTERMS; idx++) {
+        terminal_t* term = &terminal[idx];
+        if (term->lat_samples == 0) {
+            printf("  term %d: no samples\n", idx);
+        } else {
+            printf("  term %d: n=%u min=%u avg=%u max=%u\n", idx, term->lat_samples,
+                   term->lat_min_us, term->lat_total_us / term->lat_samples, term->lat_max_us);
+        }
+    }
+}
@@ -7,6 +7,8 @@
 
 #define KBUF_SIZE   128
 
+struct poll_table;
+
 // read from user buffer
 int32_t terminal_read(int32_t fd, void* buf, int32_t nbytes);
 
@@ -19,6 +21,12 @@ int32_t terminal_open(const uint8_t* filename);
 // close terminal (not used for ckpt2)
 int32_t terminal_close(int32_t fd);
 
+// POLLIN once a line was entered, POLLOUT always
+uint32_t terminal_poll(int32_t fd, struct poll_table* pt);
+
+// print enter to reader wake up latency of every terminal
+void print_input_latency();
+
 
 
 #endif /* _TERMINAL_H */
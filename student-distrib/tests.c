@@ -7,6 +7,14 @@
 #include "page.h"
 #include "filesystem.h"
 #include "terminal.h"
+#include "pit.h"
+#include "pipe.h"
+#include "poll.h"
+#include "ring.h"
+#include "kdata.h"
+#include "multicall.h"
+#include "sysstat.h"
+#include "signal.h"
 
 #define PASS 1
 #define FAIL 0
@@ -410,7 +418,8 @@ int file_write_test() {
  *   OUTPUTS: return PASS if behaving as expected, return FAIL otherwise.
  */
 int file_close_test() {
-	if (file_close(0) != -1) {
+	/* fd 0 may hold a file after dup2, only out of range fds are invalid */
+	if (file_close(-1) != -1) {
 		return FAIL;
 	}
 	if (dir_close(2) != 0) {
@@ -671,6 +680,1022 @@ int rtc_garbage_input_test() {
 /* Checkpoint 4 tests */
 /* Checkpoint 5 tests */
 
+/* Run queue Test
+ * 
+ * Asserts that ready processes come off the run queue in FIFO order and
+ * that a process removed from the middle of the queue is skipped
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Uses the scheduler run queue, run before the PIT is enabled
+ * Coverage: run_queue_push, run_queue_pop, run_queue_remove
+ * Files: pit.c/h
+ */
+int run_queue_test(){
+	TEST_HEADER;
+
+	static pcb_t a, b, c;
+	int result = PASS;
+
+	a.pid = 0; b.pid = 1; c.pid = 2;
+	run_queue_push(&a);
+	run_queue_push(&b);
+	run_queue_push(&c);
+	run_queue_remove(&b);
+
+	if (run_queue_pop() != &a) result = FAIL;
+	if (run_queue_pop() != &c) result = FAIL;
+	if (run_queue_pop() != NULL) result = FAIL;	//b was removed, queue is empty
+	return result;
+}
+
+/* MLFQ priority Test
+ * 
+ * Asserts that a process on a higher priority level is picked before
+ * processes queued earlier on lower levels, and that a boost brings
+ * everyone back to level 0 in order
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Uses the scheduler run queues, run before the PIT is enabled
+ * Coverage: run_queue_pop, run_queue_top_level, priority_boost
+ * Files: pit.c/h
+ */
+int mlfq_priority_test(){
+	TEST_HEADER;
+
+	static pcb_t hog, shell;
+	int result = PASS;
+
+	hog.level = SCHED_LEVELS - 1;
+	shell.level = 0;
+	run_queue_push(&hog);
+	run_queue_push(&shell);
+
+	if (run_queue_top_level() != 0) result = FAIL;
+	if (run_queue_pop() != &shell) result = FAIL;
+
+	priority_boost();
+	if (hog.level != 0) result = FAIL;
+	if (run_queue_pop() != &hog) result = FAIL;
+	if (run_queue_top_level() != SCHED_LEVELS) result = FAIL;
+	return result;
+}
+
+/* Idle Task Test
+ * 
+ * Asserts that the idle task is never put on the run queue and that
+ * leaving tickless mode does not move pit_ticks backwards
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Reprograms PIT channel 0, run before the PIT is enabled
+ * Coverage: make_ready, tickless_enter, tickless_exit
+ * Files: pit.c/h
+ */
+int idle_task_test(){
+	TEST_HEADER;
+
+	static pcb_t idle;
+	int result = PASS;
+	uint32_t ticks = pit_ticks;
+
+	idle.pid = IDLE_PID;
+	idle.state = PROC_RUNNING;
+	idle.level = SCHED_LEVELS;
+	make_ready(&idle);
+	if (idle.state != PROC_RUNNING) result = FAIL;
+	if (run_queue_top_level() != SCHED_LEVELS) result = FAIL;
+
+	tickless_enter();
+	tickless_exit();
+	if (pit_ticks < ticks) result = FAIL;
+	return result;
+}
+
+/* Wait Without Children Test
+ * 
+ * Asserts that wait returns -1 right away instead of sleeping when the
+ * caller has no background children
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: wait
+ * Files: syscall.c/h
+ */
+int wait_no_child_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	if (wait(-1) != -1) result = FAIL;
+	if (wait(0) != -1) result = FAIL;
+	return result;
+}
+
+/* Process Table Test
+ * 
+ * Asserts that allocated processes get distinct pids and kernel stacks,
+ * can be looked up by pid, and give everything back when freed
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: alloc_process, free_process, get_pcb
+ * Files: process.c/h
+ */
+int process_table_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	uint32_t stacks = free_kernel_stacks();
+	uint32_t frames = free_user_frames();
+	pcb_t* a = alloc_process();
+	pcb_t* b = alloc_process();
+	uint32_t pid;
+
+	if (a == NULL || b == NULL) return FAIL;
+	if (a->pid == b->pid || a == b) result = FAIL;
+	if (a->pid == IDLE_PID || b->pid == IDLE_PID) result = FAIL;
+	if (get_pcb(a->pid) != a || get_pcb(b->pid) != b) result = FAIL;
+	if (((uint32_t)a & (PROCESS_STACK_SIZE - 1)) != 0) result = FAIL;
+
+	pid = a->pid;
+	free_process(a);
+	free_process(b);
+	if (get_pcb(pid) != NULL) result = FAIL;
+	if (free_kernel_stacks() != stacks || free_user_frames() != frames) result = FAIL;
+	return result;
+}
+
+#define SWITCH_BENCH_ROUNDS	10000
+
+/* state shared by the two sides of the context switch benchmark */
+static uint32_t bench_main_esp, bench_pong_esp;
+static int* bench_pong_dir;
+static volatile uint32_t bench_pong_count;
+static uint32_t bench_pong_stack[1024] __attribute__((aligned (16)));
+
+/* pong side: count the visit and switch straight back to the benchmark */
+static void bench_pong(){
+	while (1) {
+		bench_pong_count++;
+		switch_to(&bench_pong_esp, bench_main_esp, (uint32_t)page_directory);
+	}
+}
+
+/* Context Switch Benchmark
+ * 
+ * Ping-pongs between this test and a second kernel context through
+ * switch_to, each side in its own page directory so every switch also
+ * reloads cr3, and prints cycles per switch and switches per second
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Prints the results, run after init_pit (needs tsc_per_tick)
+ * Coverage: switch_to
+ * Files: switch_asm.S, syscall.c/h
+ */
+int context_switch_bench(){
+	TEST_HEADER;
+
+	uint32_t flags, n, start, cycles, per_switch;
+	uint32_t* stack = &bench_pong_stack[1024];
+	pcb_t* other = alloc_process();
+
+	if (other == NULL) return FAIL;
+	bench_pong_dir = other->page_dir;
+	bench_pong_count = 0;
+
+	/* first frame: a return address into bench_pong and four callee-saved registers */
+	*(--stack) = 0;
+	*(--stack) = (uint32_t)bench_pong;
+	*(--stack) = 0;
+	*(--stack) = 0;
+	*(--stack) = 0;
+	*(--stack) = 0;
+	bench_pong_esp = (uint32_t)stack;
+
+	cli_and_save(flags);
+	start = rdtsc();
+	for (n = 0; n < SWITCH_BENCH_ROUNDS; n++) {
+		switch_to(&bench_main_esp, bench_pong_esp, (uint32_t)bench_pong_dir);
+	}
+	cycles = rdtsc() - start;
+	restore_flags(flags);
+	free_process(other);
+
+	per_switch = cycles / (2 * SWITCH_BENCH_ROUNDS);
+	if (per_switch == 0) per_switch = 1;
+	printf("switch_to: %u cycles/switch, %u switches/s\n", per_switch, (tsc_per_tick * PIT_FREQ) / per_switch);
+	return (bench_pong_count == SWITCH_BENCH_ROUNDS) ? PASS : FAIL;
+}
+
+/* FPU Switch Test
+ * 
+ * Asserts that switching to a process arms the #NM trap, that its first
+ * fpu instruction makes it the fpu owner with TS cleared, and that
+ * switching back to the owner does not trap again
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Runs one fpu instruction as a borrowed process
+ * Coverage: fpu_switch, fpu_trap, fpu_release
+ * Files: fpu.c/h, idt.c
+ */
+int fpu_switch_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	uint32_t cr0, flags;
+	uint32_t saved_pid = curr_pid;
+	pcb_t* p = alloc_process();
+
+	if (p == NULL) return FAIL;
+	p->fpu_used = 0;
+
+	cli_and_save(flags);
+	curr_pid = p->pid;
+	fpu_switch(p);
+	asm volatile ("movl %%cr0, %0" : "=r"(cr0));
+	if (!(cr0 & CR0_TS)) result = FAIL;
+
+	/* first fpu instruction traps into fpu_trap */
+	asm volatile ("fld1; fstp %%st(0)" : : : "memory");
+	asm volatile ("movl %%cr0, %0" : "=r"(cr0));
+	if (cr0 & CR0_TS) result = FAIL;
+	if (this_cpu()->fpu_owner != p || p->fpu_used != 1) result = FAIL;
+
+	/* switching back to the owner leaves TS clear */
+	fpu_switch(p);
+	asm volatile ("movl %%cr0, %0" : "=r"(cr0));
+	if (cr0 & CR0_TS) result = FAIL;
+
+	fpu_release(p);
+	asm volatile ("movl %%cr0, %0" : "=r"(cr0));
+	if (!(cr0 & CR0_TS) || this_cpu()->fpu_owner != NULL) result = FAIL;
+	curr_pid = saved_pid;
+	restore_flags(flags);
+
+	free_process(p);
+	return result;
+}
+
+/* SMP Test
+ * 
+ * Asserts that this_cpu() finds an online cpu whose idle task is the
+ * IDLE_PID pcb, that the kernel lock nests on one cpu, and that a new
+ * process is placed on the least loaded cpu
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: this_cpu, kernel_lock, kernel_unlock, smp_place_process
+ * Files: smp.c/h, process.c
+ */
+int smp_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	uint32_t flags, depth, k;
+	cpu_t* cpu = this_cpu();
+	pcb_t* p;
+
+	if (cpu < cpus || cpu >= &cpus[nr_cpus] || !cpu->online) return FAIL;
+	if (get_pcb(IDLE_PID) != cpu->idle) result = FAIL;
+
+	cli_and_save(flags);
+	depth = kernel_lock_depth();
+	kernel_lock();
+	kernel_lock();
+	if (kernel_lock_depth() != depth + 2) result = FAIL;
+	kernel_unlock();
+	kernel_unlock();
+	if (kernel_lock_depth() != depth) result = FAIL;
+
+	p = alloc_process();
+	if (p == NULL) {
+		restore_flags(flags);
+		return FAIL;
+	}
+	for (k = 0; k < nr_cpus; k++) {
+		if (cpus[k].online && cpus[k].nr_procs < cpus[p->cpu].nr_procs - 1) result = FAIL;
+	}
+	free_process(p);
+	restore_flags(flags);
+	return result;
+}
+
+/* Work Stealing Test
+ * 
+ * Queues two processes on the second cpu and asserts that steal_work
+ * takes the one on the lowest priority level, counts the migration,
+ * and leaves a process alone during its migration cool-down
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Briefly pretends the second cpu is online; run on the boot cpu
+ * Coverage: steal_work, smp_move_process
+ * Files: pit.c/h, smp.c/h
+ */
+int steal_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	uint32_t flags, saved_cpus, saved_online, me;
+	cpu_t* other = &cpus[BOOT_CPU + 1];
+	pcb_t* a = alloc_process();
+	pcb_t* b = alloc_process();
+
+	if (a == NULL || b == NULL || this_cpu()->id != BOOT_CPU) {
+		if (a != NULL) free_process(a);
+		if (b != NULL) free_process(b);
+		return FAIL;
+	}
+
+	cli_and_save(flags);
+	me = this_cpu()->id;
+	saved_cpus = nr_cpus;
+	saved_online = other->online;
+	if (nr_cpus < 2) nr_cpus = 2;
+	other->id = BOOT_CPU + 1;	/* not set by smp_detect on a uniprocessor */
+	other->online = 1;
+
+	a->level = 0;
+	b->level = SCHED_LEVELS - 1;
+	smp_move_process(a, other->id);
+	smp_move_process(b, other->id);
+	a->state = PROC_READY;
+	b->state = PROC_READY;
+	run_queue_push(a);
+	run_queue_push(b);
+
+	/* the lowest priority process goes first */
+	if (steal_work() != 1 || b->cpu != me || b->migrations != 1 || a->cpu != other->id) result = FAIL;
+
+	/* a process that just migrated is left where it is */
+	a->migrations = 1;
+	a->migrate_tick = pit_ticks;
+	if (steal_work() != 0 || a->cpu != other->id) result = FAIL;
+
+	run_queue_remove(a);
+	run_queue_remove(b);
+	free_process(a);
+	free_process(b);
+	other->online = saved_online;
+	nr_cpus = saved_cpus;
+	restore_flags(flags);
+	return result;
+}
+
+/* Spinlock Test
+ * 
+ * Asserts that a held spinlock cannot be taken again, that ticket locks
+ * hand out tickets in order, and that the irqsave variants disable
+ * interrupts and put the interrupt flag back on release
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: spin_trylock, spin_lock_irqsave, ticket_lock_irqsave
+ * Files: lib.h
+ */
+int spinlock_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	uint32_t outer, flags, inner;
+	spinlock_t lock = SPINLOCK_INIT("test");
+	ticket_lock_t tlock = TICKET_LOCK_INIT("test ticket");
+
+	if (!spin_trylock(&lock) || spin_trylock(&lock)) result = FAIL;
+	spin_unlock(&lock);
+	if (lock.locked) result = FAIL;
+
+	cli_and_save(outer);
+	sti();
+	spin_lock_irqsave(&lock, flags);
+	asm volatile ("pushfl; popl %0" : "=r"(inner));
+	if ((inner & IF_FLAG) || !(flags & IF_FLAG) || !lock.locked) result = FAIL;
+	spin_unlock_irqrestore(&lock, flags);
+	asm volatile ("pushfl; popl %0" : "=r"(inner));
+	if (!(inner & IF_FLAG) || lock.locked) result = FAIL;
+
+	ticket_lock_irqsave(&tlock, flags);
+	if (tlock.next != 1 || tlock.owner != 0) result = FAIL;
+	ticket_unlock_irqrestore(&tlock, flags);
+	if (tlock.next != tlock.owner) result = FAIL;
+	restore_flags(outer);
+	return result;
+}
+
+/* Sync Test
+ * 
+ * Asserts that a held mutex cannot be taken again and is handed to the
+ * first waiter on unlock (and released when that waiter halts), that a
+ * semaphore gives out exactly count units, and that wake_up_nr only wakes
+ * sleepers with a matching key
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: mutex_trylock, mutex_unlock, mutex_release_all, sem_trydown, sem_up, wake_up_nr
+ * Files: sync.c/h, wait_queue.c/h
+ */
+int sync_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	uint32_t flags;
+	mutex_t m;
+	semaphore_t sem;
+	wait_queue_t wq;
+	wait_entry_t ea, eb;
+	pcb_t* a = alloc_process();
+	pcb_t* b = alloc_process();
+
+	if (a == NULL || b == NULL) {
+		if (a != NULL) free_process(a);
+		if (b != NULL) free_process(b);
+		return FAIL;
+	}
+
+	cli_and_save(flags);
+	/* keep the fake processes on this cpu's run queue, nobody else may run them */
+	smp_move_process(a, this_cpu()->id);
+	smp_move_process(b, this_cpu()->id);
+	a->held_mutexes = NULL;
+	b->held_mutexes = NULL;
+
+	mutex_init(&m, (int8_t*)"test");
+	if (!mutex_trylock(&m) || mutex_trylock(&m)) result = FAIL;
+
+	/* a waits for the mutex: unlock makes it the owner before it runs */
+	a->state = PROC_BLOCKED;
+	ea.proc = a;
+	ea.wq = &m.wq;
+	ea.next = NULL;
+	ea.key = 0;
+	m.wq.head = &ea;
+	m.wq.tail = &ea;
+	a->waiting_on = &ea;
+	mutex_unlock(&m);
+	if (!m.locked || m.owner != a || a->held_mutexes != &m || a->state != PROC_READY) result = FAIL;
+	run_queue_remove(a);
+	mutex_release_all(a);
+	if (m.locked || m.owner != NULL || a->held_mutexes != NULL) result = FAIL;
+
+	sem_init(&sem, 2);
+	if (!sem_trydown(&sem) || !sem_trydown(&sem) || sem_trydown(&sem)) result = FAIL;
+	sem_up(&sem);
+	if (!sem_trydown(&sem)) result = FAIL;
+
+	/* two sleepers on one queue with different keys */
+	init_wait_queue(&wq);
+	a->state = PROC_BLOCKED;
+	b->state = PROC_BLOCKED;
+	ea.wq = &wq;
+	ea.key = 0x100;
+	ea.next = &eb;
+	eb.proc = b;
+	eb.wq = &wq;
+	eb.key = 0x200;
+	eb.next = NULL;
+	wq.head = &ea;
+	wq.tail = &eb;
+	a->waiting_on = &ea;
+	b->waiting_on = &eb;
+	if (wake_up_nr(&wq, 0x200, 5) != 1 || b->state != PROC_READY || a->state != PROC_BLOCKED) result = FAIL;
+	if (wq.head != &ea || wq.tail != &ea) result = FAIL;
+	if (wake_up_nr(&wq, 0, 5) != 1 || a->state != PROC_READY || wq.head != NULL || wq.tail != NULL) result = FAIL;
+
+	run_queue_remove(a);
+	run_queue_remove(b);
+	free_process(a);
+	free_process(b);
+	restore_flags(flags);
+	return result;
+}
+
+/* Thread Test
+ * 
+ * Asserts that a thread shares the user frame, page directory and fd
+ * table of its process without taking a user frame of its own, and that
+ * freeing it leaves the frame with the process
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: alloc_thread, free_process
+ * Files: process.c/h
+ */
+int thread_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	uint32_t frames;
+	pcb_t* p = alloc_process();
+	pcb_t* t;
+
+	if (p == NULL) return FAIL;
+	frames = free_user_frames();
+	t = alloc_thread(p);
+	if (t == NULL) {
+		free_process(p);
+		return FAIL;
+	}
+
+	if (p->group != p || t->group != p) result = FAIL;
+	if (t->page_dir != p->page_dir || t->user_frame != p->user_frame) result = FAIL;
+	if (free_user_frames() != frames) result = FAIL;
+	if (t->group->fd_array != p->fd_array) result = FAIL;
+
+	free_process(t);
+	if (free_user_frames() != frames) result = FAIL;
+	free_process(p);
+	if (free_user_frames() != frames + 1) result = FAIL;
+	return result;
+}
+
+/* counts how often a test timer fired */
+static void timer_test_fn(timer_t* timer){
+	(*(uint32_t*)timer->data)++;
+}
+
+/* Timer Wheel Test
+ * 
+ * Queues timers in the first and an outer wheel plus one that is deleted,
+ * advances the tick and asserts that each fires exactly at its tick, the
+ * deleted one never fires, and the next deadline is reported right
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Moves pit_ticks 300 ticks forward
+ * Coverage: add_timer, del_timer, run_timers, cascade, timer_next_deadline
+ * Files: timer.c/h
+ */
+int timer_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	uint32_t flags, start, pending;
+	uint32_t fa = 0, fb = 0, fc = 0, fd = 0;
+	timer_t a, b, c, d;
+
+	cli_and_save(flags);
+	run_timers();
+	start = pit_ticks;
+	pending = timers_pending;
+
+	init_timer(&a, timer_test_fn, &fa);
+	init_timer(&b, timer_test_fn, &fb);
+	init_timer(&c, timer_test_fn, &fc);
+	init_timer(&d, timer_test_fn, &fd);
+	add_timer(&a, start + 1);
+	add_timer(&b, start + 5);
+	add_timer(&c, start + 300);	/* beyond the first wheel */
+	add_timer(&d, start + 2);
+	if (!del_timer(&d) || timers_pending != pending + 3) result = FAIL;
+	if (pending == 0 && timer_next_deadline() != 1) result = FAIL;
+
+	pit_ticks = start + 1;
+	run_timers();
+	if (fa != 1 || fb != 0) result = FAIL;
+	if (pending == 0 && timer_next_deadline() != 4) result = FAIL;
+
+	pit_ticks = start + 5;
+	run_timers();
+	if (fb != 1 || fc != 0) result = FAIL;
+
+	pit_ticks = start + 299;
+	run_timers();
+	if (fc != 0) result = FAIL;
+	pit_ticks = start + 300;
+	run_timers();
+	if (fa != 1 || fb != 1 || fc != 1 || fd != 0) result = FAIL;
+	if (timers_pending != pending) result = FAIL;
+
+	restore_flags(flags);
+	return result;
+}
+
+/* Nice Priority Test
+ * 
+ * Queues processes with a positive nice value at the lowest level and
+ * asserts that a priority boost lifts them only to the level their nice
+ * value allows, keeps every one of them queued, and that the top level is
+ * clamped to the existing levels
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: priority_boost, sched_top_level
+ * Files: pit.c/h
+ */
+int nice_priority_test(){
+	TEST_HEADER;
+
+	static pcb_t nice1, nice2, fast;
+	int result = PASS;
+
+	nice1.nice = 1;
+	nice2.nice = NICE_MAX;
+	fast.nice = NICE_MIN;
+	if (sched_top_level(&nice1) != 1) result = FAIL;
+	if (sched_top_level(&nice2) != SCHED_LEVELS - 1) result = FAIL;
+	if (sched_top_level(&fast) != 0) result = FAIL;
+
+	nice1.level = SCHED_LEVELS - 1;
+	nice2.level = SCHED_LEVELS - 1;
+	fast.level = SCHED_LEVELS - 1;
+	run_queue_push(&nice2);
+	run_queue_push(&nice1);
+	run_queue_push(&fast);
+
+	priority_boost();
+	if (fast.level != 0 || nice1.level != 1 || nice2.level != SCHED_LEVELS - 1) result = FAIL;
+	if (run_queue_pop() != &fast) result = FAIL;
+	if (run_queue_pop() != &nice1) result = FAIL;
+	if (run_queue_pop() != &nice2) result = FAIL;
+	if (run_queue_top_level() != SCHED_LEVELS) result = FAIL;
+	return result;
+}
+
+/* Pipe Test
+ * 
+ * Pushes bytes through a pipe across the end of its ring, then closes
+ * one end at a time and asserts that the reader sees end of file only
+ * after the buffered bytes and that writing without a reader fails
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None (the pipe goes back to the pool)
+ * Coverage: pipe_alloc, pipe_put, pipe_get, pipe_release
+ * Files: pipe.c/h
+ */
+int pipe_test(){
+	TEST_HEADER;
+
+	static uint8_t in[PIPE_SIZE], out[PIPE_SIZE];
+	int result = PASS;
+	pipe_t* p;
+	int32_t i;
+
+	p = pipe_alloc();
+	if (p == NULL) {
+		return FAIL;
+	}
+	for (i = 0; i < PIPE_SIZE; i++) {
+		in[i] = i * 7;
+	}
+
+	/* move the ring 100 bytes in so the full write below wraps */
+	if (pipe_put(p, in, 100) != 100 || pipe_get(p, out, 100) != 100) result = FAIL;
+	if (pipe_put(p, in, PIPE_SIZE) != PIPE_SIZE) result = FAIL;
+	if (pipe_get(p, out, 10) != 10 || out[9] != in[9]) result = FAIL;
+	if (pipe_get(p, out + 10, PIPE_SIZE) != PIPE_SIZE - 10) result = FAIL;
+	for (i = 0; i < PIPE_SIZE; i++) {
+		if (out[i] != in[i]) result = FAIL;
+	}
+
+	if (pipe_put(p, in, 5) != 5) result = FAIL;
+	pipe_release(p, 1);
+	if (pipe_get(p, out, PIPE_SIZE) != 5) result = FAIL;
+	if (pipe_get(p, out, PIPE_SIZE) != 0) result = FAIL;
+	pipe_release(p, 0);
+	if (p->in_use) result = FAIL;
+
+	p = pipe_alloc();
+	if (p == NULL) {
+		return FAIL;
+	}
+	pipe_release(p, 0);
+	if (pipe_put(p, in, 5) != -1) result = FAIL;
+	pipe_release(p, 1);
+	return result;
+}
+
+/* Poll Wait Test
+ * 
+ * Registers the current process on two wait queues through one poll
+ * table, wakes one of them and asserts that the woken entry left its
+ * queue, that poll_unwait takes the other one off and that a NULL
+ * table registers nothing
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None (both queues end up empty)
+ * Coverage: poll_wait, poll_unwait, wake_up
+ * Files: wait_queue.c/h
+ */
+int poll_wait_test(){
+	TEST_HEADER;
+
+	static poll_table_t pt;
+	wait_queue_t a, b;
+	int result = PASS;
+
+	init_wait_queue(&a);
+	init_wait_queue(&b);
+	pt.count = 0;
+
+	poll_wait(NULL, &a);
+	if (a.head != NULL) result = FAIL;
+
+	poll_wait(&pt, &a);
+	poll_wait(&pt, &b);
+	if (pt.count != 2 || a.head != &pt.entries[0] || b.head != &pt.entries[1]) result = FAIL;
+
+	wake_up(&a);
+	if (a.head != NULL || a.tail != NULL || b.head != &pt.entries[1]) result = FAIL;
+
+	poll_unwait(&pt);
+	if (pt.count != 0 || b.head != NULL || b.tail != NULL) result = FAIL;
+	return result;
+}
+
+/* Non-blocking Fd Test
+ * 
+ * Puts an rtc fd in the last slot of the current fd table, sets and
+ * clears FD_NONBLOCK with fcntl and asserts that a read before the
+ * next tick returns ERR_WOULD_BLOCK and one after it goes through
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None (the fd slot and rtc state are put back)
+ * Coverage: fcntl, read, would_block, rtc_poll
+ * Files: syscall.c/h, rtc.c/h
+ */
+int nonblock_test(){
+	TEST_HEADER;
+
+	pcb_t* pcb = get_pcb(curr_pid);
+	file_descriptor_t* file = &pcb->group->fd_array[MAX_FILES - 1];
+	file_descriptor_t saved = *file;
+	uint32_t saved_interrupt = pcb->rtc_interrupt;
+	int32_t tick;
+	int result = PASS;
+
+	file->file_op_table_ptr = &rtc_op;
+	file->inode = 0;
+	file->file_pos = 0;
+	file->flags = FD_USED;
+
+	if (fcntl(MAX_FILES - 1, F_GETFL, 0) != 0) result = FAIL;
+	if (fcntl(MAX_FILES - 1, F_SETFL, FD_NONBLOCK) != 0) result = FAIL;
+	if (fcntl(MAX_FILES - 1, F_GETFL, 0) != FD_NONBLOCK) result = FAIL;
+	if (fcntl(MAX_FILES - 1, 0, 0) != -1) result = FAIL;
+
+	pcb->rtc_interrupt = 0;
+	if (read(MAX_FILES - 1, &tick, 4) != ERR_WOULD_BLOCK) result = FAIL;
+	pcb->rtc_interrupt = 1;
+	if (read(MAX_FILES - 1, &tick, 4) != 0 || pcb->rtc_interrupt != 0) result = FAIL;
+
+	if (fcntl(MAX_FILES - 1, F_SETFL, 0) != 0 || file->flags != FD_USED) result = FAIL;
+
+	*file = saved;
+	pcb->rtc_interrupt = saved_interrupt;
+	return result;
+}
+
+/* Ring Submit Test
+ * 
+ * Queues more entries than the completion ring can hold and asserts
+ * that the first batch completes in order with each call's result,
+ * that the rest waits until completions are reaped and that an
+ * unknown opcode completes with -1
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: ring_submit, ring_op
+ * Files: ring.c/h
+ */
+int ring_submit_test(){
+	TEST_HEADER;
+
+	static io_ring_t ring;
+	int result = PASS;
+	uint32_t i;
+
+	ring.sq_head = ring.sq_tail = ring.cq_head = ring.cq_tail = 0;
+	for (i = 0; i < RING_ENTRIES + 2; i++) {
+		ring.sq[ring.sq_tail & RING_MASK].opcode = (i == 1) ? 99 : RING_OP_NOP;
+		ring.sq[ring.sq_tail & RING_MASK].user_data = i;
+		ring.sq_tail++;
+		if (i == RING_ENTRIES - 1) {
+			/* the ring holds RING_ENTRIES: run them before queueing the rest */
+			if (ring_submit(&ring) != RING_ENTRIES) result = FAIL;
+		}
+	}
+	if (ring.cq_tail != RING_ENTRIES || ring.cq[1].res != -1 || ring.cq[2].res != 0) result = FAIL;
+	for (i = 0; i < RING_ENTRIES; i++) {
+		if (ring.cq[i].user_data != i) result = FAIL;
+	}
+
+	/* completion ring full: nothing runs */
+	if (ring_submit(&ring) != 0 || ring.sq_head != RING_ENTRIES) result = FAIL;
+	ring.cq_head = ring.cq_tail;
+	if (ring_submit(&ring) != 2 || ring.cq[RING_ENTRIES & RING_MASK].user_data != RING_ENTRIES) result = FAIL;
+	if (ring.sq_head != ring.sq_tail) result = FAIL;
+	return result;
+}
+
+//page directory for kdata_map_test, too big for the kernel stack
+static int kdata_test_dir[NUM_ENTRIES] __attribute__((aligned (PAGE_SIZE_4KB)));
+
+/* Kdata Map Test
+ * 
+ * Maps the kernel data pages into a scratch page directory and asserts
+ * that the clock and process pages are present, user readable and not
+ * user writable, that nothing else in the 4MB is mapped and that
+ * kdata_publish shows through the process page
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None (the frame's process page is restored)
+ * Coverage: kdata_map, kdata_publish
+ * Files: kdata.c/h
+ */
+int kdata_map_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	pcb_t pcb;
+	page_dir_entry_kb* pde;
+	page_table_entry* table;
+	kdata_proc_t* proc;
+	kdata_proc_t saved;
+
+	memset(kdata_test_dir, 0, sizeof(kdata_test_dir));
+	pcb.page_dir = kdata_test_dir;
+	pcb.user_frame = USER_FRAMES_MAX - 1;
+	kdata_map(&pcb);
+
+	pde = (page_dir_entry_kb*)&kdata_test_dir[KDATA_VIR >> MB_PAGE_NUM_OFFSET];
+	if (!pde->present || !pde->user_supervisor || pde->page_size) return FAIL;
+	table = (page_table_entry*)(pde->base_address << PAGE_TABLE_NUM_OFFSET);
+	if (!table[0].present || !table[0].user_supervisor || table[0].read_write) result = FAIL;
+	if (!table[1].present || !table[1].user_supervisor || table[1].read_write) result = FAIL;
+	if (table[2].present || table[NUM_ENTRIES - 1].present) result = FAIL;
+
+	proc = (kdata_proc_t*)(table[1].base_address << KB_PAGE_NUM_OFFSET);
+	saved = *proc;
+	pcb.pid = 5;
+	pcb.term_idx = 2;
+	kdata_publish(&pcb);
+	if (proc->pid != 5 || proc->term_idx != 2) result = FAIL;
+	*proc = saved;
+	return result;
+}
+
+/* Multicall Test
+ * 
+ * Runs a batch mixing a call that succeeds, a call that fails, an
+ * unknown number, halt and a nested multicall, and asserts that every
+ * record gets its own result and that the system call refuses a
+ * batch outside the user page or with a bad count
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: multicall_run, multicall
+ * Files: multicall.c/h
+ */
+int multicall_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	multicall_entry_t calls[5];
+	uint32_t i;
+
+	memset(calls, 0, sizeof(calls));
+	calls[0].number = 17;			//sleep(0)
+	calls[1].number = 22;			//isatty(MAX_FILES), never open
+	calls[1].args[0] = MAX_FILES;
+	calls[2].number = 1000;
+	calls[3].number = 1;			//halt
+	calls[4].number = 28;			//multicall
+	for (i = 0; i < 5; i++) {
+		calls[i].result = 7;
+	}
+
+	if (multicall_run(calls, 5) != 5) result = FAIL;
+	if (calls[0].result != 0) result = FAIL;
+	for (i = 1; i < 5; i++) {
+		if (calls[i].result != -1) result = FAIL;
+	}
+
+	if (multicall(calls, 5) != -1) result = FAIL;
+	if (multicall((multicall_entry_t*)USER_MEM_START_VIR, 0) != -1) result = FAIL;
+	if (multicall((multicall_entry_t*)USER_MEM_START_VIR, MULTICALL_MAX + 1) != -1) result = FAIL;
+	return result;
+}
+
+/* Sysstat Test
+ * 
+ * Asserts the log2 bucket of a few latencies, then times a fake
+ * system call on an unused index and asserts that the process and
+ * system counters and the histogram each counted it once
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None (the counters of the index are restored)
+ * Coverage: sysstat_bucket, syscall_enter, syscall_exit
+ * Files: sysstat.c/h
+ */
+int sysstat_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	pcb_t* pcb = get_pcb(curr_pid);
+	uint32_t index = SYSSTAT_CALLS - 1;
+	uint32_t pcb_calls = pcb->sys_calls[index];
+	uint64_t pcb_cycles = pcb->sys_cycles[index];
+	uint32_t calls = sysstat_calls[index];
+	uint64_t cycles = sysstat_cycles[index];
+	uint32_t hist[SYSSTAT_BUCKETS];
+	uint32_t i, total = 0;
+
+	if (sysstat_bucket(0) != 0 || sysstat_bucket(1) != 0) result = FAIL;
+	if (sysstat_bucket(1023) != 9 || sysstat_bucket(1024) != 10) result = FAIL;
+	if (sysstat_bucket(0xFFFFFFFFULL) != 31) result = FAIL;
+	if (sysstat_bucket(0x100000000ULL) != SYSSTAT_BUCKETS - 1) result = FAIL;
+
+	memcpy(hist, sysstat_hist[index], sizeof(hist));
+	syscall_enter(index);
+	syscall_exit();
+	if (pcb->sys_calls[index] != pcb_calls + 1) result = FAIL;
+	if (sysstat_calls[index] != calls + 1) result = FAIL;
+	if (sysstat_cycles[index] < cycles) result = FAIL;
+	for (i = 0; i < SYSSTAT_BUCKETS; i++) {
+		total += sysstat_hist[index][i] - hist[i];
+	}
+	if (total != 1) result = FAIL;
+
+	pcb->sys_calls[index] = pcb_calls;
+	pcb->sys_cycles[index] = pcb_cycles;
+	sysstat_calls[index] = calls;
+	sysstat_cycles[index] = cycles;
+	memcpy(sysstat_hist[index], hist, sizeof(hist));
+	return result;
+}
+
+//process for signal_test, too big for the kernel stack
+static pcb_t signal_test_pcb;
+
+/* Signal Test
+ * 
+ * Sends signals to a scratch process and asserts that they are picked
+ * lowest first, that ALARM without a handler is dropped while one with
+ * a handler is delivered, that nothing is picked while a handler runs,
+ * that a context going back to the kernel gets no signal frame and that
+ * a process asleep on a wait queue is taken off it and made ready
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: send_signal, next_signal, deliver_signals
+ * Files: signal.c/h
+ */
+int signal_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	pcb_t* pcb = &signal_test_pcb;
+	hw_context_t regs;
+	wait_queue_t wq;
+	wait_entry_t entry;
+	uint32_t flags;
+
+	pcb->group = pcb;
+	/* never the running process of another cpu, so no ipi is sent for it */
+	pcb->pid = IDLE_PID + 1;
+	pcb->cpu = this_cpu()->id;
+	pcb->state = PROC_ZOMBIE;
+	init_timer(&pcb->alarm_timer, NULL, NULL);
+	reset_signals(pcb);
+	if (next_signal(pcb) != -1) result = FAIL;
+
+	send_signal(pcb, SIG_ALARM);
+	send_signal(pcb, SIG_SEGFAULT);
+	send_signal(pcb, NUM_SIGNALS);
+	if (next_signal(pcb) != SIG_SEGFAULT) result = FAIL;
+	if (next_signal(pcb) != -1 || pcb->sig_pending != 0) result = FAIL;
+
+	pcb->sig_handlers[SIG_ALARM] = (void*)USER_MEM_START_VIR;
+	send_signal(pcb, SIG_ALARM);
+	pcb->sig_masked = 1;
+	if (next_signal(pcb) != -1 || pcb->sig_pending != (1 << SIG_ALARM)) result = FAIL;
+	pcb->sig_masked = 0;
+	if (next_signal(pcb) != SIG_ALARM || pcb->sig_pending != 0) result = FAIL;
+
+	memset(&regs, 0, sizeof(regs));
+	regs.cs = KERNEL_CS;
+	regs.eip = 0x1234;
+	deliver_signals(&regs);
+	if (regs.eip != 0x1234) result = FAIL;
+
+	/* ctrl+c to a process sleeping in a read */
+	cli_and_save(flags);
+	init_wait_queue(&wq);
+	entry.proc = pcb;
+	entry.wq = &wq;
+	entry.next = NULL;
+	entry.key = 0;
+	wq.head = &entry;
+	wq.tail = &entry;
+	pcb->waiting_on = &entry;
+	pcb->polling = NULL;
+	pcb->state = PROC_BLOCKED;
+	send_signal(pcb, SIG_INTERRUPT);
+	if (pcb->state != PROC_READY || wq.head != NULL || pcb->waiting_on != NULL) result = FAIL;
+	if (pcb->sig_pending != (1 << SIG_INTERRUPT)) result = FAIL;
+	run_queue_remove(pcb);
+	pcb->state = PROC_ZOMBIE;
+	restore_flags(flags);
+
+	reset_signals(pcb);
+	return result;
+}
 
 /* Test suite entry point */
 void launch_tests(){
@@ -710,4 +1735,27 @@ void launch_tests(){
 	//TEST_OUTPUT("rtc_close_test", rtc_close_test());
 	//TEST_OUTPUT("rtc_garbage_input_test", rtc_garbage_input_test());
 	//TEST_OUTPUT("rtc_set_rate_test", rtc_set_rate_test());
+
+	TEST_OUTPUT("run_queue_test", run_queue_test());
+	TEST_OUTPUT("mlfq_priority_test", mlfq_priority_test());
+	TEST_OUTPUT("idle_task_test", idle_task_test());
+	TEST_OUTPUT("wait_no_child_test", wait_no_child_test());
+	TEST_OUTPUT("process_table_test", process_table_test());
+	TEST_OUTPUT("context_switch_bench", context_switch_bench());
+	TEST_OUTPUT("fpu_switch_test", fpu_switch_test());
+	TEST_OUTPUT("smp_test", smp_test());
+	TEST_OUTPUT("steal_test", steal_test());
+	TEST_OUTPUT("spinlock_test", spinlock_test());
+	TEST_OUTPUT("sync_test", sync_test());
+	TEST_OUTPUT("thread_test", thread_test());
+	TEST_OUTPUT("timer_test", timer_test());
+	TEST_OUTPUT("nice_priority_test", nice_priority_test());
+	TEST_OUTPUT("pipe_test", pipe_test());
+	TEST_OUTPUT("poll_wait_test", poll_wait_test());
+	TEST_OUTPUT("nonblock_test", nonblock_test());
+	TEST_OUTPUT("ring_submit_test", ring_submit_test());
+	TEST_OUTPUT("kdata_map_test", kdata_map_test());
+	TEST_OUTPUT("multicall_test", multicall_test());
+	TEST_OUTPUT("sysstat_test", sysstat_test());
+	TEST_OUTPUT("signal_test", signal_test());
 }
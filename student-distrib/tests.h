@@ -49,4 +49,70 @@ int keyboard_terminal_null_test();
 // test if we can read a file and print to stdout.
 int file_test(char* file_name, int file_size); 
 
+// test FIFO order and removal in the scheduler run queue
+int run_queue_test();
+
+// test that higher MLFQ levels run first and boosts reset levels
+int mlfq_priority_test();
+
+// test that the idle task is never queued and tickless mode keeps time
+int idle_task_test();
+
+// test that wait fails when there is nothing to wait for
+int wait_no_child_test();
+
+// test pid and kernel stack allocation in the process table
+int process_table_test();
+
+// measure the cost of switch_to with a kernel ping-pong
+int context_switch_bench();
+
+// test that the fpu is handed to a process lazily on its first fpu instruction
+int fpu_switch_test();
+
+// test per-cpu lookup, kernel lock nesting and process placement
+int smp_test();
+
+// test that an idle cpu steals the right process and honors the cool-down
+int steal_test();
+
+// test spinlock, ticket lock and irqsave semantics
+int spinlock_test();
+
+// test mutex hand off, semaphore counts and keyed wake ups
+int sync_test();
+
+// test that threads share their process's frame and page directory
+int thread_test();
+
+// test timer wheel expiry, deletion and cascading
+int timer_test();
+
+// test that a positive nice value caps the level a priority boost lifts to
+int nice_priority_test();
+
+// test pipe ring wrap around, end of file and writes without a reader
+int pipe_test();
+
+// test that one poll table sleeps on several wait queues and leaves all of them
+int poll_wait_test();
+
+// test that reads on an fd made non-blocking with fcntl return instead of sleeping
+int nonblock_test();
+
+// test that the submission ring runs entries in order and stops while completions are not reaped
+int ring_submit_test();
+
+// test that the kernel data pages are mapped user read-only and show the published pid
+int kdata_map_test();
+
+// test that a multicall batch stores each call's result and refuses halt and nesting
+int multicall_test();
+
+// test that a timed system call lands in the counters and one histogram bucket
+int sysstat_test();
+
+// test that signals are picked in order, dropped or kept pending as their handler and mask say
+int signal_test();
+
 #endif /* TESTS_H */
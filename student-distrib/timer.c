@@ -0,0 +1,335 @@
+#include "timer.h"
+#include "pit.h"
+#include "smp.h"
+#include "syscall.h"
+#include "signal.h"
+
+//first wheel: timers due in the next TVR_SIZE ticks, one slot per tick
+static timer_t* tv1[TVR_SIZE];
+//outer wheels: slot k of wheel n holds the timers of one whole turn of wheel n-1
+static timer_t* tvn[TVN_WHEELS][TVN_SIZE];
+//next tick run_timers() handles; every queued timer is placed relative to it
+static uint32_t timer_ticks;
+
+//wheels, timer links and timer_ticks
+static spinlock_t timer_lock = SPINLOCK_INIT("timer wheel");
+
+/*
+ * init_timers
+ *   DESCRIPTION: start with empty wheels at the current tick
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void init_timers(){
+    uint32_t j, k;
+    for(j = 0; j < TVR_SIZE; j++){
+        tv1[j] = NULL;
+    }
+    for(k = 0; k < TVN_WHEELS; k++){
+        for(j = 0; j < TVN_SIZE; j++){
+            tvn[k][j] = NULL;
+        }
+    }
+    timer_ticks = pit_ticks;
+    timers_pending = 0;
+    timers_fired = 0;
+    timer_cascades = 0;
+}
+
+/*
+ * init_timer
+ *   DESCRIPTION: set up a timer that is not queued
+ *   INPUTS: timer - the timer
+ *           fn - called when it fires, with interrupts disabled
+ *           data - for fn
+ *   OUTPUTS: none
+ */
+void init_timer(timer_t* timer, void (*fn)(timer_t* timer), void* data){
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires = 0;
+    timer->fn = fn;
+    timer->data = data;
+}
+
+/*
+ * timer_link
+ *   DESCRIPTION: put a timer at the head of a slot list
+ *   INPUTS: slot - the list
+ *           timer - the timer, not queued
+ *   OUTPUTS: none
+ */
+static void timer_link(timer_t** slot, timer_t* timer){
+    timer->next = *slot;
+    if(timer->next != NULL){
+        timer->next->pprev = &timer->next;
+    }
+    timer->pprev = slot;
+    *slot = timer;
+}
+
+/*
+ * timer_unlink
+ *   DESCRIPTION: take a queued timer off its slot list
+ *   INPUTS: timer - the timer
+ *   OUTPUTS: none
+ */
+static void timer_unlink(timer_t* timer){
+    *timer->pprev = timer->next;
+    if(timer->next != NULL){
+        timer->next->pprev = timer->pprev;
+    }
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+/*
+ * timer_place
+ *   DESCRIPTION: put a timer in the slot for its expiry: the first wheel if it is due within
+ *                TVR_SIZE ticks, otherwise the outer wheel whose slots are just fine enough.
+ *                A timer that is already due goes in the slot handled next. O(1).
+ *                Call with timer_lock held.
+ *   INPUTS: timer - the timer, not queued
+ *   OUTPUTS: none
+ */
+static void timer_place(timer_t* timer){
+    uint32_t expires = timer->expires;
+    uint32_t delta = expires - timer_ticks;
+    uint32_t k;
+    uint32_t shift;
+
+    if((int32_t)delta < 0){
+        timer_link(&tv1[timer_ticks & TVR_MASK], timer);
+        return;
+    }
+    if(delta < TVR_SIZE){
+        timer_link(&tv1[expires & TVR_MASK], timer);
+        return;
+    }
+    for(k = 0; k < TVN_WHEELS - 1; k++){
+        shift = TVR_BITS + (k + 1) * TVN_BITS;
+        if(delta < (1U << shift)){
+            break;
+        }
+    }
+    shift = TVR_BITS + k * TVN_BITS;
+    timer_link(&tvn[k][(expires >> shift) & TVN_MASK], timer);
+}
+
+/*
+ * cascade
+ *   DESCRIPTION: move the timers of one outer wheel slot down to finer slots; run when the
+ *                wheel inside it wraps around. Call with timer_lock held.
+ *   INPUTS: k - outer wheel
+ *           index - slot of that wheel
+ *   OUTPUTS: index, so the caller knows whether this wheel wrapped too (index 0)
+ */
+static uint32_t cascade(uint32_t k, uint32_t index){
+    timer_t* list = tvn[k][index];
+    timer_t* timer;
+
+    tvn[k][index] = NULL;
+    while(list != NULL){
+        timer = list;
+        list = list->next;
+        timer->next = NULL;
+        timer->pprev = NULL;
+        timer_place(timer);
+    }
+    timer_cascades++;
+    return index;
+}
+
+/*
+ * add_timer
+ *   DESCRIPTION: queue timer to fire once pit_ticks reaches expires, moving it if it is
+ *                already queued. An idle boot cpu may be halted on a long one-shot, so it is
+ *                told to recompute its deadline.
+ *   INPUTS: timer - the timer
+ *           expires - pit_ticks value to fire at
+ *   OUTPUTS: none
+ */
+void add_timer(timer_t* timer, uint32_t expires){
+    uint32_t flags;
+
+    spin_lock_irqsave(&timer_lock, flags);
+    if(timer_pending(timer)){
+        timer_unlink(timer);
+        timers_pending--;
+    }
+    timer->expires = expires;
+    timer_place(timer);
+    timers_pending++;
+    spin_unlock_irqrestore(&timer_lock, flags);
+
+    if(this_cpu()->id != BOOT_CPU && cpus[BOOT_CPU].running_pid == IDLE_PID){
+        smp_send_resched(BOOT_CPU);
+    }
+}
+
+/*
+ * del_timer
+ *   DESCRIPTION: take timer off the wheel so it does not fire
+ *   INPUTS: timer - the timer
+ *   OUTPUTS: 1 if it was queued, 0 if it already fired or was never added
+ */
+int32_t del_timer(timer_t* timer){
+    uint32_t flags;
+    int32_t queued = 0;
+
+    spin_lock_irqsave(&timer_lock, flags);
+    if(timer_pending(timer)){
+        timer_unlink(timer);
+        timers_pending--;
+        queued = 1;
+    }
+    spin_unlock_irqrestore(&timer_lock, flags);
+    return queued;
+}
+
+/*
+ * run_timers
+ *   DESCRIPTION: handle every tick from timer_ticks up to pit_ticks: cascade the outer wheels
+ *                whenever the first one wraps, then fire the timers of the tick's slot. After a
+ *                tickless idle period this catches up over the ticks that were skipped.
+ *                Each timer is unlinked before its fn runs, so fn may add it again.
+ *                Called from pit_handler with interrupts disabled.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void run_timers(){
+    uint32_t index;
+    uint32_t k;
+    timer_t* list;
+    timer_t* timer;
+
+    spin_lock(&timer_lock);
+    while((int32_t)(pit_ticks - timer_ticks) >= 0){
+        index = timer_ticks & TVR_MASK;
+        if(index == 0){
+            for(k = 0; k < TVN_WHEELS; k++){
+                if(cascade(k, (timer_ticks >> (TVR_BITS + k * TVN_BITS)) & TVN_MASK) != 0){
+                    break;
+                }
+            }
+        }
+        timer_ticks++;
+
+        //move the slot to a local list so del_timer keeps working on timers not run yet
+        list = tv1[index];
+        tv1[index] = NULL;
+        if(list != NULL){
+            list->pprev = &list;
+        }
+        while(list != NULL){
+            timer = list;
+            timer_unlink(timer);
+            timers_pending--;
+            timers_fired++;
+            spin_unlock(&timer_lock);
+            timer->fn(timer);
+            spin_lock(&timer_lock);
+        }
+    }
+    spin_unlock(&timer_lock);
+}
+
+/*
+ * timer_next_deadline
+ *   DESCRIPTION: ticks from now until the first queued timer may fire. The first wheel is
+ *                only searched up to its wrap point: the cascade there may bring earlier
+ *                timers down, so the wrap is the deadline if nothing comes before it.
+ *   INPUTS: none
+ *   OUTPUTS: ticks until the deadline (at least 1), NO_DEADLINE if no timer is queued
+ */
+uint32_t timer_next_deadline(){
+    uint32_t flags;
+    uint32_t index;
+    uint32_t due;
+    uint32_t ticks;
+
+    spin_lock_irqsave(&timer_lock, flags);
+    if(timers_pending == 0){
+        spin_unlock_irqrestore(&timer_lock, flags);
+        return NO_DEADLINE;
+    }
+    for(index = timer_ticks & TVR_MASK; index < TVR_SIZE; index++){
+        if(tv1[index] != NULL){
+            break;
+        }
+    }
+    due = timer_ticks + (index - (timer_ticks & TVR_MASK));
+    spin_unlock_irqrestore(&timer_lock, flags);
+
+    ticks = due - pit_ticks;
+    if((int32_t)ticks < 1){
+        return 1;
+    }
+    return ticks;
+}
+
+/*
+ * sleep_timeout
+ *   DESCRIPTION: sleep_timer of a process fired: wake it up
+ *   INPUTS: timer - the process's sleep_timer
+ *   OUTPUTS: none
+ */
+static void sleep_timeout(timer_t* timer){
+    pcb_t* pcb = (pcb_t*)timer->data;
+    wake_up(&pcb->sleep_wq);
+}
+
+/*
+ * arm_sleep_timer
+ *   DESCRIPTION: queue the sleep_timer of a process to wake its sleep_wq after ms milliseconds.
+ *                The time is rounded up to whole ticks, plus one because the current tick
+ *                is already partly over, so the process never wakes early. The timer is
+ *                pending until then.
+ *   INPUTS: pcb - the process
+ *           ms - milliseconds until the wake up
+ *   OUTPUTS: none
+ */
+void arm_sleep_timer(pcb_t* pcb, uint32_t ms){
+    timer_t* timer = &pcb->sleep_timer;
+    uint32_t ticks = (ms + (1000 / PIT_FREQ) - 1) / (1000 / PIT_FREQ);
+
+    timer->fn = sleep_timeout;
+    timer->data = pcb;
+    add_timer(timer, pit_ticks_now() + ticks + 1);
+}
+
+/*
+ * sleep
+ *   DESCRIPTION: system call: block the current process until ms milliseconds have passed.
+ *                It uses no cpu while it waits; any number of processes can sleep at once.
+ *   INPUTS: ms - milliseconds to sleep
+ *   OUTPUTS: 0, -1 if a signal ended the sleep early
+ */
+int32_t sleep(uint32_t ms){
+    pcb_t* curr_pcb = get_pcb(curr_pid);
+    uint32_t flags;
+
+    if(ms == 0){
+        return 0;
+    }
+
+    cli_and_save(flags);
+    arm_sleep_timer(curr_pcb, ms);
+    wait_event_interruptible(&curr_pcb->sleep_wq, !timer_pending(&curr_pcb->sleep_timer));
+    if(del_timer(&curr_pcb->sleep_timer)){
+        restore_flags(flags);
+        return -1;
+    }
+    restore_flags(flags);
+    return 0;
+}
+
+/*
+ * print_timer_stats
+ *   DESCRIPTION: print how many timers are queued, fired and moved between wheels
+ *   INPUTS: none
+ *   OUTPUTS: none
+ */
+void print_timer_stats(){
+    printf("timers: pending=%u fired=%u cascades=%u\n", timers_pending, timers_fired, timer_cascades);
+}
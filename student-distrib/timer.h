@@ -0,0 +1,62 @@
+#ifndef _TIMER_H
+#define _TIMER_H
+
+#include "types.h"
+#include "lib.h"
+
+#define TVR_BITS        8           // first wheel: one slot per tick for the next 256 ticks
+#define TVN_BITS        6           // every outer wheel: 64 slots, each covering a whole inner wheel
+#define TVR_SIZE        (1 << TVR_BITS)
+#define TVN_SIZE        (1 << TVN_BITS)
+#define TVR_MASK        (TVR_SIZE - 1)
+#define TVN_MASK        (TVN_SIZE - 1)
+#define TVN_WHEELS      4           // 8 + 4*6 bits cover every 32 bit expiry
+
+struct pcb;
+
+// A one-shot kernel timer. fn runs from the boot cpu's PIT interrupt once pit_ticks
+// reaches expires. The timer_t must stay allocated until it ran or was deleted.
+typedef struct timer{
+    struct timer* next;
+    struct timer** pprev;       //link pointing at this timer, NULL while it is not queued
+    uint32_t expires;           //pit_ticks at which fn runs
+    void (*fn)(struct timer* timer);
+    void* data;                 //for fn
+} timer_t;
+
+//timers queued and counters of the wheel (ctrl+s)
+uint32_t timers_pending;
+uint32_t timers_fired;
+uint32_t timer_cascades;
+
+//start with empty wheels at the current tick
+void init_timers();
+
+//set up a timer that is not queued
+void init_timer(timer_t* timer, void (*fn)(timer_t* timer), void* data);
+
+//queue timer to fire at tick expires (right at the next tick if that already passed)
+void add_timer(timer_t* timer, uint32_t expires);
+
+//take timer off the wheel if it is queued; 1 if it was
+int32_t del_timer(timer_t* timer);
+
+//1 while timer is queued
+#define timer_pending(timer)    ((timer)->pprev != NULL)
+
+//fire every timer that expired up to pit_ticks (boot cpu, PIT interrupt)
+void run_timers();
+
+//ticks from pit_ticks until the first queued timer may fire, NO_DEADLINE if none is queued
+uint32_t timer_next_deadline();
+
+//queue pcb's sleep_timer to wake pcb->sleep_wq once at least ms milliseconds have passed
+void arm_sleep_timer(struct pcb* pcb, uint32_t ms);
+
+//block the current process for at least ms milliseconds, rounded up to whole ticks (system call)
+int32_t sleep(uint32_t ms);
+
+//print timer counters (ctrl+s)
+void print_timer_stats();
+
+#endif /* _TIMER_H */
@@ -0,0 +1,274 @@
+#include "wait_queue.h"
+#include "syscall.h"
+#include "pit.h"
+
+/*
+ * init_wait_queue
+ *   DESCRIPTION: set up an empty wait queue
+ *   INPUTS: wq - the queue to initialize
+ *   OUTPUTS: none
+ */
+void init_wait_queue(wait_queue_t* wq){
+    spin_lock_init(&wq->lock, (int8_t*)"wait queue");
+    wq->head = NULL;
+    wq->tail = NULL;
+}
+
+/*
+ * sleep_on
+ *   DESCRIPTION: mark the current process blocked, append it to wq and give up the cpu.
+ *                The scheduler will not pick it again until wake_up() puts it back on the run queue.
+ *                Must be called with interrupts disabled; returns with interrupts disabled.
+ *   INPUTS: wq - the queue to sleep on
+ *   OUTPUTS: none
+ */
+void sleep_on(wait_queue_t* wq){
+    spin_lock(&wq->lock);
+    sleep_on_locked(wq, 0);
+    spin_unlock(&wq->lock);
+}
+
+/*
+ * sleep_on_locked
+ *   DESCRIPTION: sleep_on for callers that check their wake up condition under wq->lock
+ *                (mutexes, semaphores, futexes): the lock is dropped only once the process is
+ *                on the queue and blocked, so a waker that needs the lock cannot be missed.
+ *                Interrupts stay off after the unlock so a wake up on this cpu cannot come
+ *                before we are blocked either.
+ *                Call with interrupts disabled and wq->lock held; returns the same way.
+ *   INPUTS: wq - the queue to sleep on
+ *           key - what the process waits for, matched by wake_up_nr (0 for anything)
+ *   OUTPUTS: none
+ */
+void sleep_on_locked(wait_queue_t* wq, uint32_t key){
+    pcb_t* curr_pcb = get_pcb(curr_pid);
+    wait_entry_t entry;
+
+    entry.proc = curr_pcb;
+    entry.wq = wq;
+    entry.next = NULL;
+    entry.key = key;
+
+    //append to the end of the queue so waiters are woken in order
+    if(wq->tail == NULL){
+        wq->head = &entry;
+    }
+    else{
+        wq->tail->next = &entry;
+    }
+    wq->tail = &entry;
+
+    curr_pcb->waiting_on = &entry;
+    curr_pcb->state = PROC_BLOCKED;
+    spin_unlock(&wq->lock);
+
+    //run someone else (or halt the cpu) until an interrupt handler wakes us up
+    while(curr_pcb->state == PROC_BLOCKED){
+        reschedule();
+    }
+    spin_lock(&wq->lock);
+}
+
+/*
+ * wake_entries
+ *   DESCRIPTION: move up to nr processes sleeping on wq for key to the run queue, in order.
+ *                Call with wq->lock held.
+ *   INPUTS: wq - the queue to wake
+ *           key - only wake sleepers with this key, 0 for all of them
+ *           nr - most processes to wake
+ *           boost - 1 to put the woken processes on the highest priority level
+ *   OUTPUTS: number of processes woken
+ */
+static uint32_t wake_entries(wait_queue_t* wq, uint32_t key, uint32_t nr, uint32_t boost){
+    wait_entry_t* entry = wq->head;
+    wait_entry_t* prev = NULL;
+    wait_entry_t* next;
+    uint32_t woken = 0;
+
+    while(entry != NULL && woken < nr){
+        //entry lives on the sleeper's stack, read next before the sleeper can run again
+        next = entry->next;
+        if(key != 0 && entry->key != key){
+            prev = entry;
+            entry = next;
+            continue;
+        }
+        if(prev == NULL){
+            wq->head = next;
+        }
+        else{
+            prev->next = next;
+        }
+        if(wq->tail == entry){
+            wq->tail = prev;
+        }
+        entry->proc->waiting_on = NULL;
+        if(boost){
+            entry->proc->level = sched_top_level(entry->proc);
+            entry->proc->ticks_used = 0;
+        }
+        make_ready(entry->proc);
+        woken++;
+        entry = next;
+    }
+    return woken;
+}
+
+/*
+ * wake_all
+ *   DESCRIPTION: move every process sleeping on wq to the run queue and empty the queue.
+ *                Safe to call from interrupt handlers.
+ *   INPUTS: wq - the queue to wake
+ *           boost - 1 to put the woken processes on the highest priority level
+ *   OUTPUTS: none
+ */
+static void wake_all(wait_queue_t* wq, uint32_t boost){
+    uint32_t flags;
+    spin_lock_irqsave(&wq->lock, flags);
+    wake_entries(wq, 0, (uint32_t)-1, boost);
+    spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+/*
+ * wake_up
+ *   DESCRIPTION: move every process sleeping on wq to the run queue, keeping its priority level
+ *   INPUTS: wq - the queue to wake
+ *   OUTPUTS: none
+ */
+void wake_up(wait_queue_t* wq){
+    wake_all(wq, 0);
+}
+
+/*
+ * wake_up_boost
+ *   DESCRIPTION: move every process sleeping on wq to the run queue at the highest priority
+ *                level. Used for keyboard and rtc events so interactive processes respond
+ *                quickly even while cpu bound processes are running.
+ *   INPUTS: wq - the queue to wake
+ *   OUTPUTS: none
+ */
+void wake_up_boost(wait_queue_t* wq){
+    wake_all(wq, 1);
+}
+
+/*
+ * wake_up_nr
+ *   DESCRIPTION: wake at most nr processes sleeping on wq for key, keeping their priority level
+ *   INPUTS: wq - the queue to wake
+ *           key - only wake sleepers with this key, 0 for any
+ *           nr - most processes to wake
+ *   OUTPUTS: number of processes woken
+ */
+uint32_t wake_up_nr(wait_queue_t* wq, uint32_t key, uint32_t nr){
+    uint32_t flags;
+    uint32_t woken;
+    spin_lock_irqsave(&wq->lock, flags);
+    woken = wake_entries(wq, key, nr, 0);
+    spin_unlock_irqrestore(&wq->lock, flags);
+    return woken;
+}
+
+/*
+ * unlink_entry
+ *   DESCRIPTION: take an entry off its wait queue if it is still on it (a wake up may have
+ *                taken it off already). Call with interrupts disabled.
+ *   INPUTS: target - the entry
+ *   OUTPUTS: none
+ */
+static void unlink_entry(wait_entry_t* target){
+    wait_queue_t* wq = target->wq;
+    wait_entry_t* entry;
+    wait_entry_t* prev = NULL;
+
+    spin_lock(&wq->lock);
+    for(entry = wq->head; entry != NULL; prev = entry, entry = entry->next){
+        if(entry == target){
+            if(prev == NULL){
+                wq->head = entry->next;
+            }
+            else{
+                prev->next = entry->next;
+            }
+            if(wq->tail == entry){
+                wq->tail = prev;
+            }
+            break;
+        }
+    }
+    spin_unlock(&wq->lock);
+}
+
+/*
+ * remove_wait
+ *   DESCRIPTION: unlink a blocked process from the wait queue it sleeps on, or from all of them
+ *                in poll(), e.g. when it is halted with ctrl+c while waiting for input.
+ *   INPUTS: proc - the process to remove
+ *   OUTPUTS: none
+ */
+void remove_wait(pcb_t* proc){
+    uint32_t flags;
+    cli_and_save(flags);
+
+    if(proc->waiting_on != NULL){
+        unlink_entry(proc->waiting_on);
+        proc->waiting_on = NULL;
+    }
+    if(proc->polling != NULL){
+        poll_unwait(proc->polling);
+        proc->polling = NULL;
+    }
+
+    restore_flags(flags);
+}
+
+/*
+ * poll_wait
+ *   DESCRIPTION: called by the poll op of a file before it checks whether the file is ready:
+ *                append the current process to wq with the next entry of pt. A wake up on wq
+ *                after this point makes the polling process ready; one before it is seen by
+ *                the check. Does nothing if pt is NULL (just asking) or full.
+ *   INPUTS: pt - entries of the poll() call, NULL for none
+ *           wq - queue woken when the file becomes ready
+ *   OUTPUTS: none
+ */
+void poll_wait(poll_table_t* pt, wait_queue_t* wq){
+    uint32_t flags;
+    wait_entry_t* entry;
+
+    if(pt == NULL || pt->count == POLL_MAX_WAITS){
+        return;
+    }
+    entry = &pt->entries[pt->count++];
+    entry->proc = get_pcb(curr_pid);
+    entry->wq = wq;
+    entry->next = NULL;
+    entry->key = 0;
+
+    spin_lock_irqsave(&wq->lock, flags);
+    if(wq->tail == NULL){
+        wq->head = entry;
+    }
+    else{
+        wq->tail->next = entry;
+    }
+    wq->tail = entry;
+    spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+/*
+ * poll_unwait
+ *   DESCRIPTION: take every entry of a poll() call off its queue and empty pt
+ *   INPUTS: pt - entries of the poll() call
+ *   OUTPUTS: none
+ */
+void poll_unwait(poll_table_t* pt){
+    uint32_t flags;
+    uint32_t i;
+
+    cli_and_save(flags);
+    for(i = 0; i < pt->count; i++){
+        unlink_entry(&pt->entries[i]);
+    }
+    pt->count = 0;
+    restore_flags(flags);
+}
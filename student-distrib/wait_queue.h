@@ -0,0 +1,86 @@
+#ifndef _WAIT_QUEUE_H
+#define _WAIT_QUEUE_H
+
+#include "types.h"
+#include "lib.h"
+
+struct pcb;
+struct wait_queue;
+
+// One sleeping process on a wait queue. Entries live on the sleeper's kernel stack.
+typedef struct wait_entry{
+    struct pcb* proc;
+    struct wait_queue* wq;
+    struct wait_entry* next;
+    uint32_t key;               //what the sleeper waits for on a shared queue (futex address), 0 for anything
+} wait_entry_t;
+
+// FIFO of processes sleeping until the same event happens (enter pressed, rtc tick, ...)
+typedef struct wait_queue{
+    spinlock_t lock;            //head, tail and the entries' links
+    wait_entry_t* head;
+    wait_entry_t* tail;
+} wait_queue_t;
+
+#define POLL_MAX_WAITS  16      // queues one poll() sleeps on: one per fd plus the timeout
+
+// Entries of one poll() call, on the caller's kernel stack: the process sleeps on every
+// queue at once and a wake up on any of them makes it ready
+typedef struct poll_table{
+    wait_entry_t entries[POLL_MAX_WAITS];
+    uint32_t count;
+} poll_table_t;
+
+//set up an empty wait queue
+void init_wait_queue(wait_queue_t* wq);
+
+//block the current process on wq until someone wakes it up (call with interrupts disabled)
+void sleep_on(wait_queue_t* wq);
+
+//same as sleep_on, but the caller holds wq->lock (released while asleep, held again on return)
+//and tags the entry with key for wake_up_nr
+void sleep_on_locked(wait_queue_t* wq, uint32_t key);
+
+//wake every process sleeping on wq
+void wake_up(wait_queue_t* wq);
+
+//wake at most nr processes sleeping on wq for key (0 wakes any); returns how many woke
+uint32_t wake_up_nr(wait_queue_t* wq, uint32_t key, uint32_t nr);
+
+//wake every process sleeping on wq and lift it to the top priority level (keyboard, rtc)
+void wake_up_boost(wait_queue_t* wq);
+
+//take a process off whatever wait queue it is sleeping on (used when it is halted while blocked)
+void remove_wait(struct pcb* proc);
+
+//put the current process on wq as well for a poll() sleep (from file poll ops; pt may be NULL)
+void poll_wait(poll_table_t* pt, wait_queue_t* wq);
+
+//take every entry of pt still queued off its queue
+void poll_unwait(poll_table_t* pt);
+
+/* Sleep on wq until condition becomes true. The condition is re-checked with
+ * interrupts disabled so a wake up between the check and the sleep is not lost. */
+#define wait_event(wq, condition)           \
+do {                                        \
+    uint32_t _we_flags;                     \
+    cli_and_save(_we_flags);                \
+    while (!(condition)) {                  \
+        sleep_on(wq);                       \
+    }                                       \
+    restore_flags(_we_flags);               \
+} while (0)
+
+/* wait_event that also stops once the current process has a signal to take (send_signal
+ * wakes it); the caller then checks signal_pending() (signal.h) and fails the call. */
+#define wait_event_interruptible(wq, condition) \
+do {                                        \
+    uint32_t _we_flags;                     \
+    cli_and_save(_we_flags);                \
+    while (!(condition) && !signal_pending()) { \
+        sleep_on(wq);                       \
+    }                                       \
+    restore_flags(_we_flags);               \
+} while (0)
+
+#endif /* _WAIT_QUEUE_H */
@@ -201,6 +201,17 @@ do {                                    \
     );                                  \
 } while (0)
 
+/* Load the global descriptor table (GDT).  Same operand as lidt: a 2-byte
+ * size field followed by a 4-byte base address. */
+#define lgdt(desc)                      \
+do {                                    \
+    asm volatile ("lgdt (%0)"           \
+            :                           \
+            : "g" (desc)                \
+            : "memory"                  \
+    );                                  \
+} while (0)
+
 /* Load the local descriptor table (LDT) register.  This macro takes a
  * 16-bit index into the GDT, which points to the LDT entry.  x86 then
  * reads the GDT's LDT descriptor and loads the base address specified
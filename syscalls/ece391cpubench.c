@@ -0,0 +1,78 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/*
+ * CPU availability benchmark. Run it in one terminal while the shells in
+ * the other terminals sit at their prompts. A short chunk of work is timed
+ * repeatedly to find its uninterrupted cost, then many chunks are timed
+ * back to back; the ratio is the share of the CPU this program received.
+ * With busy-waiting readers the idle shells take about two thirds of the
+ * CPU, with wait queues the share should be close to 100%.
+ */
+
+#define BUFSIZE      32
+#define CHUNK_ITERS  20000    /* short enough to usually finish inside one 10ms slice */
+#define CALIB_RUNS   50       /* fastest of these runs is taken as the uninterrupted cost */
+#define BENCH_CHUNKS 2000     /* chunks in the timed run (several seconds) */
+
+static volatile uint32_t sink;
+
+/* Read the TSC in units of 1024 cycles so long runs fit in 32 bits */
+static uint32_t
+rdtsc_kcycles (void)
+{
+    uint32_t lo, hi;
+    asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return (hi << 22) | (lo >> 10);
+}
+
+static void
+do_chunk (void)
+{
+    uint32_t i, acc = 0;
+    for (i = 0; i < CHUNK_ITERS; i++)
+        acc = acc * 1664525 + 1013904223;
+    sink = acc;
+}
+
+static void
+print_num (const char* label, uint32_t value)
+{
+    uint8_t buf[BUFSIZE];
+    ece391_fdputs (1, (uint8_t*)label);
+    ece391_fdputs (1, ece391_itoa (value, buf, 10));
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
+
+int main ()
+{
+    uint32_t i, start, elapsed, best = 0xFFFFFFFF;
+
+    ece391_fdputs (1, (uint8_t*)"cpubench: calibrating\n");
+    for (i = 0; i < CALIB_RUNS; i++) {
+        start = rdtsc_kcycles ();
+        do_chunk ();
+        elapsed = rdtsc_kcycles () - start;
+        if (elapsed < best)
+            best = elapsed;
+    }
+    if (best == 0)
+        best = 1;
+
+    ece391_fdputs (1, (uint8_t*)"cpubench: running\n");
+    start = rdtsc_kcycles ();
+    for (i = 0; i < BENCH_CHUNKS; i++)
+        do_chunk ();
+    elapsed = rdtsc_kcycles () - start;
+    if (elapsed == 0)
+        elapsed = 1;
+
+    print_num ("chunk cost (kcycles):   ", best);
+    print_num ("ideal run (kcycles):    ", best * BENCH_CHUNKS);
+    print_num ("measured run (kcycles): ", elapsed);
+    print_num ("CPU share (%):          ", (best * BENCH_CHUNKS * 100) / elapsed);
+
+    return 0;
+}
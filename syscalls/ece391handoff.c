@@ -0,0 +1,132 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/*
+ * Producer/consumer handoff benchmark. A producer thread and a consumer
+ * thread pass items through a one-slot mailbox. In the first run each side
+ * spins on the mailbox until the other one has run, so on one CPU every
+ * handoff waits for the spinner's time slice to run out. In the second run
+ * each side calls yield() while it waits and the other side runs at once.
+ * Prints the kcycles per handoff of both runs.
+ */
+
+#define BUFSIZE         32
+#define SPIN_ITEMS      20          /* a slice per handoff: keep it short */
+#define YIELD_ITEMS     2000
+#define STACK_SIZE      4096
+
+/* Memory past the end of the program file is not cleared by the loader,
+   so run() initializes everything below before use */
+static uint8_t stacks[2][STACK_SIZE] __attribute__ ((aligned (16)));
+static volatile uint32_t mailbox;       /* 0 empty, otherwise the item */
+static volatile uint32_t items;
+static volatile uint32_t use_yield;
+static volatile uint32_t checksum;
+
+/* Read the TSC in units of 1024 cycles so long runs fit in 32 bits */
+static uint32_t
+rdtsc_kcycles (void)
+{
+    uint32_t lo, hi;
+    asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return (hi << 22) | (lo >> 10);
+}
+
+static void
+wait_turn (void)
+{
+    if (use_yield)
+        ece391_yield ();
+}
+
+static int32_t
+producer (void* arg)
+{
+    uint32_t i;
+
+    for (i = 1; i <= items; i++) {
+        while (mailbox != 0)
+            wait_turn ();
+        mailbox = i;
+    }
+    return 0;
+}
+
+static int32_t
+consumer (void* arg)
+{
+    uint32_t i, sum = 0;
+
+    for (i = 1; i <= items; i++) {
+        while (mailbox == 0)
+            wait_turn ();
+        sum += mailbox;
+        mailbox = 0;
+    }
+    checksum = sum;
+    return 0;
+}
+
+static void
+print_num (const char* label, uint32_t value)
+{
+    uint8_t buf[BUFSIZE];
+    ece391_fdputs (1, (uint8_t*)label);
+    ece391_fdputs (1, ece391_itoa (value, buf, 10));
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
+
+/* Pass n items from the producer to the consumer and return the kcycles
+   per item, or 0 if the threads failed */
+static uint32_t
+run (uint32_t n, uint32_t yield)
+{
+    int32_t prod, cons;
+    uint32_t start, elapsed;
+
+    mailbox = 0;
+    items = n;
+    use_yield = yield;
+    checksum = 0;
+
+    start = rdtsc_kcycles ();
+    cons = ece391_thread_create (consumer, 0, stacks[0] + STACK_SIZE);
+    if (cons == -1)
+        return 0;
+    prod = ece391_thread_create (producer, 0, stacks[1] + STACK_SIZE);
+    if (prod == -1) {
+        /* release the consumer from its wait and let it finish */
+        items = 0;
+        mailbox = 1;
+        ece391_thread_join (cons);
+        return 0;
+    }
+    ece391_thread_join (prod);
+    ece391_thread_join (cons);
+    elapsed = rdtsc_kcycles () - start;
+
+    if (checksum != n * (n + 1) / 2)
+        return 0;
+    return elapsed / n;
+}
+
+int main ()
+{
+    uint32_t spin, yield;
+
+    ece391_fdputs (1, (uint8_t*)"handoff: spinning\n");
+    spin = run (SPIN_ITEMS, 0);
+    ece391_fdputs (1, (uint8_t*)"handoff: yielding\n");
+    yield = run (YIELD_ITEMS, 1);
+    if (spin == 0 || yield == 0) {
+        ece391_fdputs (1, (uint8_t*)"handoff: thread or checksum failure\n");
+        return 1;
+    }
+
+    print_num ("spin (kcycles/item):    ", spin);
+    print_num ("yield (kcycles/item):   ", yield);
+    print_num ("speedup:                ", spin / yield);
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+#include "ece391sysnum.h"
+
+/*
+ * ls benchmark. Lists the directory ROUNDS times the way ls does, with
+ * one read per entry, and then with the reads batched BATCH at a time
+ * through multicall. Names are not printed, so the terminal does not
+ * dominate. Prints the traps and kcycles per listing of both, and checks
+ * that both saw the same entries.
+ */
+
+#define BUFSIZE         32
+#define NAMESIZE        33
+#define ROUNDS          200
+#define BATCH           16
+
+/* Memory past the end of the program file is not cleared by the loader;
+   the arrays below are written before they are read */
+static uint8_t names[BATCH][NAMESIZE];
+static struct ece391_call calls[BATCH];
+
+/* Read the TSC in units of 1024 cycles so long runs fit in 32 bits */
+static uint32_t
+rdtsc_kcycles (void)
+{
+    uint32_t lo, hi;
+    asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return (hi << 22) | (lo >> 10);
+}
+
+static void
+print_num (const char* label, uint32_t value)
+{
+    uint8_t buf[BUFSIZE];
+    ece391_fdputs (1, (uint8_t*)label);
+    ece391_fdputs (1, ece391_itoa (value, buf, 10));
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
+
+/* One listing with a trap per call; entries seen, -1 on an error */
+static int32_t
+list_plain (uint32_t* traps)
+{
+    int32_t fd, cnt, entries = 0;
+
+    if (-1 == (fd = ece391_open ((uint8_t*)".")))
+        return -1;
+    (*traps)++;
+    do {
+        cnt = ece391_read (fd, names[0], NAMESIZE - 1);
+        (*traps)++;
+        if (cnt > 0)
+            entries++;
+    } while (cnt > 0);
+    ece391_close (fd);
+    (*traps)++;
+    return (cnt == 0) ? entries : -1;
+}
+
+/* One listing with the reads batched; entries seen, -1 on an error.
+   A batch may read past the end of the directory: those reads just
+   return 0. */
+static int32_t
+list_batched (uint32_t* traps)
+{
+    int32_t fd, i, entries = 0, done = 0;
+
+    if (-1 == (fd = ece391_open ((uint8_t*)".")))
+        return -1;
+    (*traps)++;
+    while (!done) {
+        for (i = 0; i < BATCH; i++)
+            ece391_call_set (&calls[i], SYS_READ, fd,
+                             (uint32_t)names[i], NAMESIZE - 1);
+        if (ece391_multicall (calls, BATCH) != BATCH) {
+            ece391_close (fd);
+            return -1;
+        }
+        (*traps)++;
+        for (i = 0; i < BATCH && !done; i++) {
+            if (calls[i].result < 0) {
+                ece391_close (fd);
+                return -1;
+            }
+            if (calls[i].result == 0)
+                done = 1;
+            else
+                entries++;
+        }
+    }
+    ece391_close (fd);
+    (*traps)++;
+    return entries;
+}
+
+int main ()
+{
+    uint32_t round, start, plain, batched;
+    uint32_t plain_traps = 0, batched_traps = 0;
+    int32_t plain_entries = 0, batched_entries = 0;
+
+    start = rdtsc_kcycles ();
+    for (round = 0; round < ROUNDS; round++)
+        plain_entries = list_plain (&plain_traps);
+    plain = rdtsc_kcycles () - start;
+
+    start = rdtsc_kcycles ();
+    for (round = 0; round < ROUNDS; round++)
+        batched_entries = list_batched (&batched_traps);
+    batched = rdtsc_kcycles () - start;
+
+    if (plain_entries < 0 || batched_entries != plain_entries) {
+        ece391_fdputs (1, (uint8_t*)"lsbench: the two listings differ\n");
+        return 1;
+    }
+    print_num ("entries:                  ", plain_entries);
+    print_num ("one call per trap (traps):", plain_traps / ROUNDS);
+    print_num ("multicall (traps):        ", batched_traps / ROUNDS);
+    print_num ("one call per trap (kcyc): ", plain / ROUNDS);
+    print_num ("multicall (kcyc):         ", batched / ROUNDS);
+    return 0;
+}
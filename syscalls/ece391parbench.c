@@ -0,0 +1,103 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/*
+ * Parallel speedup benchmark. Spawns one worker and times it, then spawns
+ * N workers at once (N from the command line, default 4) and times them
+ * all. Every worker does the same fixed amount of work, so on one CPU the
+ * second run takes N times as long as the first; with N CPUs (QEMU -smp N)
+ * it should take about as long. Workers are started as "parbench w".
+ */
+
+#define BUFSIZE       32
+#define WORKER_ITERS  50000000  /* roughly a second of work */
+#define MAX_WORKERS   16
+#define DEFAULT_WORKERS 4
+
+static volatile uint32_t sink;
+
+/* Read the TSC in units of 1024 cycles so long runs fit in 32 bits */
+static uint32_t
+rdtsc_kcycles (void)
+{
+    uint32_t lo, hi;
+    asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return (hi << 22) | (lo >> 10);
+}
+
+static void
+do_work (void)
+{
+    uint32_t i, acc = 0;
+    for (i = 0; i < WORKER_ITERS; i++)
+        acc = acc * 1664525 + 1013904223;
+    sink = acc;
+}
+
+static void
+print_num (const char* label, uint32_t value)
+{
+    uint8_t buf[BUFSIZE];
+    ece391_fdputs (1, (uint8_t*)label);
+    ece391_fdputs (1, ece391_itoa (value, buf, 10));
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
+
+/* Spawn n workers, wait for all of them and return the elapsed kcycles
+   (0 if a worker could not be started) */
+static uint32_t
+run_workers (uint32_t n)
+{
+    uint32_t i, started = 0, start, elapsed;
+
+    start = rdtsc_kcycles ();
+    for (i = 0; i < n; i++) {
+        if (ece391_spawn ((uint8_t*)"parbench w") == -1)
+            break;
+        started++;
+    }
+    for (i = 0; i < started; i++)
+        ece391_wait (-1);
+    elapsed = rdtsc_kcycles () - start;
+
+    if (started != n)
+        return 0;
+    return (elapsed == 0) ? 1 : elapsed;
+}
+
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+    uint32_t i, n = 0, one, many;
+
+    if (0 != ece391_getargs (buf, BUFSIZE))
+        buf[0] = '\0';
+    if (0 == ece391_strcmp (buf, (uint8_t*)"w")) {
+        do_work ();
+        return 0;
+    }
+
+    for (i = 0; buf[i] >= '0' && buf[i] <= '9'; i++)
+        n = n * 10 + (buf[i] - '0');
+    if (n == 0)
+        n = DEFAULT_WORKERS;
+    if (n > MAX_WORKERS)
+        n = MAX_WORKERS;
+
+    ece391_fdputs (1, (uint8_t*)"parbench: 1 worker\n");
+    one = run_workers (1);
+    print_num ("parbench: workers: ", n);
+    many = run_workers (n);
+    if (one == 0 || many == 0) {
+        ece391_fdputs (1, (uint8_t*)"parbench: could not spawn the workers\n");
+        return 1;
+    }
+
+    print_num ("1 worker (kcycles):     ", one);
+    print_num ("N workers (kcycles):    ", many);
+    print_num ("speedup (x100):         ", (one * n * 100) / many);
+
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/*
+ * Batched I/O benchmark. Reads a file (default frame0.txt, or the name on
+ * the command line) CHUNK bytes at a time, PASSES times over: first with
+ * one read() trap per chunk, then with the reads queued RING_ENTRIES at a
+ * time on an io_ring and run by one ring_enter() each. Prints the kcycles
+ * and traps of both runs and checks that they read the same bytes.
+ */
+
+#define BUFSIZE         33
+#define CHUNK           16
+#define PASSES          50
+
+/* Memory past the end of the program file is not cleared by the loader,
+   so every run initializes what it uses */
+static struct io_ring ring;
+static uint8_t bufs[RING_ENTRIES][CHUNK];
+
+/* Read the TSC in units of 1024 cycles so long runs fit in 32 bits */
+static uint32_t
+rdtsc_kcycles (void)
+{
+    uint32_t lo, hi;
+    asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return (hi << 22) | (lo >> 10);
+}
+
+static void
+print_num (const char* label, uint32_t value)
+{
+    uint8_t buf[BUFSIZE];
+    ece391_fdputs (1, (uint8_t*)label);
+    ece391_fdputs (1, ece391_itoa (value, buf, 10));
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
+
+static uint32_t
+add_sum (uint32_t sum, const uint8_t* buf, int32_t n)
+{
+    int32_t i;
+    for (i = 0; i < n; i++)
+        sum = sum * 31 + buf[i];
+    return sum;
+}
+
+/* One pass with a read() per chunk; returns the checksum or 0 on error */
+static uint32_t
+pass_plain (const uint8_t* fname, uint32_t* traps)
+{
+    int32_t fd, cnt;
+    uint32_t sum = 1;
+
+    if (-1 == (fd = ece391_open (fname)))
+        return 0;
+    (*traps)++;
+    do {
+        cnt = ece391_read (fd, bufs[0], CHUNK);
+        (*traps)++;
+        if (cnt > 0)
+            sum = add_sum (sum, bufs[0], cnt);
+    } while (cnt > 0);
+    ece391_close (fd);
+    (*traps)++;
+    return (cnt == 0) ? sum : 0;
+}
+
+/* One pass with the reads batched on the ring; returns the checksum or 0 */
+static uint32_t
+pass_ring (const uint8_t* fname, uint32_t* traps)
+{
+    struct ring_sqe* sqe;
+    struct ring_cqe* cqe;
+    int32_t fd, i, eof = 0, error = 0;
+    uint32_t sum = 1;
+
+    if (-1 == (fd = ece391_open (fname)))
+        return 0;
+    (*traps)++;
+    ring.sq_head = ring.sq_tail = ring.cq_head = ring.cq_tail = 0;
+    while (!eof && !error) {
+        for (i = 0; i < RING_ENTRIES; i++) {
+            sqe = &ring.sq[ring.sq_tail % RING_ENTRIES];
+            sqe->opcode = RING_OP_READ;
+            sqe->fd = fd;
+            sqe->addr = (uint32_t)bufs[i];
+            sqe->len = CHUNK;
+            sqe->user_data = i;
+            ring.sq_tail++;
+        }
+        if (ece391_ring_enter (&ring) != RING_ENTRIES)
+            error = 1;
+        (*traps)++;
+        /* completions come back in order, so the chunks are in file order */
+        while (ring.cq_head != ring.cq_tail) {
+            cqe = &ring.cq[ring.cq_head % RING_ENTRIES];
+            if (cqe->res < 0)
+                error = 1;
+            else if (cqe->res == 0)
+                eof = 1;
+            else if (!eof)
+                sum = add_sum (sum, bufs[cqe->user_data], cqe->res);
+            ring.cq_head++;
+        }
+    }
+    ece391_close (fd);
+    (*traps)++;
+    return error ? 0 : sum;
+}
+
+int main ()
+{
+    uint8_t fname[BUFSIZE];
+    uint32_t i, start, plain, batched, sum_plain = 0, sum_ring = 0;
+    uint32_t traps_plain = 0, traps_ring = 0;
+
+    if (0 != ece391_getargs (fname, BUFSIZE) || fname[0] == '\0')
+        ece391_strcpy (fname, (uint8_t*)"frame0.txt");
+
+    start = rdtsc_kcycles ();
+    for (i = 0; i < PASSES; i++)
+        sum_plain = pass_plain (fname, &traps_plain);
+    plain = rdtsc_kcycles () - start;
+
+    start = rdtsc_kcycles ();
+    for (i = 0; i < PASSES; i++)
+        sum_ring = pass_ring (fname, &traps_ring);
+    batched = rdtsc_kcycles () - start;
+
+    if (sum_plain == 0 || sum_ring == 0) {
+        ece391_fdputs (1, (uint8_t*)"ringbench: could not read the file\n");
+        return 1;
+    }
+    print_num ("read() (kcycles):       ", plain);
+    print_num ("read() traps:           ", traps_plain);
+    print_num ("ring (kcycles):         ", batched);
+    print_num ("ring traps:             ", traps_ring);
+    if (sum_plain != sum_ring) {
+        ece391_fdputs (1, (uint8_t*)"ringbench: the two runs read different data\n");
+        return 1;
+    }
+    return 0;
+}
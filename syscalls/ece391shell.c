@@ -4,11 +4,144 @@
 #include "ece391syscall.h"
 
 #define BUFSIZE 1024
+#define MAX_STAGES 4
+#define FNAME_LEN 32
+
+/* "a | b | c": start every stage in the background with its stdout
+ * feeding the next stage's stdin through a pipe, then wait for all of
+ * them. The bytes go from one program to the next inside the kernel and
+ * only the last stage writes to the screen. Returns -1 if a stage could
+ * not be started (the others still run and see end of file). */
+static int32_t
+run_pipeline (uint8_t* buf)
+{
+    uint8_t* stages[MAX_STAGES];
+    int32_t pids[MAX_STAGES];
+    int32_t fds[2];
+    int32_t n = 0, i, in_fd = -1, rval = 0;
+    uint8_t* s;
+
+    /* split at '|' and trim the spaces around each stage */
+    stages[n++] = buf;
+    for (s = buf; '\0' != *s; s++) {
+	if ('|' == *s) {
+	    if (MAX_STAGES == n)
+		return -1;
+	    *s = '\0';
+	    stages[n++] = s + 1;
+	}
+    }
+    for (i = 0; i < n; i++) {
+	while (' ' == *stages[i])
+	    stages[i]++;
+	for (s = stages[i] + ece391_strlen (stages[i]);
+	     s > stages[i] && ' ' == s[-1]; s--);
+	*s = '\0';
+    }
+
+    for (i = 0; i < n; i++) {
+	fds[0] = fds[1] = -1;
+	if (i < n - 1 && -1 == ece391_pipe (fds))
+	    break;
+	pids[i] = ece391_spawn_io (stages[i], in_fd, fds[1]);
+	if (-1 == pids[i])
+	    rval = -1;
+	/* the children hold their own copies of the ends now */
+	if (-1 != in_fd)
+	    ece391_close (in_fd);
+	if (-1 != fds[1])
+	    ece391_close (fds[1]);
+	in_fd = fds[0];
+    }
+    if (-1 != in_fd)
+	ece391_close (in_fd);
+    if (i < n)
+	rval = -1;
+
+    for (n = i, i = 0; i < n; i++) {
+	if (-1 != pids[i])
+	    ece391_wait (pids[i]);
+    }
+    return rval;
+}
+
+/* Put back the stdin / stdout that apply_redirects saved */
+static void
+restore_redirects (int32_t saved[2])
+{
+    int32_t which;
+
+    for (which = 0; which < 2; which++) {
+	if (-1 != saved[which]) {
+	    ece391_dup2 (saved[which], which);
+	    ece391_close (saved[which]);
+	    saved[which] = -1;
+	}
+    }
+}
+
+/* Cut "< file" and "> file" off the end of the command line and point
+ * this shell's stdin / stdout at the files, so the program (or the first
+ * and last stage of a pipeline) started next inherits them. The old fds
+ * are kept in saved[] for restore_redirects. Returns -1 after printing
+ * why if a file cannot be used. */
+static int32_t
+apply_redirects (uint8_t* buf, int32_t saved[2])
+{
+    uint8_t name[FNAME_LEN + 1];
+    uint8_t* s;
+    uint8_t* cut;
+    int32_t which, fd, len;
+
+    saved[0] = saved[1] = -1;
+    for (cut = buf; '\0' != *cut && '<' != *cut && '>' != *cut; cut++);
+    s = cut;
+    while ('\0' != *s) {
+	which = ('>' == *s) ? 1 : 0;
+	for (s++; ' ' == *s; s++);
+	for (len = 0; '\0' != *s && ' ' != *s && '<' != *s && '>' != *s; s++) {
+	    if (len < FNAME_LEN)
+		name[len++] = *s;
+	}
+	name[len] = '\0';
+	for (; ' ' == *s; s++);
+	if (('\0' != *s && '<' != *s && '>' != *s) || 0 == len) {
+	    restore_redirects (saved);
+	    ece391_fdputs (1, (uint8_t*)"usage: cmd [< file] [> file]\n");
+	    return -1;
+	}
+
+	if (-1 == (fd = ece391_open (name))) {
+	    restore_redirects (saved);
+	    ece391_fdputs (1, (uint8_t*)"no such file\n");
+	    return -1;
+	}
+	/* the file system is read-only: only a file that accepts writes
+	   can take output */
+	if (1 == which && -1 == ece391_write (fd, "", 0)) {
+	    ece391_close (fd);
+	    restore_redirects (saved);
+	    ece391_fdputs (1, (uint8_t*)"file is read-only\n");
+	    return -1;
+	}
+	if (-1 == saved[which])
+	    saved[which] = ece391_dup (which);
+	ece391_dup2 (fd, which);
+	ece391_close (fd);
+    }
+
+    /* drop the redirections and the spaces before them */
+    for (; cut > buf && ' ' == cut[-1]; cut--);
+    *cut = '\0';
+    return 0;
+}
 
 int main ()
 {
-    int32_t cnt, rval;
+    int32_t cnt, rval, bg;
+    int32_t saved[2];
     uint8_t buf[BUFSIZE];
+    uint8_t num[BUFSIZE];
     ece391_fdputs (1, (uint8_t*)"Starting 391 Shell\n");
 
     while (1) {
@@ -24,13 +157,42 @@ int main ()
 	    return 0;
 	if ('\0' == buf[0])
 	    continue;
-	rval = ece391_execute (buf);
-	if (-1 == rval)
+	/* "wait" collects every background job started from this shell */
+	if (0 == ece391_strcmp (buf, (uint8_t*)"wait")) {
+	    while (-1 != ece391_wait (-1));
+	    continue;
+	}
+	/* "cmd &" runs cmd in the background and prints its pid */
+	bg = ('&' == buf[cnt - 1]);
+	if (bg) {
+	    for (cnt--; cnt > 0 && ' ' == buf[cnt - 1]; cnt--);
+	    buf[cnt] = '\0';
+	}
+	/* "cmd < in > out": the program inherits the redirected fds */
+	if (-1 == apply_redirects (buf, saved))
+	    continue;
+	for (rval = 0; '\0' != buf[rval] && '|' != buf[rval]; rval++);
+	if ('|' == buf[rval]) {
+	    bg = 0;
+	    rval = run_pipeline (buf);
+	} else if (bg) {
+	    rval = ece391_spawn (buf);
+	} else {
+	    rval = ece391_execute (buf);
+	}
+	restore_redirects (saved);
+
+	if (-1 == rval) {
 	    ece391_fdputs (1, (uint8_t*)"no such command\n");
-	else if (256 == rval)
+	} else if (bg) {
+	    ece391_fdputs (1, (uint8_t*)"[");
+	    ece391_fdputs (1, ece391_itoa (rval, num, 10));
+	    ece391_fdputs (1, (uint8_t*)"]\n");
+	} else if (256 == rval) {
 	    ece391_fdputs (1, (uint8_t*)"program terminated by exception\n");
-	else if (0 != rval)
+	} else if (0 != rval) {
 	    ece391_fdputs (1, (uint8_t*)"program terminated abnormally\n");
+	}
     }
 }
 
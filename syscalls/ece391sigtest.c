@@ -7,14 +7,18 @@
 
 static uint8_t charbuf;
 static volatile uint8_t* badbuf = 0;
+static volatile uint32_t alarms;
 void segfault_sighandler (int signum);
 void alarm_sighandler (int signum);
 
 int main ()
 {
     int32_t cnt;
+    uint32_t seen;
     uint8_t buf[BUFSIZE];
 
+    alarms = 0;
+
     if (0 != ece391_getargs (buf, BUFSIZE)) {
         ece391_fdputs (1, (uint8_t*)"could not read argument\n");
 	return 3;
@@ -24,10 +28,16 @@ int main ()
 		ece391_fdputs(1, (uint8_t*)"Installing signal handlers\n");
 		ece391_set_handler(SEGFAULT, segfault_sighandler);
 		ece391_set_handler(ALARM, alarm_sighandler);
+		ece391_alarm(1000);
 	}
 
     ece391_fdputs (1, (uint8_t*)"Hi, what's your name? ");
-    if (-1 == (cnt = ece391_read (0, buf, BUFSIZE-1))) {
+    /* the alarm cuts the read short after its handler ran; read again */
+    do {
+        seen = alarms;
+        cnt = ece391_read (0, buf, BUFSIZE-1);
+    } while (-1 == cnt && seen != alarms);
+    if (-1 == cnt) {
         ece391_fdputs (1, (uint8_t*)"Can't read name from keyboard.\n");
     return 3;
     }
@@ -70,6 +80,7 @@ segfault_sighandler (int signum)
 void
 alarm_sighandler (int signum)
 {
+    alarms++;
     ece391_fdputs(1, (uint8_t*)"Alarm signal handler called, signum: ");
     switch (signum) {
         case 0: ece391_fdputs(1, (uint8_t*)"0\n"); break;
@@ -102,3 +102,90 @@ uint8_t* ece391_strrev(uint8_t* s)
    return s;
 }
 
+
+void ece391_call_set(struct ece391_call* call, uint32_t number,
+                     uint32_t arg1, uint32_t arg2, uint32_t arg3)
+{
+    call->number = number;
+    call->arg1 = arg1;
+    call->arg2 = arg2;
+    call->arg3 = arg3;
+    call->result = -1;
+}
+
+/* Kernel data pages mapped read-only into every process (kdata.h). The
+   kernel bumps seq before and after it updates the clock page. */
+#define KDATA_CLOCK_ADDR 0x8C00000
+#define KDATA_PROC_ADDR  0x8C01000
+
+struct kdata_clock {
+    volatile uint32_t seq;
+    volatile uint32_t pit_ticks;
+    volatile uint32_t tick_tsc;
+    uint32_t tsc_per_tick;
+    uint32_t pit_freq;
+};
+
+struct kdata_proc {
+    uint32_t pid;
+    uint32_t term_idx;
+};
+
+static uint32_t rdtsc_low(void)
+{
+    uint32_t lo, hi;
+    asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return lo;
+}
+
+/* Take a consistent tick count and the tsc cycles since that tick */
+static void read_clock(uint32_t* ticks, uint32_t* since)
+{
+    volatile struct kdata_clock* clock = (struct kdata_clock*)KDATA_CLOCK_ADDR;
+    uint32_t seq, tsc;
+
+    do {
+        seq = clock->seq;
+        asm volatile ("" : : : "memory");
+        *ticks = clock->pit_ticks;
+        tsc = clock->tick_tsc;
+        asm volatile ("" : : : "memory");
+    } while ((seq & 1) || seq != clock->seq);
+    *since = rdtsc_low() - tsc;
+}
+
+uint32_t ece391_ticks(void)
+{
+    volatile struct kdata_clock* clock = (struct kdata_clock*)KDATA_CLOCK_ADDR;
+    uint32_t ticks, since;
+
+    read_clock(&ticks, &since);
+    return ticks + since / clock->tsc_per_tick;
+}
+
+uint32_t ece391_time_ms(void)
+{
+    volatile struct kdata_clock* clock = (struct kdata_clock*)KDATA_CLOCK_ADDR;
+    uint32_t ticks, since, ms_per_tick = 1000 / clock->pit_freq;
+
+    read_clock(&ticks, &since);
+    ticks += since / clock->tsc_per_tick;
+    since %= clock->tsc_per_tick;
+    return ticks * ms_per_tick + since * ms_per_tick / clock->tsc_per_tick;
+}
+
+uint32_t ece391_tsc_per_ms(void)
+{
+    volatile struct kdata_clock* clock = (struct kdata_clock*)KDATA_CLOCK_ADDR;
+    return clock->tsc_per_tick / (1000 / clock->pit_freq);
+}
+
+int32_t ece391_getpid(void)
+{
+    return ((struct kdata_proc*)KDATA_PROC_ADDR)->pid;
+}
+
+int32_t ece391_getterm(void)
+{
+    return ((struct kdata_proc*)KDATA_PROC_ADDR)->term_idx;
+}
@@ -9,5 +9,17 @@ extern int32_t ece391_strncmp(const uint8_t* s1, const uint8_t* s2, uint32_t n);
 extern uint8_t *ece391_itoa(uint32_t value, uint8_t* buf, int32_t radix);
 extern uint8_t *ece391_strrev(uint8_t* s);
 
+/* Fill one record of a multicall batch (ece391syscall.h) */
+struct ece391_call;
+extern void ece391_call_set(struct ece391_call* call, uint32_t number,
+                            uint32_t arg1, uint32_t arg2, uint32_t arg3);
+
+/* Read from the kernel data pages, without a system call */
+extern uint32_t ece391_ticks(void);        /* 10ms timer ticks since boot */
+extern uint32_t ece391_time_ms(void);      /* milliseconds since boot */
+extern uint32_t ece391_tsc_per_ms(void);   /* tsc cycles per millisecond */
+extern int32_t ece391_getpid(void);        /* pid of this process */
+extern int32_t ece391_getterm(void);       /* terminal this process uses (0-2) */
+
 #endif /* ECE391SUPPORT_H */
 
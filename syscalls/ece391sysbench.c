@@ -0,0 +1,88 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+#include "ece391sysnum.h"
+
+/*
+ * Null system call benchmark. Makes CALLS isatty calls on an fd that is
+ * never open (the kernel takes its lock, dispatches and returns -1 at
+ * once) through int 0x80 and then through sysenter, and prints the
+ * cycles per call of both entry paths. For comparison it also times
+ * reading the clock from the kernel data page, which needs no trap.
+ */
+
+#define BUFSIZE         32
+#define CALLS           102400      /* a multiple of 1024 */
+#define BAD_FD          99
+
+/* Read the TSC in units of 1024 cycles so long runs fit in 32 bits */
+static uint32_t
+rdtsc_kcycles (void)
+{
+    uint32_t lo, hi;
+    asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return (hi << 22) | (lo >> 10);
+}
+
+static void
+print_num (const char* label, uint32_t value)
+{
+    uint8_t buf[BUFSIZE];
+    ece391_fdputs (1, (uint8_t*)label);
+    ece391_fdputs (1, ece391_itoa (value, buf, 10));
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
+
+/* Cycles per call of one path, 0 if a call did not fail as it should */
+static uint32_t
+time_path (int32_t (*call) (int32_t, uint32_t, uint32_t, uint32_t))
+{
+    uint32_t i, start, elapsed;
+
+    start = rdtsc_kcycles ();
+    for (i = 0; i < CALLS; i++) {
+        if (call (SYS_ISATTY, BAD_FD, 0, 0) != -1)
+            return 0;
+    }
+    elapsed = rdtsc_kcycles () - start;
+    return elapsed / (CALLS / 1024);
+}
+
+/* Cycles per clock read from the kernel data page */
+static uint32_t
+time_kdata (void)
+{
+    uint32_t i, start, elapsed;
+    volatile uint32_t ticks;
+
+    start = rdtsc_kcycles ();
+    for (i = 0; i < CALLS; i++)
+        ticks = ece391_ticks ();
+    elapsed = rdtsc_kcycles () - start;
+    (void)ticks;
+    return elapsed / (CALLS / 1024);
+}
+
+int main ()
+{
+    uint32_t int80, fast;
+
+    /* the first wrapper call finds out whether the cpu has sysenter */
+    ece391_isatty (BAD_FD);
+
+    int80 = time_path (ece391_syscall_int80);
+    print_num ("int 0x80 (cycles/call): ", int80);
+    print_num ("kdata    (cycles/read): ", time_kdata ());
+    if (!ece391_uses_sysenter ()) {
+        ece391_fdputs (1, (uint8_t*)"sysbench: this cpu has no sysenter\n");
+        return 0;
+    }
+    fast = time_path (ece391_syscall_sysenter);
+    print_num ("sysenter (cycles/call): ", fast);
+    if (int80 == 0 || fast == 0) {
+        ece391_fdputs (1, (uint8_t*)"sysbench: a null call did not return -1\n");
+        return 1;
+    }
+    return 0;
+}
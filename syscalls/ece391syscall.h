@@ -19,8 +19,182 @@ extern int32_t ece391_open (const uint8_t* filename);
 extern int32_t ece391_close (int32_t fd);
 extern int32_t ece391_getargs (uint8_t* buf, int32_t nbytes);
 extern int32_t ece391_vidmap (uint8_t** screen_start);
+/* set_handler makes the program call handler (signum) when it gets
+ * signum (enum signums below), or restores the default for a NULL
+ * handler: DIV_ZERO, SEGFAULT and INTERRUPT (ctrl+c) halt the program,
+ * ALARM and USER1 are ignored. DIV_ZERO and SEGFAULT are raised by the
+ * faulting instruction, which runs again after the handler. No other
+ * signal arrives while a handler runs. A handler just returns; the
+ * code it returns into calls sigreturn, which restores the registers
+ * the signal interrupted (as the handler may have changed them on the
+ * stack, after signum). A signal cuts short a read of the terminal, the
+ * rtc or a pipe, and a poll, sleep or wait: the call returns -1. */
 extern int32_t ece391_set_handler (int32_t signum, void* handler);
 extern int32_t ece391_sigreturn (void);
+/* alarm sends ALARM to the calling program or thread after ms
+ * milliseconds while it keeps running; a new call replaces the
+ * pending alarm and 0 cancels it. */
+extern int32_t ece391_alarm (uint32_t ms);
+/* spawn starts a program without waiting for it and returns its pid;
+ * wait blocks until that background child (or any, for pid -1) halts
+ * and returns its status. */
+extern int32_t ece391_spawn (const uint8_t* command);
+extern int32_t ece391_wait (int32_t pid);
+
+/* futex_wait sleeps while the word at addr still holds val (returns -1 at
+ * once if it does not); futex_wake wakes up to n sleepers on the word and
+ * returns how many woke. Locks built on them only enter the kernel when
+ * they find the lock taken. */
+extern int32_t ece391_futex_wait (uint32_t* addr, uint32_t val);
+extern int32_t ece391_futex_wake (uint32_t* addr, uint32_t n);
+
+/* thread_create runs fn(arg) in a new thread of this program on the
+ * stack ending at stack_top (the caller owns that memory); the thread
+ * halts with fn's return value when fn returns. thread_join waits for
+ * a thread and returns that value. Threads share memory and files. */
+extern int32_t ece391_thread_create (int32_t (*fn)(void*), void* arg,
+                                     void* stack_top);
+extern int32_t ece391_thread_join (int32_t tid);
+
+/* sleep blocks for at least ms milliseconds (10ms resolution) without
+ * using the CPU. */
+extern int32_t ece391_sleep (uint32_t ms);
+
+/* yield gives the CPU to another ready process right away (returns at
+ * once if there is none). nice adds inc to the process's nice value
+ * (-2..2) and returns the new one: below 0 the time slices get longer,
+ * above 0 the process stays at lower priority. */
+extern int32_t ece391_yield (void);
+extern int32_t ece391_nice (int32_t inc);
+
+/* pipe opens a pipe and stores its read fd in fds[0] and its write fd in
+ * fds[1]; reads return 0 once every write end is closed. spawn_io is
+ * spawn with the child's stdin and stdout copied from in_fd and out_fd
+ * (-1 passes on the caller's own fd 0 or 1). isatty returns 1 if fd is
+ * the terminal and 0 for a file or pipe. */
+extern int32_t ece391_pipe (int32_t fds[2]);
+extern int32_t ece391_spawn_io (const uint8_t* command, int32_t in_fd,
+                                int32_t out_fd);
+extern int32_t ece391_isatty (int32_t fd);
+
+/* Children started with execute, spawn or spawn_io inherit every open fd.
+ * dup opens the lowest free fd on the same file as fd; dup2 makes new_fd
+ * refer to fd's file, closing new_fd first. Both return the new fd. */
+extern int32_t ece391_dup (int32_t fd);
+extern int32_t ece391_dup2 (int32_t fd, int32_t new_fd);
+
+/* poll sleeps until one of the nfds fds can be read (POLLIN) or written
+ * (POLLOUT) without blocking, or timeout ms passed (0 only checks, -1
+ * waits forever). It fills revents of each entry and returns how many
+ * are nonzero; POLLNVAL marks an fd that is not open. The rtc is
+ * readable once it ticked, the terminal once a line was entered, a pipe
+ * while it holds data or its writers are gone. */
+#define POLLIN   0x1
+#define POLLOUT  0x4
+#define POLLNVAL 0x20
+
+struct pollfd {
+    int32_t fd;
+    int16_t events;
+    int16_t revents;
+};
+
+extern int32_t ece391_poll (struct pollfd* fds, uint32_t nfds, int32_t timeout);
+
+/* fcntl (fd, F_SETFL, O_NONBLOCK) makes read and write on fd return
+ * EAGAIN instead of sleeping when no line was entered, the rtc has not
+ * ticked or a pipe is empty (full); F_SETFL with 0 makes it block again
+ * and F_GETFL returns the current flag. dup copies and children inherit
+ * the flag with the fd. */
+#define F_GETFL    3
+#define F_SETFL    4
+#define O_NONBLOCK 0x2
+#define EAGAIN     (-2)
+
+extern int32_t ece391_fcntl (int32_t fd, int32_t cmd, int32_t arg);
+
+/* Batched system calls. Fill sq[sq_tail % RING_ENTRIES] and increment
+ * sq_tail for each call to queue, then ring_enter runs all of them in
+ * one trap and posts a completion with the call's return value at
+ * cq_tail for each. Read completions from cq_head up to cq_tail and
+ * increment cq_head to free their slots. ring_enter returns how many
+ * entries it ran; it stops early while the completion ring is full. */
+#define RING_ENTRIES  32
+#define RING_OP_NOP   0
+#define RING_OP_READ  1         /* read (fd, addr, len) */
+#define RING_OP_WRITE 2         /* write (fd, addr, len) */
+#define RING_OP_OPEN  3         /* open (addr) */
+#define RING_OP_CLOSE 4         /* close (fd) */
+
+struct ring_sqe {
+    uint32_t opcode;
+    int32_t fd;
+    uint32_t addr;
+    int32_t len;
+    uint32_t user_data;
+};
+
+struct ring_cqe {
+    uint32_t user_data;
+    int32_t res;
+};
+
+struct io_ring {
+    volatile uint32_t sq_head;
+    volatile uint32_t sq_tail;
+    volatile uint32_t cq_head;
+    volatile uint32_t cq_tail;
+    struct ring_sqe sq[RING_ENTRIES];
+    struct ring_cqe cq[RING_ENTRIES];
+};
+
+extern int32_t ece391_ring_enter (struct io_ring* ring);
+
+/* Several independent system calls in one trap. Set number (a SYS_*
+ * value) and the arguments of up to MULTICALL_MAX records, then
+ * multicall runs them in order and stores each return value in its
+ * record's result; a failing call does not stop the rest. halt and
+ * multicall itself cannot be batched and fail with -1. Returns the
+ * number of records run, or -1 for a bad pointer or count. */
+#define MULTICALL_MAX 64
+
+struct ece391_call {
+    uint32_t number;
+    uint32_t arg1;
+    uint32_t arg2;
+    uint32_t arg3;
+    int32_t result;
+};
+
+extern int32_t ece391_multicall (struct ece391_call* calls, int32_t count);
+
+/* System call counters, indexed by system call number - 1. sysstat
+ * fills them for the whole system since boot (pid SYSSTAT_ALL), with
+ * log2 latency histograms: hist[n][b] counts the calls that took 2^b
+ * to 2^(b+1)-1 cycles, the last bucket everything longer. For a pid it
+ * fills the counters of that process or thread and no histograms.
+ * Returns -1 for an unknown pid. */
+#define SYSSTAT_CALLS   32
+#define SYSSTAT_BUCKETS 32
+#define SYSSTAT_ALL     -1
+
+struct ece391_sysstat {
+    uint32_t calls[SYSSTAT_CALLS];
+    uint32_t kcycles[SYSSTAT_CALLS];    /* cycles spent / 1024 */
+    uint32_t hist[SYSSTAT_CALLS][SYSSTAT_BUCKETS];
+};
+
+extern int32_t ece391_sysstat (int32_t pid, struct ece391_sysstat* stat);
+
+/* The wrappers above enter the kernel with sysenter when the cpu has it
+ * and with int 0x80 otherwise; ece391_uses_sysenter tells which (after
+ * the first call). The two calls below always take one path, for
+ * timing: number is a SYS_* value, a, b, c its arguments. */
+extern int32_t ece391_uses_sysenter (void);
+extern int32_t ece391_syscall_int80 (int32_t number, uint32_t a, uint32_t b,
+                                     uint32_t c);
+extern int32_t ece391_syscall_sysenter (int32_t number, uint32_t a,
+                                        uint32_t b, uint32_t c);
 
 enum signums {
 	DIV_ZERO = 0,
@@ -11,5 +11,25 @@
 #define SYS_VIDMAP  8
 #define SYS_SET_HANDLER  9
 #define SYS_SIGRETURN  10
+#define SYS_SPAWN   11
+#define SYS_WAIT    12
+#define SYS_FUTEX_WAIT  13
+#define SYS_FUTEX_WAKE  14
+#define SYS_THREAD_CREATE  15
+#define SYS_THREAD_JOIN    16
+#define SYS_SLEEP   17
+#define SYS_YIELD   18
+#define SYS_NICE    19
+#define SYS_PIPE    20
+#define SYS_SPAWN_IO    21
+#define SYS_ISATTY  22
+#define SYS_DUP     23
+#define SYS_DUP2    24
+#define SYS_POLL    25
+#define SYS_FCNTL   26
+#define SYS_RING_ENTER 27
+#define SYS_MULTICALL 28
+#define SYS_SYSSTAT 29
+#define SYS_ALARM 30
 
 #endif /* ECE391SYSNUM_H */
@@ -0,0 +1,115 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/*
+ * sysstat [pid]: show how often each system call was made and how long
+ * it took on average. Without a pid it shows the whole system since
+ * boot, each call followed by its latency histogram as "2^b:count"
+ * pairs (calls that took 2^b to 2^(b+1)-1 cycles); with a pid only
+ * that process's counters.
+ */
+
+#define BUFSIZE         32
+#define NAME_WIDTH      12
+#define NUM_WIDTH       10
+
+static const char* names[] = {
+    "halt", "execute", "read", "write", "open", "close", "getargs",
+    "vidmap", "set_handler", "sigreturn", "spawn", "wait", "futex_wait",
+    "futex_wake", "thread_create", "thread_join", "sleep", "yield",
+    "nice", "pipe", "spawn_io", "isatty", "dup", "dup2", "poll", "fcntl",
+    "ring_enter", "multicall", "sysstat", "alarm"
+};
+#define NUM_NAMES (sizeof (names) / sizeof (names[0]))
+
+/* Filled in by the kernel before it is read */
+static struct ece391_sysstat stat;
+
+/* Print s and pad it with spaces to width */
+static void
+print_field (const uint8_t* s, uint32_t width)
+{
+    uint32_t len = ece391_strlen (s);
+
+    ece391_fdputs (1, s);
+    while (len++ < width)
+        ece391_fdputs (1, (uint8_t*)" ");
+}
+
+static void
+print_num (uint32_t value, uint32_t width)
+{
+    uint8_t buf[BUFSIZE];
+    print_field (ece391_itoa (value, buf, 10), width);
+}
+
+/* Average cycles per call without overflowing 32 bits */
+static uint32_t
+average (uint32_t kcycles, uint32_t calls)
+{
+    if (kcycles < (1 << 22))
+        return (kcycles << 10) / calls;
+    return (kcycles / calls) << 10;
+}
+
+static void
+print_hist (uint32_t* hist)
+{
+    uint8_t buf[BUFSIZE];
+    uint32_t b;
+
+    ece391_fdputs (1, (uint8_t*)"   ");
+    for (b = 0; b < SYSSTAT_BUCKETS; b++) {
+        if (hist[b] == 0)
+            continue;
+        ece391_fdputs (1, (uint8_t*)" 2^");
+        ece391_fdputs (1, ece391_itoa (b, buf, 10));
+        ece391_fdputs (1, (uint8_t*)":");
+        ece391_fdputs (1, ece391_itoa (hist[b], buf, 10));
+    }
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
+
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+    uint8_t num[BUFSIZE];
+    int32_t pid = SYSSTAT_ALL;
+    uint32_t i;
+
+    if (0 == ece391_getargs (buf, BUFSIZE) && buf[0] != '\0') {
+        pid = 0;
+        for (i = 0; buf[i] >= '0' && buf[i] <= '9'; i++)
+            pid = pid * 10 + (buf[i] - '0');
+        if (buf[i] != '\0') {
+            ece391_fdputs (1, (uint8_t*)"usage: sysstat [pid]\n");
+            return 3;
+        }
+    }
+    if (0 != ece391_sysstat (pid, &stat)) {
+        ece391_fdputs (1, (uint8_t*)"sysstat: no such process\n");
+        return 2;
+    }
+
+    print_field ((uint8_t*)"call", NAME_WIDTH);
+    print_field ((uint8_t*)"count", NUM_WIDTH);
+    ece391_fdputs (1, (uint8_t*)"cycles/call\n");
+    for (i = 0; i < SYSSTAT_CALLS; i++) {
+        if (stat.calls[i] == 0)
+            continue;
+        if (i < NUM_NAMES) {
+            print_field ((uint8_t*)names[i], NAME_WIDTH);
+        } else {
+            ece391_fdputs (1, (uint8_t*)"#");
+            print_field (ece391_itoa (i + 1, num, 10), NAME_WIDTH - 1);
+        }
+        print_num (stat.calls[i], NUM_WIDTH);
+        print_num (average (stat.kcycles[i], stat.calls[i]), 0);
+        ece391_fdputs (1, (uint8_t*)"\n");
+        if (pid == SYSSTAT_ALL)
+            print_hist (stat.hist[i]);
+    }
+    return 0;
+}
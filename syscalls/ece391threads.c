@@ -0,0 +1,181 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/*
+ * Thread benchmark. Runs a fixed amount of work in one thread, then the
+ * same work split across N threads (N from the command line, default 4)
+ * and times both. Every thread also adds to a shared counter under a
+ * futex lock, which only enters the kernel when the lock is taken, so the
+ * final count checks the lock and the number of futex_wait calls shows
+ * how often the threads really collided. On one CPU the two runs take
+ * about as long; with N CPUs (QEMU -smp N) the second should be N times
+ * faster.
+ */
+
+#define BUFSIZE         32
+#define TOTAL_ITERS     50000000    /* roughly a second of work */
+#define LOCK_EVERY      10000       /* iterations between counter updates */
+#define MAX_THREADS     8
+#define DEFAULT_THREADS 4
+#define STACK_SIZE      4096
+
+/* Memory past the end of the program file is not cleared by the loader,
+   so main() initializes everything below before use */
+static uint8_t stacks[MAX_THREADS][STACK_SIZE] __attribute__ ((aligned (16)));
+static volatile uint32_t lock_word;     /* 0 free, 1 taken, 2 taken with waiters */
+static volatile uint32_t counter;
+static volatile uint32_t futex_waits;
+static volatile uint32_t sink;
+
+/* Read the TSC in units of 1024 cycles so long runs fit in 32 bits */
+static uint32_t
+rdtsc_kcycles (void)
+{
+    uint32_t lo, hi;
+    asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return (hi << 22) | (lo >> 10);
+}
+
+static uint32_t
+cmpxchg (volatile uint32_t* addr, uint32_t expected, uint32_t value)
+{
+    uint32_t old;
+    asm volatile ("lock cmpxchgl %2, %1"
+                  : "=a" (old), "+m" (*addr)
+                  : "r" (value), "0" (expected)
+                  : "memory");
+    return old;
+}
+
+static uint32_t
+xchg (volatile uint32_t* addr, uint32_t value)
+{
+    asm volatile ("xchgl %0, %1" : "+r" (value), "+m" (*addr) : : "memory");
+    return value;
+}
+
+static uint32_t
+fetch_add (volatile uint32_t* addr, uint32_t value)
+{
+    asm volatile ("lock xaddl %0, %1" : "+r" (value), "+m" (*addr) : : "memory");
+    return value;
+}
+
+/* Take the lock; sleep in the kernel only while another thread holds it */
+static void
+futex_lock (volatile uint32_t* word)
+{
+    uint32_t c = cmpxchg (word, 0, 1);
+    if (c == 0)
+        return;
+    if (c != 2)
+        c = xchg (word, 2);
+    while (c != 0) {
+        fetch_add (&futex_waits, 1);
+        ece391_futex_wait ((uint32_t*)word, 2);
+        c = xchg (word, 2);
+    }
+}
+
+/* Release the lock; enter the kernel only if someone may be waiting */
+static void
+futex_unlock (volatile uint32_t* word)
+{
+    if (fetch_add (word, (uint32_t)-1) != 1) {
+        *word = 0;
+        ece391_futex_wake ((uint32_t*)word, 1);
+    }
+}
+
+static int32_t
+worker (void* arg)
+{
+    uint32_t iters = (uint32_t)arg;
+    uint32_t i, acc = 0;
+
+    for (i = 1; i <= iters; i++) {
+        acc = acc * 1664525 + 1013904223;
+        if (i % LOCK_EVERY == 0) {
+            futex_lock (&lock_word);
+            counter++;
+            futex_unlock (&lock_word);
+        }
+    }
+    sink = acc;
+    return 0;
+}
+
+static void
+print_num (const char* label, uint32_t value)
+{
+    uint8_t buf[BUFSIZE];
+    ece391_fdputs (1, (uint8_t*)label);
+    ece391_fdputs (1, ece391_itoa (value, buf, 10));
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
+
+/* Split the work across n threads, join them and return the elapsed
+   kcycles (0 if a thread could not be started) */
+static uint32_t
+run_threads (uint32_t n)
+{
+    int32_t tids[MAX_THREADS];
+    uint32_t i, started = 0, start, elapsed;
+
+    counter = 0;
+    start = rdtsc_kcycles ();
+    for (i = 0; i < n; i++) {
+        tids[i] = ece391_thread_create (worker, (void*)(TOTAL_ITERS / n),
+                                        stacks[i] + STACK_SIZE);
+        if (tids[i] == -1)
+            break;
+        started++;
+    }
+    for (i = 0; i < started; i++)
+        ece391_thread_join (tids[i]);
+    elapsed = rdtsc_kcycles () - start;
+
+    if (started != n)
+        return 0;
+    return (elapsed == 0) ? 1 : elapsed;
+}
+
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+    uint32_t i, n = 0, one, many;
+
+    lock_word = 0;
+    futex_waits = 0;
+
+    if (0 != ece391_getargs (buf, BUFSIZE))
+        buf[0] = '\0';
+    for (i = 0; buf[i] >= '0' && buf[i] <= '9'; i++)
+        n = n * 10 + (buf[i] - '0');
+    if (n == 0)
+        n = DEFAULT_THREADS;
+    if (n > MAX_THREADS)
+        n = MAX_THREADS;
+
+    ece391_fdputs (1, (uint8_t*)"threads: 1 thread\n");
+    one = run_threads (1);
+    print_num ("threads: threads: ", n);
+    many = run_threads (n);
+    if (one == 0 || many == 0) {
+        ece391_fdputs (1, (uint8_t*)"threads: could not create the threads\n");
+        return 1;
+    }
+
+    print_num ("1 thread (kcycles):     ", one);
+    print_num ("N threads (kcycles):    ", many);
+    print_num ("speedup (x100):         ", (one * n * 100) / many);
+    print_num ("futex waits:            ", futex_waits);
+    if (counter != (TOTAL_ITERS / n / LOCK_EVERY) * n) {
+        ece391_fdputs (1, (uint8_t*)"threads: lost counter updates\n");
+        return 1;
+    }
+
+    return 0;
+}